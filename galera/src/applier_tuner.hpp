@@ -0,0 +1,186 @@
+//
+// Copyright (C) 2014 Codership Oy <info@codership.com>
+//
+
+#ifndef GALERA_APPLIER_TUNER_HPP
+#define GALERA_APPLIER_TUNER_HPP
+
+#include "wsrep_api.h"
+
+#include <galerautils.hpp>
+#include "gu_atomic.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace galera
+{
+    /*!
+     * Recommends the number of concurrently working applier threads.
+     *
+     * Average dependency distance of recently certified writesets tells how
+     * many of them can be applied in parallel, more threads would only
+     * contend on monitors. When receive queue grows longer than the number
+     * of threads, the node is catching up and all threads are recommended.
+     * Recommendation grows immediately but shrinks one thread per update to
+     * avoid flapping.
+     */
+    class ApplierTuner
+    {
+    public:
+
+        static long long const PERIOD = 256; // samples between updates
+
+        ApplierTuner()
+            :
+            mutex_       (),
+            dist_sum_    (0),
+            samples_     (0),
+            last_sum_    (0),
+            last_samples_(0),
+            recommended_ (0)
+        {}
+
+        /*!
+         * Records dependency distance of certified writeset.
+         * @return true if it is time to call update() */
+        bool sample(wsrep_seqno_t distance)
+        {
+            dist_sum_ += distance;
+            return (samples_.add_and_fetch(1) % PERIOD == 0);
+        }
+
+        /*!
+         * Updates recommendation from samples collected since last update.
+         * @param threads    number of applier threads
+         * @param recv_q_len current receive queue length
+         * @return recommended number of working threads, 1..threads */
+        long update(long threads, long recv_q_len)
+        {
+            gu::Lock lock(mutex_);
+
+            long long const sum(dist_sum_());
+            long long const n  (samples_());
+            long            target(recommended_);
+
+            if (n > last_samples_)
+            {
+                double const avg(double(sum - last_sum_) / (n - last_samples_));
+                target = static_cast<long>(std::ceil(avg));
+            }
+
+            last_sum_     = sum;
+            last_samples_ = n;
+
+            if (recv_q_len > threads) target = threads;
+
+            if (target < recommended_) target = recommended_ - 1;
+
+            recommended_ = std::max(1L, std::min(target, threads));
+
+            return recommended_;
+        }
+
+        /*! @return last recommendation, 0 if there was none yet */
+        long recommended() const
+        {
+            gu::Lock lock(mutex_);
+            return recommended_;
+        }
+
+    private:
+
+        ApplierTuner(const ApplierTuner&);
+        void operator=(const ApplierTuner&);
+
+        gu::Mutex mutable     mutex_;
+        gu::Atomic<long long> dist_sum_;
+        gu::Atomic<long long> samples_;
+        long long             last_sum_;
+        long long             last_samples_;
+        long                  recommended_;
+    };
+
+    /*!
+     * Limits the number of threads concurrently working as appliers, excess
+     * threads are parked on enter() until the limit grows or is disabled.
+     */
+    class ApplierGate
+    {
+    public:
+
+        ApplierGate()
+            :
+            mutex_     (),
+            cond_      (),
+            active_    (0),
+            active_max_(0),
+            parked_    (0)
+        {}
+
+        /*! sets max number of active threads, 0 means no limit */
+        void set_active_max(long const n)
+        {
+            gu::Lock lock(mutex_);
+            active_max_ = n;
+            cond_.broadcast();
+        }
+
+        void enter()
+        {
+            if (active_max_() > 0 && active_() >= active_max_())
+            {
+                gu::Lock lock(mutex_);
+
+                ++parked_; // must precede active_ check, see leave()
+
+                while (active_max_() > 0 && active_() >= active_max_())
+                {
+                    lock.wait(cond_);
+                }
+
+                --parked_;
+            }
+
+            ++active_;
+        }
+
+        void leave()
+        {
+            --active_;
+
+            if (parked_() > 0)
+            {
+                gu::Lock lock(mutex_);
+                cond_.signal();
+            }
+        }
+
+        long active() const { return active_(); }
+        long parked() const { return parked_(); }
+
+        class Active
+        {
+        public:
+            Active(ApplierGate& gate) : gate_(gate) { gate_.enter(); }
+            ~Active() { gate_.leave(); }
+        private:
+            Active(const Active&);
+            void operator=(const Active&);
+            ApplierGate& gate_;
+        };
+
+    private:
+
+        ApplierGate(const ApplierGate&);
+        void operator=(const ApplierGate&);
+
+        gu::Mutex        mutex_;
+        gu::Cond         cond_;
+        gu::Atomic<long> active_;
+        gu::Atomic<long> active_max_;
+        gu::Atomic<long> parked_;
+    };
+}
+
+#endif // GALERA_APPLIER_TUNER_HPP
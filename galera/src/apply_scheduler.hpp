@@ -0,0 +1,193 @@
+//
+// Copyright (C) 2014 Codership Oy <info@codership.com>
+//
+
+#ifndef GALERA_APPLY_SCHEDULER_HPP
+#define GALERA_APPLY_SCHEDULER_HPP
+
+#include "trx_handle.hpp"
+
+#include <galerautils.hpp>
+
+#include <map>
+
+namespace galera
+{
+    /*!
+     * Queue of certified remote writesets waiting for their dependencies.
+     *
+     * Instead of parking in apply monitor until its writeset can be applied,
+     * an applier thread queues the writeset and applies whatever queued
+     * writeset is ready, lowest seqno first. If nothing is ready, one thread
+     * stays behind as a watcher which waits for the dependencies to leave
+     * apply monitor, while the others return to receiving new actions.
+     *
+     * A writeset is left behind only if the watcher wait does not depend on
+     * it, otherwise (and when the queue is full) its owner applies it in
+     * the usual blocking way.
+     *
+     * Committing a writeset waits for all preceding ones to commit, so a
+     * thread which takes a writeset queued after another one may block
+     * until that one is applied. Hence only the lowest queued writeset is
+     * given to the watcher or to a thread when there is no watcher: the
+     * queue is never left without a thread able to drain it, even when
+     * queued writesets become ready because of a local or TO writeset
+     * leaving apply monitor and no new actions arrive. The watcher gives
+     * up its role when it takes a writeset, so that the next thread to
+     * come takes it over.
+     *
+     * The watcher waits for what the lowest queued writeset needs to
+     * become ready, which is always below it and so not queued. For this
+     * wait to finish, a thread must queue all writesets it received, e.g.
+     * a whole certified batch, before asking what to do next.
+     */
+    class ApplyScheduler
+    {
+    public:
+
+        enum Action
+        {
+            A_APPLY,  // apply returned trx
+            A_WAIT,   // wait for wait_seqno to leave apply monitor
+            A_RETURN  // return to receiving
+        };
+
+        /*! @param max_pending max number of queued writesets,
+         *                     0 disables scheduling */
+        explicit
+        ApplyScheduler(size_t max_pending)
+            :
+            mutex_      (),
+            pending_    (),
+            max_pending_(max_pending),
+            watching_   (false),
+            watch_seqno_(-1),
+            queued_     (0),
+            stolen_     (0)
+        {}
+
+        bool enabled() const { return max_pending_ > 0; }
+
+        /*! queues certified trxs in seqno order at once,
+         *  trxs must be referenced and unlocked */
+        void push(TrxHandle* const* trxs, size_t n)
+        {
+            gu::Lock lock(mutex_);
+
+            for (size_t i(0); i < n; ++i)
+            {
+                pending_.insert(std::make_pair(trxs[i]->global_seqno(),
+                                               trxs[i]));
+            }
+
+            queued_ += n;
+        }
+
+        void push(TrxHandle* trx) { push(&trx, 1); }
+
+        /*!
+         * Decides what the calling thread should do next.
+         *
+         * @param ready   predicate telling if trx can enter apply monitor,
+         *                ready.wait_seqno(trx) tells what seqno must leave
+         *                apply monitor for trx to become ready
+         * @param own_first seqno of the first trx queued by the caller
+         * @param own_last  seqno of the last trx queued by the caller
+         * @param watcher whether the caller is the watcher, updated
+         * @param trx     set to trx to apply for A_APPLY
+         * @param wait_seqno set to seqno to wait for for A_WAIT
+         */
+        template <class Ready>
+        Action next(const Ready&   ready,
+                    wsrep_seqno_t  own_first,
+                    wsrep_seqno_t  own_last,
+                    bool&          watcher,
+                    TrxHandle*&    trx,
+                    wsrep_seqno_t& wait_seqno)
+        {
+            gu::Lock lock(mutex_);
+
+            // other thread keeps draining the queue if the caller blocks
+            bool const drained(watching_ && !watcher);
+
+            for (iterator i(pending_.begin()); i != pending_.end(); ++i)
+            {
+                if ((drained || i == pending_.begin()) && ready(*i->second))
+                {
+                    trx = i->second;
+                    if (i->first < own_first || i->first > own_last)
+                        ++stolen_;
+                    pending_.erase(i);
+                    if (watcher) unwatch(watcher);
+                    return A_APPLY;
+                }
+            }
+
+            if (pending_.empty())
+            {
+                if (watcher) unwatch(watcher);
+
+                return A_RETURN;
+            }
+
+            if (!watching_) watching_ = watcher = true;
+
+            if (watcher)
+            {
+                // below the lowest queued trx, so it is being processed by
+                // some other thread and will leave apply monitor
+                wait_seqno = watch_seqno_ =
+                    ready.wait_seqno(*pending_.begin()->second);
+                assert(wait_seqno < pending_.begin()->first);
+                return A_WAIT;
+            }
+
+            iterator const i(pending_.lower_bound(own_first));
+
+            if (i != pending_.end() && i->first <= own_last &&
+                (i->first <= watch_seqno_ || pending_.size() > max_pending_))
+            {
+                // watcher may be waiting for own trx or queue is full
+                trx = i->second;
+                pending_.erase(i);
+                return A_APPLY;
+            }
+
+            return A_RETURN;
+        }
+
+        /*! number of queued writesets */
+        size_t size() const { gu::Lock lock(mutex_); return pending_.size(); }
+
+        /*! number of writesets ever queued */
+        long long queued() const { gu::Lock lock(mutex_); return queued_; }
+
+        /*! number of writesets applied by a thread other than its receiver */
+        long long stolen() const { gu::Lock lock(mutex_); return stolen_; }
+
+    private:
+
+        ApplyScheduler(const ApplyScheduler&);
+        void operator=(const ApplyScheduler&);
+
+        void unwatch(bool& watcher)
+        {
+            watcher      = false;
+            watching_    = false;
+            watch_seqno_ = -1;
+        }
+
+        typedef std::map<wsrep_seqno_t, TrxHandle*> Pending;
+        typedef Pending::iterator                   iterator;
+
+        gu::Mutex mutable mutex_;
+        Pending           pending_;
+        size_t const      max_pending_;
+        bool              watching_;    // there is a watcher thread
+        wsrep_seqno_t     watch_seqno_; // seqno the watcher waits for
+        long long         queued_;
+        long long         stolen_;
+    };
+}
+
+#endif // GALERA_APPLY_SCHEDULER_HPP
@@ -0,0 +1,168 @@
+//
+// Copyright (C) 2014 Codership Oy <info@codership.com>
+//
+
+#include "cert_index_flat.hpp"
+
+#include <new>
+
+galera::CertIndexFlat::CertIndexFlat()
+    :
+    slots_(),
+    pool_ (sizeof(KeyEntryNG), 1024, "cert_index_flat"),
+    size_ (0),
+    mask_ (0),
+    shift_(64)
+{}
+
+
+galera::CertIndexFlat::~CertIndexFlat()
+{
+    clear();
+}
+
+
+galera::KeyEntryNG*
+galera::CertIndexFlat::find(const KeySet::KeyPart& kp) const
+{
+    if (gu_unlikely(0 == size_)) return NULL;
+
+    uint64_t const h(head(kp));
+    uint64_t const t(kp.hash_tail());
+
+    for (size_t idx(home(h)), dist(0); ; idx = (idx + 1) & mask_, ++dist)
+    {
+        const Slot& s(slots_[idx]);
+
+        /* Robin Hood invariant: key can't be further from its home slot
+         * than the entry we've just met */
+        if (NULL == s.entry_ || distance(s, idx) < dist) return NULL;
+
+        if (match(s, h, t)) return s.entry_;
+    }
+}
+
+
+galera::KeyEntryNG*
+galera::CertIndexFlat::insert(const KeySet::KeyPart& kp)
+{
+    assert(NULL == find(kp));
+
+    /* keep load factor below 7/8 */
+    if (gu_unlikely((size_ + 1) * 8 > slots_.size() * 7))
+    {
+        rehash(slots_.empty() ? MIN_BITS : 64 - shift_ + 1);
+    }
+
+    KeyEntryNG* const kep(new (pool_.acquire()) KeyEntryNG(kp));
+    Slot const s = { head(kp), kp.hash_tail(), kep };
+
+    place(s);
+    ++size_;
+
+    return kep;
+}
+
+
+void
+galera::CertIndexFlat::erase(KeyEntryNG* const kep)
+{
+    size_t idx(locate(kep));
+
+    /* backward shift deletion: no tombstones */
+    for (size_t next((idx + 1) & mask_);
+         NULL != slots_[next].entry_ && distance(slots_[next], next) > 0;
+         idx = next, next = (next + 1) & mask_)
+    {
+        slots_[idx] = slots_[next];
+    }
+
+    slots_[idx].entry_ = NULL;
+    --size_;
+
+    release(kep);
+}
+
+
+void
+galera::CertIndexFlat::clear()
+{
+    for (size_t i(0); i < slots_.size(); ++i)
+    {
+        if (slots_[i].entry_) release(slots_[i].entry_);
+    }
+
+    Slots().swap(slots_);
+    size_  = 0;
+    mask_  = 0;
+    shift_ = 64;
+}
+
+
+size_t
+galera::CertIndexFlat::locate(const KeyEntryNG* const kep) const
+{
+    assert(size_ > 0);
+
+    size_t idx(home(head(kep->key())));
+
+    while (slots_[idx].entry_ != kep)
+    {
+        assert(NULL != slots_[idx].entry_);
+        idx = (idx + 1) & mask_;
+    }
+
+    return idx;
+}
+
+
+void
+galera::CertIndexFlat::place(Slot s)
+{
+    for (size_t idx(home(s.head_)), dist(0); ; idx = (idx + 1) & mask_, ++dist)
+    {
+        Slot& slot(slots_[idx]);
+
+        if (NULL == slot.entry_)
+        {
+            slot = s;
+            return;
+        }
+
+        size_t const slot_dist(distance(slot, idx));
+
+        if (slot_dist < dist)
+        {
+            /* take from the rich: displaced entry continues probing */
+            std::swap(slot, s);
+            dist = slot_dist;
+        }
+    }
+}
+
+
+void
+galera::CertIndexFlat::rehash(size_t const bits)
+{
+    assert(bits >= MIN_BITS && bits < 64);
+
+    Slot const empty = { 0, 0, NULL };
+    Slots old(size_t(1) << bits, empty);
+
+    old.swap(slots_);
+    mask_  = slots_.size() - 1;
+    shift_ = 64 - bits;
+
+    for (size_t i(0); i < old.size(); ++i)
+    {
+        if (old[i].entry_) place(old[i]);
+    }
+}
+
+
+void
+galera::CertIndexFlat::release(KeyEntryNG* const kep)
+{
+    kep->~KeyEntryNG();
+    pool_.recycle(kep);
+}
@@ -0,0 +1,114 @@
+//
+// Copyright (C) 2014 Codership Oy <info@codership.com>
+//
+
+#ifndef GALERA_CERT_INDEX_FLAT_HPP
+#define GALERA_CERT_INDEX_FLAT_HPP
+
+#include "key_entry_ng.hpp"
+
+#include "gu_mem_pool.hpp"
+
+#include <vector>
+
+namespace galera
+{
+    /*!
+     * Open addressing (Robin Hood) hash table of certification key entries.
+     *
+     * Slots are stored in a single contiguous array and keep the key hash
+     * inline, so probing neither chases bucket chains nor touches key
+     * entries and write set buffers until the key is actually found.
+     * Key entries are owned by the index and allocated from a pool.
+     *
+     * Not thread-safe.
+     */
+    class CertIndexFlat
+    {
+    public:
+
+        CertIndexFlat();
+        ~CertIndexFlat();
+
+        /*! @return entry matching kp or NULL if not found */
+        KeyEntryNG* find(const KeySet::KeyPart& kp) const;
+
+        /*! hints the CPU to fetch the home slot of kp */
+        void prefetch(const KeySet::KeyPart& kp) const
+        {
+#if defined(__GNUC__)
+            if (size_ > 0) __builtin_prefetch(&slots_[home(head(kp))]);
+#endif
+        }
+
+        /*! creates an unreferenced entry for kp, which must not be
+         *  in the index yet */
+        KeyEntryNG* insert(const KeySet::KeyPart& kp);
+
+        /*! removes entry from the index and releases it */
+        void erase(KeyEntryNG* kep);
+
+        /*! releases all entries */
+        void clear();
+
+        size_t size()     const { return size_; }
+        size_t capacity() const { return slots_.size(); }
+
+    private:
+
+        struct Slot
+        {
+            uint64_t    head_;  // hash head, LONG_HASH if tail_ is valid
+            uint64_t    tail_;  // hash tail of 16-byte hashes
+            KeyEntryNG* entry_; // NULL if slot is free
+        };
+
+        typedef std::vector<Slot> Slots;
+
+        static uint64_t const LONG_HASH = 1ULL << 63;
+        static size_t   const MIN_BITS  = 6;
+
+        static uint64_t head(const KeySet::KeyPart& kp)
+        {
+            /* hash_head() leaves uppermost bits 0, we use one of them */
+            return (kp.hash_head() |
+                    (kp.version() >= KeySet::FLAT16 ? LONG_HASH : 0));
+        }
+
+        static bool match(const Slot& s, uint64_t head, uint64_t tail)
+        {
+            /* same semantics as KeyPart::matches(): tails are compared
+             * only if both hashes have them */
+            return (((s.head_ ^ head) & ~LONG_HASH) == 0 &&
+                    (!(s.head_ & head & LONG_HASH) || s.tail_ == tail));
+        }
+
+        size_t home(uint64_t head) const
+        {
+            /* Fibonacci hashing: index shards are selected by the lower hash
+             * bits, so slot index should be taken from the upper ones. */
+            return ((head & ~LONG_HASH) * 0x9E3779B97F4A7C15ULL) >> shift_;
+        }
+
+        size_t distance(const Slot& s, size_t idx) const
+        {
+            return ((idx - home(s.head_)) & mask_);
+        }
+
+        size_t locate(const KeyEntryNG* kep) const;
+        void   place(Slot s);
+        void   rehash(size_t bits);
+        void   release(KeyEntryNG* kep);
+
+        Slots               slots_;
+        gu::MemPool<false>  pool_;
+        size_t              size_;
+        size_t              mask_;
+        unsigned int        shift_;
+
+        CertIndexFlat(const CertIndexFlat&);
+        CertIndexFlat& operator=(const CertIndexFlat&);
+    };
+}
+
+#endif // GALERA_CERT_INDEX_FLAT_HPP
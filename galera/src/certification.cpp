@@ -17,6 +17,31 @@ static const bool cert_debug_on(false);
     if (cert_debug_on == false) { }             \
     else log_info << "cert debug: "
 
+namespace
+{
+    /* locks mutex unless it is already held by the caller */
+    class CondLock
+    {
+    public:
+
+        CondLock(gu::Mutex& mtx, bool const locked)
+            : mtx_(mtx), locked_(locked)
+        {
+            if (!locked_) mtx_.lock();
+        }
+
+        ~CondLock() { if (!locked_) mtx_.unlock(); }
+
+    private:
+
+        gu::Mutex& mtx_;
+        bool const locked_;
+
+        CondLock(const CondLock&);
+        CondLock& operator=(const CondLock&);
+    };
+}
+
 #define CERT_PARAM_LOG_CONFLICTS galera::Certification::PARAM_LOG_CONFLICTS
 
 static std::string const CERT_PARAM_PREFIX("cert.");
@@ -28,8 +53,18 @@ static std::string const CERT_PARAM_MAX_LENGTH   (CERT_PARAM_PREFIX +
                                                   "max_length");
 static std::string const CERT_PARAM_LENGTH_CHECK (CERT_PARAM_PREFIX +
                                                   "length_check");
+static std::string const CERT_PARAM_INDEX_TYPE   (CERT_PARAM_PREFIX +
+                                                  "index_type");
+static std::string const CERT_PARAM_PURGE_BUDGET (CERT_PARAM_PREFIX +
+                                                  "purge_budget");
+static std::string const CERT_PARAM_KEY_DEPS_MAX (CERT_PARAM_PREFIX +
+                                                  "key_deps_max");
 
 static std::string const CERT_PARAM_LOG_CONFLICTS_DEFAULT("no");
+static std::string const CERT_PARAM_INDEX_TYPE_DEFAULT   ("unordered");
+static std::string const CERT_INDEX_TYPE_FLAT            ("flat");
+static std::string const CERT_PARAM_PURGE_BUDGET_DEFAULT ("0");
+static std::string const CERT_PARAM_KEY_DEPS_MAX_DEFAULT ("0");
 
 /*** It is EXTREMELY important that these constants are the same on all nodes.
  *** Don't change them ever!!! ***/
@@ -40,6 +75,9 @@ void
 galera::Certification::register_params(gu::Config& cnf)
 {
     cnf.add(CERT_PARAM_LOG_CONFLICTS, CERT_PARAM_LOG_CONFLICTS_DEFAULT);
+    cnf.add(CERT_PARAM_INDEX_TYPE,    CERT_PARAM_INDEX_TYPE_DEFAULT);
+    cnf.add(CERT_PARAM_PURGE_BUDGET,  CERT_PARAM_PURGE_BUDGET_DEFAULT);
+    cnf.add(CERT_PARAM_KEY_DEPS_MAX,  CERT_PARAM_KEY_DEPS_MAX_DEFAULT);
     /* The defaults below are deliberately not reflected in conf: people
      * should not know about these dangerous setting unless they read RTFM. */
     cnf.add(CERT_PARAM_MAX_LENGTH);
@@ -66,6 +104,58 @@ length_check(const gu::Config& conf)
         return gu::Config::from_config<int>(CERT_PARAM_LENGTH_CHECK_DEFAULT);
 }
 
+static size_t
+purge_budget(const gu::Config& conf)
+{
+    long long const budget(conf.get<long long>(CERT_PARAM_PURGE_BUDGET));
+
+    if (budget < 0)
+    {
+        gu_throw_error(EINVAL) << "Bad value " << budget << " for "
+                               << CERT_PARAM_PURGE_BUDGET
+                               << ", must be non-negative";
+    }
+
+    return budget;
+}
+
+/* 0 disables recording of key-level dependencies */
+static int
+key_deps_max(const gu::Config& conf)
+{
+    int const max(conf.get<int>(CERT_PARAM_KEY_DEPS_MAX));
+
+    if (max < 0 || max > galera::TrxHandle::MAX_KEY_DEPS)
+    {
+        gu_throw_error(EINVAL) << "Bad value " << max << " for "
+                               << CERT_PARAM_KEY_DEPS_MAX
+                               << ", must be between 0 and "
+                               << galera::TrxHandle::MAX_KEY_DEPS;
+    }
+
+    return max;
+}
+
+/* v3 index implementation: "unordered" for CertIndexNG,
+ * "flat" for CertIndexFlat */
+static bool
+index_type_flat(const gu::Config& conf)
+{
+    const std::string& type(conf.get(CERT_PARAM_INDEX_TYPE));
+
+    if (type == CERT_INDEX_TYPE_FLAT) return true;
+
+    if (type != CERT_PARAM_INDEX_TYPE_DEFAULT)
+    {
+        gu_throw_error(EINVAL) << "Bad value '" << type << "' for "
+                               << CERT_PARAM_INDEX_TYPE << ", expected '"
+                               << CERT_PARAM_INDEX_TYPE_DEFAULT << "' or '"
+                               << CERT_INDEX_TYPE_FLAT << "'";
+    }
+
+    return false;
+}
+
 void
 galera::Certification::purge_for_trx_v1to2(TrxHandle* trx)
 {
@@ -120,17 +210,17 @@ galera::Certification::purge_for_trx_v3(TrxHandle* trx)
         const KeySet::KeyPart& kp(keys.next());
         KeySet::Key::Prefix const p(kp.prefix());
 
-        KeyEntryNG ke(kp);
-        CertIndexNG::iterator const ci(cert_index_ng_.find(&ke));
+        IndexShard& shard(index_shard(kp));
+        gu::Lock lock(shard.mutex_);
+        KeyEntryNG* const kep(shard.find(kp));
 
-//        assert(ci != cert_index_ng_.end());
-        if (gu_unlikely(cert_index_ng_.end() == ci))
+//        assert(kep != NULL);
+        if (gu_unlikely(NULL == kep))
         {
             log_warn << "Missing key";
             continue;
         }
 
-        KeyEntryNG* const kep(*ci);
         assert(kep->referenced());
 
         if (kep->ref_trx(p) == trx)
@@ -139,13 +229,37 @@ galera::Certification::purge_for_trx_v3(TrxHandle* trx)
 
             if (kep->referenced() == false)
             {
-                cert_index_ng_.erase(ci);
-                delete kep;
+                shard.erase(kep);
             }
         }
     }
 }
 
+size_t
+galera::Certification::index_ng_size() const
+{
+    size_t ret(0);
+
+    for (size_t i(0); i < index_shards_; ++i)
+    {
+        gu::Lock lock(index_ng_[i].mutex_);
+        ret += index_ng_[i].size();
+    }
+
+    return ret;
+}
+
+void
+galera::Certification::index_ng_clear()
+{
+    for (size_t i(0); i < index_shards_; ++i)
+    {
+        IndexShard& shard(index_ng_[i]);
+        gu::Lock lock(shard.mutex_);
+        shard.clear();
+    }
+}
+
 void
 galera::Certification::purge_for_trx(TrxHandle* trx)
 {
@@ -479,6 +593,7 @@ static inline bool
 certify_and_depend_v3(const galera::KeyEntryNG*   const found,
                       const galera::KeySet::KeyPart&    key,
                       galera::TrxHandle*          const trx,
+                      bool                        const escalated,
                       bool                        const log_conflict)
 {
     const galera::TrxHandle* const ref_trx(
@@ -528,50 +643,79 @@ certify_and_depend_v3(const galera::KeyEntryNG*   const found,
             cert_debug << "shared match: "
                        << *trx << " <-----> " << *ref_shared_trx;
 
+            // escalated key covers rows which other write sets reference
+            // only as shared parents. Since only the latest shared ref is
+            // kept, the source can't be checked: any shared ref within cert
+            // range is a conflict.
+            if (escalated &&
+                ref_shared_trx->global_seqno() > trx->last_seen_seqno())
+            {
+                if (gu_unlikely(log_conflict == true))
+                {
+                    log_info << "trx conflict for escalated key " << key
+                             << ": " << *trx << " <--X--> " << *ref_shared_trx;
+                }
+                return true;
+            }
+
             depends_seqno = std::max(ref_shared_trx->global_seqno(),
                                      depends_seqno);
+            // there may be earlier shared refs which are not in the index
+            // and not ordered before this one, so all of them must finish
+            trx->raise_key_deps_floor(ref_shared_trx->global_seqno());
         }
     }
 
+    trx->add_key_dep(ref_seqno);
     trx->set_depends_seqno(std::max(trx->depends_seqno(), depends_seqno));
 
     return false;
 }
 
 
-/* returns true on collision, false otherwise */
-static bool
-certify_v3(galera::Certification::CertIndexNG& cert_index_ng,
-           const galera::KeySet::KeyPart&      key,
-           galera::TrxHandle*                  trx,
-           bool const store_keys, bool const   log_conflicts)
+bool
+galera::Certification::precertify(const TrxHandle* const trx,
+                                  const KeySetIn&        key_set,
+                                  wsrep_seqno_t const    last_seen)
 {
-    galera::KeyEntryNG ke(key);
-    galera::Certification::CertIndexNG::iterator ci(cert_index_ng.find(&ke));
+    assert(trx->new_version());
+
+    if (trx->is_toi() || trx->preordered()) return false;
+
+    key_set.rewind();
 
-    if (cert_index_ng.end() == ci)
+    for (long i(0); i < key_set.count(); ++i)
     {
-        if (store_keys)
-        {
-            galera::KeyEntryNG* const kep(new galera::KeyEntryNG(ke));
-            ci = cert_index_ng.insert(kep).first;
+        const KeySet::KeyPart& key(key_set.next());
+        IndexShard& shard(index_shard(key));
+        gu::Lock lock(shard.mutex_);
+        const KeyEntryNG* const kep(shard.find(key));
+
+        if (NULL == kep) continue;
 
-            cert_debug << "created new entry";
+        // referenced trx can't be purged while shard is locked
+        const TrxHandle* const ref_trx(
+            kep->ref_trx(KeySet::Key::P_EXCLUSIVE));
+
+        // same rule as in certify_and_depend_v3(): ref_trx is already
+        // ordered before trx and will be within its cert range
+        if (ref_trx &&
+            (trx->source_id() != ref_trx->source_id() || ref_trx->is_toi()) &&
+            ref_trx->global_seqno() > last_seen)
+        {
+            if (gu_unlikely(log_conflicts_ == true))
+            {
+                log_info << "local trx conflict for key " << key << ": "
+                         << *trx << " <--X--> " << *ref_trx;
+            }
+            return true;
         }
-        return false;
     }
-    else
-    {
-        cert_debug << "found existing entry";
 
-        galera::KeyEntryNG* const kep(*ci);
-        // Note: For we skip certification for isolated trxs, only
-        // cert index and key_list is populated.
-        return (!trx->is_toi() &&
-                certify_and_depend_v3(kep, key, trx, log_conflicts));
-    }
+    return false;
 }
 
+
 galera::Certification::TestResult
 galera::Certification::do_test_v3(TrxHandle* trx, bool store_keys)
 {
@@ -594,14 +738,37 @@ galera::Certification::do_test_v3(TrxHandle* trx, bool store_keys)
     for (; processed < key_count; ++processed)
     {
         const KeySet::KeyPart& key(key_set.next());
+        IndexShard& shard(index_shard(key));
+        gu::Lock lock(shard.mutex_);
+        KeyEntryNG* const kep(shard.find(key));
+
+        if (NULL == kep)
+        {
+            if (store_keys)
+            {
+                shard.insert(key);
 
-        if (certify_v3(cert_index_ng_, key, trx, store_keys, log_conflicts_))
+                cert_debug << "created new entry";
+            }
+        }
+        else
         {
-            goto cert_fail;
+            cert_debug << "found existing entry";
+
+            // Note: For we skip certification for isolated trxs, only
+            // cert index and key_list is populated.
+            if (!trx->is_toi() &&
+                certify_and_depend_v3(kep, key, trx,
+                                      key_escalation_ && trx->keys_escalated(),
+                                      log_conflicts_))
+            {
+                goto cert_fail;
+            }
         }
     }
 
-    trx->set_depends_seqno(std::max(trx->depends_seqno(), last_pa_unsafe_));
+    /* depends_seqno was initialized and last_pa_unsafe_ is updated
+     * in do_test() */
 
     if (store_keys == true)
     {
@@ -611,23 +778,20 @@ galera::Certification::do_test_v3(TrxHandle* trx, bool store_keys)
         for (long i(0); i < key_count; ++i)
         {
             const KeySet::KeyPart& k(key_set.next());
-            KeyEntryNG ke(k);
-            CertIndexNG::const_iterator ci(cert_index_ng_.find(&ke));
+            IndexShard& shard(index_shard(k));
+            gu::Lock lock(shard.mutex_);
+            KeyEntryNG* kep(shard.find(k));
 
-            if (ci == cert_index_ng_.end())
+            if (gu_unlikely(NULL == kep))
             {
-                gu_throw_fatal << "could not find key '" << k
-                               << "' from cert index";
+                /* shard was not locked between the passes, so the entry
+                 * might have been purged together with its last reference */
+                kep = shard.insert(k);
             }
 
-            KeyEntryNG* const kep(*ci);
-
             kep->ref(k.prefix(), k, trx);
-
         }
 
-        if (trx->pa_unsafe()) last_pa_unsafe_ = trx->global_seqno();
-
         key_count_ += key_count;
     }
     cert_debug << "END CERTIFICATION (success): " << *trx;
@@ -648,34 +812,28 @@ cert_fail:
          * processed key failed cert and was not added to index */
         for (long i(0); i < processed; ++i)
         {
-            KeyEntryNG ke(key_set.next());
+            const KeySet::KeyPart& k(key_set.next());
+            IndexShard& shard(index_shard(k));
+            gu::Lock lock(shard.mutex_);
 
-            // Clean up cert_index_ from entries which were added by this trx
-            CertIndexNG::iterator ci(cert_index_ng_.find(&ke));
+            // Clean up cert index from entries which were added by this trx
+            KeyEntryNG* const kep(shard.find(k));
 
-            if (ci != cert_index_ng_.end())
+            if (kep != NULL)
             {
-                KeyEntryNG* kep(*ci);
-
                 if (kep->referenced() == false)
                 {
-                    // kel was added to cert_index_ by this trx -
-                    // remove from cert_index_ and fall through to delete
-                    cert_index_ng_.erase(ci);
+                    // kel was added to cert index by this trx -
+                    // remove from cert index and release
+                    shard.erase(kep);
                 }
-                else continue;
-
-                assert(kep->referenced() == false);
-
-                delete kep;
-
             }
             else
             {
                 assert(0); // we actually should never be here, the key should
                            // be either added to cert_index_ or be there already
                 log_warn  << "could not find key '"
-                          << ke.key() << "' from cert index";
+                          << k << "' from cert index";
             }
         }
         assert(cert_index_.size() == prev_cert_index_size);
@@ -684,8 +842,24 @@ cert_fail:
     return TEST_FAILED;
 }
 
+/* must be called under mutex_ */
+void
+galera::Certification::init_depends_seqno(TrxHandle* trx) const
+{
+    /* initialize parent seqno */
+    if ((trx->flags() & (TrxHandle::F_ISOLATION | TrxHandle::F_PA_UNSAFE))
+        || trx_map_.empty())
+    {
+        trx->set_depends_seqno(trx->global_seqno() - 1);
+    }
+    else
+    {
+        trx->set_depends_seqno(trx_map_.front()->global_seqno() - 1);
+    }
+}
+
 galera::Certification::TestResult
-galera::Certification::do_test(TrxHandle* trx, bool store_keys)
+galera::Certification::do_test(TrxHandle* trx, bool store_keys, bool locked)
 {
     if (trx->version() != version_)
     {
@@ -722,30 +896,43 @@ galera::Certification::do_test(TrxHandle* trx, bool store_keys)
 
     TestResult res(TEST_FAILED);
 
-    gu::Lock lock(mutex_); // why do we need that? certification access
-                           // must be fully guarded by the local_monitor_
-
-    /* initialize parent seqno */
-    if ((trx->flags() & (TrxHandle::F_ISOLATION | TrxHandle::F_PA_UNSAFE))
-        || trx_map_.empty())
-    {
-        trx->set_depends_seqno(trx->global_seqno() - 1);
-    }
-    else
-    {
-        trx->set_depends_seqno(
-            trx_map_.begin()->second->global_seqno() - 1);
-    }
-
     switch (version_)
     {
     case 1:
     case 2:
+    {
+        CondLock lock(mutex_, locked); // cert_index_ is not sharded
+        init_depends_seqno(trx);
         res = do_test_v1to2(trx, store_keys);
         break;
+    }
     case 3:
+    {
+        // Appending certification is ordered by the local_monitor_, mutex_
+        // here only protects trx_map_ and last_pa_unsafe_. Index shards are
+        // locked separately in do_test_v3().
+        {
+            CondLock lock(mutex_, locked);
+            init_depends_seqno(trx);
+            trx->set_depends_seqno(std::max(trx->depends_seqno(),
+                                            last_pa_unsafe_));
+        }
+
+        if (key_deps_max_ > 0 && !(trx->flags() & (TrxHandle::F_ISOLATION |
+                                                   TrxHandle::F_PA_UNSAFE)))
+        {
+            trx->init_key_deps(trx->depends_seqno(), key_deps_max_);
+        }
+
         res = do_test_v3(trx, store_keys);
+
+        if (store_keys == true && res == TEST_OK && trx->pa_unsafe())
+        {
+            CondLock lock(mutex_, locked);
+            last_pa_unsafe_ = trx->global_seqno();
+        }
         break;
+    }
     default:
         gu_throw_fatal << "certification test for version "
                        << version_ << " not implemented";
@@ -757,7 +944,7 @@ galera::Certification::do_test(TrxHandle* trx, bool store_keys)
         ++n_certified_;
         deps_dist_ += (trx->global_seqno() - trx->depends_seqno());
         cert_interval_ += (trx->global_seqno() - trx->last_seen_seqno() - 1);
-        index_size_ = (cert_index_.size() + cert_index_ng_.size());
+        index_size_ = cert_index_.size();
     }
 
     return res;
@@ -803,9 +990,10 @@ galera::Certification::do_test_preordered(TrxHandle* trx)
 galera::Certification::Certification(gu::Config& conf, ServiceThd& thd)
     :
     version_               (-1),
+    key_escalation_        (false),
     trx_map_               (),
     cert_index_            (),
-    cert_index_ng_         (),
+    index_ng_              (),
     deps_set_              (),
     service_thd_           (thd),
     mutex_                 (),
@@ -814,6 +1002,9 @@ galera::Certification::Certification(gu::Config& conf, ServiceThd& thd)
     position_              (-1),
     safe_to_discard_seqno_ (-1),
     last_pa_unsafe_        (-1),
+    purge_seqno_           (-1),
+    purge_gcache_          (-1),
+    gcache_released_       (-1),
     last_preordered_seqno_ (position_),
     last_preordered_id_    (0),
     stats_mutex_           (),
@@ -825,8 +1016,16 @@ galera::Certification::Certification(gu::Config& conf, ServiceThd& thd)
 
     max_length_            (max_length(conf)),
     max_length_check_      (length_check(conf)),
+    purge_budget_          (purge_budget(conf)),
+    key_deps_max_          (key_deps_max(conf)),
+    index_flat_            (index_type_flat(conf)),
     log_conflicts_         (conf.get<bool>(CERT_PARAM_LOG_CONFLICTS))
-{}
+{
+    for (size_t i(0); i < index_shards_; ++i)
+    {
+        index_ng_[i].set_flat(index_flat_);
+    }
+}
 
 
 galera::Certification::~Certification()
@@ -838,7 +1037,8 @@ galera::Certification::~Certification()
     double avg_cert_interval(0);
     double avg_deps_dist(0);
     size_t index_size(0);
-    stats_get(avg_cert_interval, avg_deps_dist, index_size);
+    size_t deps_window(0);
+    stats_get(avg_cert_interval, avg_deps_dist, index_size, deps_window);
     log_info << "avg deps dist "              << avg_deps_dist;
     log_info << "avg cert interval "          << avg_cert_interval;
     log_info << "cert index size "            << index_size;
@@ -852,7 +1052,8 @@ galera::Certification::~Certification()
 
 
 void galera::Certification::assign_initial_position(wsrep_seqno_t seqno,
-                                                    int           version)
+                                                    int           version,
+                                                    bool const    key_escalation)
 {
     switch (version)
     {
@@ -874,7 +1075,7 @@ void galera::Certification::assign_initial_position(wsrep_seqno_t seqno,
     {
         std::for_each(trx_map_.begin(), trx_map_.end(), PurgeAndDiscard(*this));
         assert(cert_index_.size() == 0);
-        assert(cert_index_ng_.size() == 0);
+        assert(index_ng_size() == 0);
     }
     else
     {
@@ -882,12 +1083,12 @@ void galera::Certification::assign_initial_position(wsrep_seqno_t seqno,
                  << seqno;
         std::for_each(cert_index_.begin(), cert_index_.end(),
                       gu::DeleteObject());
-        std::for_each(cert_index_ng_.begin(), cert_index_ng_.end(),
-                      gu::DeleteObject());
-        std::for_each(trx_map_.begin(), trx_map_.end(),
-                      Unref2nd<TrxMap::value_type>());
+        index_ng_clear();
+        for (TrxMap::iterator i(trx_map_.begin()); i != trx_map_.end(); ++i)
+        {
+            if (*i) (*i)->unref();
+        }
         cert_index_.clear();
-        cert_index_ng_.clear();
     }
 
     trx_map_.clear();
@@ -901,19 +1102,31 @@ void galera::Certification::assign_initial_position(wsrep_seqno_t seqno,
     position_              = seqno;
     safe_to_discard_seqno_ = seqno;
     last_pa_unsafe_        = seqno;
+    purge_seqno_           = -1;
+    purge_gcache_          = -1;
+    gcache_released_       = -1;
     last_preordered_seqno_ = position_;
     last_preordered_id_    = 0;
     version_               = version;
+    key_escalation_        = key_escalation;
 }
 
 
 galera::Certification::TestResult
 galera::Certification::test(TrxHandle* trx, bool bval)
+{
+    return test_(trx, bval, false);
+}
+
+
+galera::Certification::TestResult
+galera::Certification::test_(TrxHandle* trx, bool store_keys, bool locked)
 {
     assert(trx->global_seqno() >= 0 && trx->local_seqno() >= 0);
 
     const TestResult ret
-        (trx->preordered() ? do_test_preordered(trx) : do_test(trx, bval));
+        (trx->preordered() ? do_test_preordered(trx) :
+         do_test(trx, store_keys, locked));
 
     if (gu_unlikely(ret != TEST_OK))
     {
@@ -935,7 +1148,7 @@ wsrep_seqno_t galera::Certification::get_safe_to_discard_seqno_() const
     }
     else
     {
-        retval = (*deps_set_.begin()) - 1;
+        retval = deps_set_.front() - 1;
     }
     return retval;
 }
@@ -947,12 +1160,15 @@ galera::Certification::purge_trxs_upto_(wsrep_seqno_t const seqno,
 {
     assert (seqno > 0);
 
-    TrxMap::iterator purge_bound(trx_map_.upper_bound(seqno));
-
     cert_debug << "purging index up to " << seqno;
 
-    for_each(trx_map_.begin(), purge_bound, PurgeAndDiscard(*this));
-    trx_map_.erase(trx_map_.begin(), purge_bound);
+    PurgeAndDiscard const purge(*this);
+
+    while (!trx_map_.empty() && trx_map_.index_front() <= seqno)
+    {
+        purge(trx_map_.front());
+        trx_map_.pop_front();
+    }
 
     if (handle_gcache) service_thd_.release_seqno(seqno);
 
@@ -960,15 +1176,81 @@ galera::Certification::purge_trxs_upto_(wsrep_seqno_t const seqno,
     {
         log_debug << "trx map after purge: length: " << trx_map_.size()
                   << ", requested purge seqno: " << seqno
-                  << ", real purge seqno: " << trx_map_.begin()->first - 1;
+                  << ", real purge seqno: " << trx_map_.index_begin() - 1;
     }
 
     return seqno;
 }
 
 
-galera::Certification::TestResult
-galera::Certification::append_trx(TrxHandle* trx)
+wsrep_seqno_t
+galera::Certification::purge_trxs_upto(wsrep_seqno_t const seqno,
+                                       bool const          handle_gcache)
+{
+    gu::Lock lock(mutex_);
+    const wsrep_seqno_t stds(get_safe_to_discard_seqno_());
+    // assert(seqno <= get_safe_to_discard_seqno());
+    // Note: setting trx committed is not done in total order so
+    // safe to discard seqno may decrease. Enable assertion above when
+    // this issue is fixed.
+    wsrep_seqno_t const purge_seqno(std::min(seqno, stds));
+
+    if (0 == purge_budget_)
+    {
+        return purge_trxs_upto_(purge_seqno, handle_gcache);
+    }
+
+    if (purge_seqno > purge_seqno_) purge_seqno_ = purge_seqno;
+
+    /* only the caller's own range may be released from gcache */
+    if (handle_gcache && purge_seqno > purge_gcache_)
+    {
+        purge_gcache_ = purge_seqno;
+    }
+
+    purge_step_();
+
+    return (trx_map_.empty() ? purge_seqno :
+            std::min(purge_seqno, trx_map_.index_front() - 1));
+}
+
+
+/* Purges at most purge_budget_ trxs towards purge_seqno_ and releases
+ * gcache up to what was actually purged, but not above purge_gcache_.
+ * Must be called under mutex_. */
+void
+galera::Certification::purge_step_()
+{
+    PurgeAndDiscard const purge(*this);
+    size_t n(0);
+
+    while (n < purge_budget_ &&
+           !trx_map_.empty() && trx_map_.index_front() <= purge_seqno_)
+    {
+        purge(trx_map_.front());
+        trx_map_.pop_front();
+        ++n;
+    }
+
+    if (purge_gcache_ > 0)
+    {
+        wsrep_seqno_t const purged(trx_map_.empty() ? purge_seqno_ :
+                                   std::min(purge_seqno_,
+                                            trx_map_.index_front() - 1));
+        wsrep_seqno_t const release(std::min(purged, purge_gcache_));
+
+        if (release > gcache_released_)
+        {
+            service_thd_.release_seqno(release);
+            gcache_released_ = release;
+        }
+    }
+}
+
+
+/* must be called under mutex_ */
+void
+galera::Certification::append_begin_(TrxHandle* trx)
 {
     // todo: enable when source id bug is fixed
     assert(trx->source_id() != WSREP_UUID_UNDEFINED);
@@ -976,62 +1258,109 @@ galera::Certification::append_trx(TrxHandle* trx)
     assert(trx->global_seqno() > position_);
 
     trx->ref();
+
+    if (gu_unlikely(trx->global_seqno() != position_ + 1))
     {
-        gu::Lock lock(mutex_);
+        // this is perfectly normal if trx is rolled back just after
+        // replication, keeping the log though
+        log_debug << "seqno gap, position: " << position_
+                  << " trx seqno " << trx->global_seqno();
+    }
 
-        if (gu_unlikely(trx->global_seqno() != position_ + 1))
+    if (gu_unlikely(!trx_map_.empty() &&
+                    (trx->last_seen_seqno() + 1) < trx_map_.index_begin()))
+    {
+        /* See #733 - for now it is false positive */
+        cert_debug
+            << "WARNING: last_seen_seqno is below certification index: "
+            << trx_map_.index_begin() << " > " << trx->last_seen_seqno();
+    }
+
+    position_ = trx->global_seqno();
+
+    if (!trx_map_.empty() && trx_map_.index_front() <= purge_seqno_)
+    {
+        purge_step_();
+    }
+
+    if (gu_unlikely(!(position_ & max_length_check_) &&
+                    (trx_map_.size() > static_cast<size_t>(max_length_))))
+    {
+        log_debug << "trx map size: " << trx_map_.size()
+                  << " - check if status.last_committed is incrementing";
+
+        wsrep_seqno_t       trim_seqno(position_ - max_length_);
+        wsrep_seqno_t const stds      (get_safe_to_discard_seqno_());
+
+        if (trim_seqno > stds)
         {
-            // this is perfectly normal if trx is rolled back just after
-            // replication, keeping the log though
-            log_debug << "seqno gap, position: " << position_
-                      << " trx seqno " << trx->global_seqno();
+            log_warn << "Attempt to trim certification index at "
+                     << trim_seqno << ", above safe-to-discard: " << stds;
+            trim_seqno = stds;
         }
-
-        if (gu_unlikely((trx->last_seen_seqno() + 1) < trx_map_.begin()->first))
+        else
         {
-            /* See #733 - for now it is false positive */
-            cert_debug
-                << "WARNING: last_seen_seqno is below certification index: "
-                << trx_map_.begin()->first << " > " << trx->last_seen_seqno();
+            cert_debug << "purging index up to " << trim_seqno;
         }
 
-        position_ = trx->global_seqno();
+        purge_trxs_upto_(trim_seqno, true);
+    }
+}
+
 
-        if (gu_unlikely(!(position_ & max_length_check_) &&
-                        (trx_map_.size() > static_cast<size_t>(max_length_))))
-        {
-            log_debug << "trx map size: " << trx_map_.size()
-                      << " - check if status.last_committed is incrementing";
+/* must be called under mutex_ */
+void
+galera::Certification::append_end_(TrxHandle* trx)
+{
+    if (trx_map_.at(trx->global_seqno()) != NULL)
+        gu_throw_fatal << "duplicate trx entry " << *trx;
 
-            wsrep_seqno_t       trim_seqno(position_ - max_length_);
-            wsrep_seqno_t const stds      (get_safe_to_discard_seqno_());
+    trx_map_.insert(trx->global_seqno(), trx);
 
-            if (trim_seqno > stds)
-            {
-                log_warn << "Attempt to trim certification index at "
-                         << trim_seqno << ", above safe-to-discard: " << stds;
-                trim_seqno = stds;
-            }
-            else
-            {
-                cert_debug << "purging index up to " << trim_seqno;
-            }
+    deps_set_.insert(trx->last_seen_seqno());
+    assert(deps_set_.size() <= trx_map_.size());
+}
 
-            purge_trxs_upto_(trim_seqno, true);
-        }
+
+/* Issues prefetches for index slots of trx keys, so that they are likely
+ * to be in cache by the time trx is certified. Each shard is locked, as
+ * it may be resized by concurrent purge. Only CertIndexFlat prefetches. */
+void
+galera::Certification::prefetch_keys_(TrxHandle* trx)
+{
+    if (!index_flat_ || version_ < 3 || trx->version() != version_ ||
+        trx->preordered())
+        return;
+
+    const KeySetIn& key_set(trx->write_set_in().keyset());
+    long const      key_count(key_set.count());
+
+    key_set.rewind();
+
+    for (long i(0); i < key_count; ++i)
+    {
+        const KeySet::KeyPart& kp(key_set.next());
+        IndexShard&            shard(index_shard(kp));
+        gu::Lock               lock(shard.mutex_);
+
+        shard.prefetch(kp);
     }
+}
 
-    const TestResult retval(test(trx));
 
+galera::Certification::TestResult
+galera::Certification::append_trx(TrxHandle* trx)
+{
     {
         gu::Lock lock(mutex_);
+        append_begin_(trx);
+    }
 
-        if (trx_map_.insert(
-                std::make_pair(trx->global_seqno(), trx)).second == false)
-            gu_throw_fatal << "duplicate trx entry " << *trx;
+    const TestResult retval(test(trx));
 
-        deps_set_.insert(trx->last_seen_seqno());
-        assert(deps_set_.size() <= trx_map_.size());
+    {
+        gu::Lock lock(mutex_);
+        append_end_(trx);
     }
 
     trx->mark_certified();
@@ -1040,6 +1369,37 @@ galera::Certification::append_trx(TrxHandle* trx)
 }
 
 
+void
+galera::Certification::append_trxs(TrxHandle* const* const trxs,
+                                   size_t const            n,
+                                   TestResult* const       results)
+{
+    if (0 == n) return;
+
+    prefetch_keys_(trxs[0]);
+
+    {
+        gu::Lock lock(mutex_);
+
+        for (size_t i(0); i < n; ++i)
+        {
+            TrxHandle* const trx(trxs[i]);
+
+            append_begin_(trx);
+
+            /* next trx keys are fetched while this one is being certified */
+            if (i + 1 < n) prefetch_keys_(trxs[i + 1]);
+
+            results[i] = test_(trx, true, true);
+
+            append_end_(trx);
+        }
+    }
+
+    for (size_t i(0); i < n; ++i) trxs[i]->mark_certified();
+}
+
+
 wsrep_seqno_t galera::Certification::set_trx_committed(TrxHandle* trx)
 {
     assert(trx->global_seqno() >= 0 && trx->local_seqno() >= 0 &&
@@ -1052,12 +1412,11 @@ wsrep_seqno_t galera::Certification::set_trx_committed(TrxHandle* trx)
         {
             // trxs with depends_seqno == -1 haven't gone through
             // append_trx
-            DepsSet::iterator i(deps_set_.find(trx->last_seen_seqno()));
-            assert(i != deps_set_.end());
+            wsrep_seqno_t const last_seen(trx->last_seen_seqno());
 
-            if (deps_set_.size() == 1) safe_to_discard_seqno_ = *i;
+            if (deps_set_.size() == 1) safe_to_discard_seqno_ = last_seen;
 
-            deps_set_.erase(i);
+            deps_set_.erase(last_seen);
         }
 
         if (gu_unlikely(index_purge_required()))
@@ -1075,13 +1434,13 @@ wsrep_seqno_t galera::Certification::set_trx_committed(TrxHandle* trx)
 galera::TrxHandle* galera::Certification::get_trx(wsrep_seqno_t seqno)
 {
     gu::Lock lock(mutex_);
-    TrxMap::iterator i(trx_map_.find(seqno));
+    TrxHandle* const trx(trx_map_.at(seqno));
 
-    if (i == trx_map_.end()) return 0;
+    if (NULL == trx) return 0;
 
-    i->second->ref();
+    trx->ref();
 
-    return i->second;
+    return trx;
 }
 
 void
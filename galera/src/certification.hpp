@@ -7,15 +7,20 @@
 
 #include "trx_handle.hpp"
 #include "key_entry_ng.hpp"
+#include "cert_index_flat.hpp"
 #include "galera_service_thd.hpp"
 
 #include "gu_unordered.hpp"
+#include "gu_deqmap.hpp"
 #include "gu_lock.hpp"
 #include "gu_config.hpp"
+#include "gu_utils.hpp" // gu::DeleteObject
 
 #include <map>
 #include <set>
 #include <list>
+#include <vector>
+#include <algorithm>
 
 namespace galera
 {
@@ -36,9 +41,7 @@ namespace galera
 
     private:
 
-        typedef std::multiset<wsrep_seqno_t>        DepsSet;
-
-        typedef std::map<wsrep_seqno_t, TrxHandle*> TrxMap;
+        typedef gu::DeqMap<wsrep_seqno_t, TrxHandle*> TrxMap;
 
     public:
 
@@ -51,10 +54,31 @@ namespace galera
         Certification(gu::Config& conf, ServiceThd& thd);
         ~Certification();
 
-        void assign_initial_position(wsrep_seqno_t seqno, int versiono);
+        // key_escalation: honour WriteSetNG::F_ESCALATED, must be the same
+        // on all nodes
+        void assign_initial_position(wsrep_seqno_t seqno, int versiono,
+                                     bool key_escalation = false);
         TestResult append_trx(TrxHandle*);
+
+        // Certify and append n consecutive trxs in order under a single
+        // mutex_ hold. Equivalent to calling append_trx() for each of them,
+        // results are stored in the results array.
+        void append_trxs(TrxHandle* const* trxs, size_t n,
+                         TestResult* results);
+
         TestResult test(TrxHandle*, bool = true);
+
+        // Read-only probe of the index for a local trx which is about to be
+        // replicated with the given last seen seqno. Returns true if some of
+        // the keys were modified by a conflicting trx, which means the trx
+        // is likely to fail certification. This is a heuristic: it does not
+        // detect all conflicts, and a conflicting entry may be purged from
+        // the index before trx is certified, so certification could still
+        // pass.
+        bool precertify(const TrxHandle* trx, const KeySetIn& key_set,
+                        wsrep_seqno_t last_seen);
         wsrep_seqno_t position() const { return position_; }
+        bool key_deps() const { return key_deps_max_ > 0; }
 
         wsrep_seqno_t
         get_safe_to_discard_seqno() const
@@ -63,17 +87,12 @@ namespace galera
             return get_safe_to_discard_seqno_();
         }
 
+        // Purge index up to seqno. If cert.purge_budget is set, only the
+        // budgeted number of trxs is purged right away, the rest is purged
+        // incrementally by subsequent append_trx() calls. Returns the seqno
+        // up to which the index is actually purged.
         wsrep_seqno_t
-        purge_trxs_upto(wsrep_seqno_t const seqno, bool const handle_gcache)
-        {
-            gu::Lock lock(mutex_);
-            const wsrep_seqno_t stds(get_safe_to_discard_seqno_());
-            // assert(seqno <= get_safe_to_discard_seqno());
-            // Note: setting trx committed is not done in total order so
-            // safe to discard seqno may decrease. Enable assertion above when
-            // this issue is fixed.
-            return purge_trxs_upto_(std::min(seqno, stds), handle_gcache);
-        }
+        purge_trxs_upto(wsrep_seqno_t seqno, bool handle_gcache);
 
         // Set trx corresponding to handle committed. Return purge seqno if
         // index purge is required, -1 otherwise.
@@ -83,8 +102,16 @@ namespace galera
         // statistics section
         void stats_get(double& avg_cert_interval,
                        double& avg_deps_dist,
-                       size_t& index_size) const
+                       size_t& index_size,
+                       size_t& deps_window) const
         {
+            size_t const index_ng_size(this->index_ng_size());
+
+            {
+                gu::Lock lock(mutex_);
+                deps_window = deps_set_.window();
+            }
+
             gu::Lock lock(stats_mutex_);
             avg_cert_interval = 0;
             avg_deps_dist = 0;
@@ -93,7 +120,7 @@ namespace galera
                 avg_cert_interval = double(cert_interval_) / n_certified_;
                 avg_deps_dist = double(deps_dist_) / n_certified_;
             }
-            index_size = index_size_;
+            index_size = index_size_ + index_ng_size;
         }
 
         void stats_reset()
@@ -118,7 +145,190 @@ namespace galera
 
     private:
 
-        TestResult do_test(TrxHandle*, bool);
+        /* Multiset of last seen seqnos of certified, but not yet committed
+         * trxs: reference counts in a seqno window [front, back] stored in
+         * a preallocated ring.
+         * Last seen seqnos come from different nodes and do not arrive in
+         * order. Insert and erase inside the window are O(1), insert
+         * outside it zeroes the gap and erase at the window edge skips
+         * zero counts, both amortized O(1) as every slot is zeroed and
+         * skipped once. The window never exceeds the span of last seen
+         * seqnos of uncommitted trxs, which is bounded by certification
+         * interval, so the ring is reallocated (doubled) only if that span
+         * outgrows it and never in steady state. */
+        class DepsSet
+        {
+        public:
+
+            DepsSet() : refs_(INITIAL_SIZE, 0), front_(0), back_(-1), size_(0)
+            { }
+
+            void insert(wsrep_seqno_t const seqno)
+            {
+                if (gu_unlikely(0 == size_))
+                {
+                    front_ = back_ = seqno;
+                    slot(seqno) = 0;
+                }
+                else if (seqno > back_)
+                {
+                    reserve(seqno - front_ + 1);
+                    while (back_ < seqno) slot(++back_) = 0;
+                }
+                else if (seqno < front_)
+                {
+                    reserve(back_ - seqno + 1);
+                    while (front_ > seqno) slot(--front_) = 0;
+                }
+
+                ++slot(seqno);
+                ++size_;
+            }
+
+            void erase(wsrep_seqno_t const seqno)
+            {
+                assert(seqno >= front_ && seqno <= back_);
+                assert(slot(seqno) > 0);
+
+                --size_;
+
+                if (0 == --slot(seqno) && size_ > 0)
+                {
+                    while (0 == slot(front_)) ++front_;
+                    while (0 == slot(back_))  --back_;
+                }
+            }
+
+            /* smallest seqno in the set */
+            wsrep_seqno_t front() const { assert(size_ > 0); return front_; }
+
+            bool   empty()  const { return 0 == size_; }
+            size_t size()   const { return size_; }
+            size_t window() const { return size_ ? back_ - front_ + 1 : 0; }
+
+        private:
+
+            enum { INITIAL_SIZE = 1 << 12 }; // must be a power of 2
+
+            size_t& slot(wsrep_seqno_t const seqno)
+            {
+                return refs_[seqno & (refs_.size() - 1)];
+            }
+
+            size_t slot(wsrep_seqno_t const seqno) const
+            {
+                return refs_[seqno & (refs_.size() - 1)];
+            }
+
+            /* makes room for a window of n seqnos */
+            void reserve(size_t const n)
+            {
+                if (gu_likely(n <= refs_.size())) return;
+
+                size_t size(refs_.size());
+                while (size < n) size <<= 1;
+
+                std::vector<size_t> refs(size, 0);
+                for (wsrep_seqno_t s(front_); s <= back_; ++s)
+                {
+                    refs[s & (size - 1)] = slot(s);
+                }
+
+                refs_.swap(refs);
+            }
+
+            std::vector<size_t> refs_;
+            wsrep_seqno_t       front_;
+            wsrep_seqno_t       back_;
+            size_t              size_;
+        };
+
+        /* v3 certification index partitioned by key hash. Each shard is
+         * guarded by its own mutex, so v3 certification and index purging
+         * don't need mutex_ for key lookups and inserts.
+         * Depending on cert.index_type the shard uses either CertIndexNG or
+         * CertIndexFlat, methods below hide the difference. */
+        class IndexShard
+        {
+        public:
+
+            IndexShard() : mutex_(), index_(), flat_(), use_flat_(false) { }
+
+            void set_flat(bool val) { assert(size() == 0); use_flat_ = val; }
+
+            KeyEntryNG* find(const KeySet::KeyPart& kp) const
+            {
+                if (use_flat_) return flat_.find(kp);
+
+                KeyEntryNG ke(kp);
+                CertIndexNG::const_iterator const ci(index_.find(&ke));
+                return (ci != index_.end() ? *ci : NULL);
+            }
+
+            /* creates new unreferenced entry for kp */
+            KeyEntryNG* insert(const KeySet::KeyPart& kp)
+            {
+                if (use_flat_) return flat_.insert(kp);
+
+                KeyEntryNG* const kep(new KeyEntryNG(kp));
+                index_.insert(kep);
+                return kep;
+            }
+
+            /* hints the CPU to fetch index memory for kp. Reads index
+             * size and slots, so mutex_ must be held as for other methods. */
+            void prefetch(const KeySet::KeyPart& kp) const
+            {
+                if (use_flat_) flat_.prefetch(kp);
+            }
+
+            void erase(KeyEntryNG* const kep)
+            {
+                if (use_flat_) return flat_.erase(kep);
+
+                index_.erase(index_.find(kep));
+                delete kep;
+            }
+
+            size_t size() const
+            {
+                return (use_flat_ ? flat_.size() : index_.size());
+            }
+
+            void clear()
+            {
+                if (use_flat_) return flat_.clear();
+
+                std::for_each(index_.begin(), index_.end(),
+                              gu::DeleteObject());
+                index_.clear();
+            }
+
+            gu::Mutex     mutex_;
+
+        private:
+
+            CertIndexNG   index_;
+            CertIndexFlat flat_;
+            bool          use_flat_;
+
+            IndexShard(const IndexShard&);
+            void operator=(const IndexShard&);
+        };
+
+        static size_t const index_shards_ = (1UL << 4); // must be power of 2
+
+        IndexShard& index_shard(const KeySet::KeyPart& kp)
+        {
+            return index_ng_[kp.hash() & (index_shards_ - 1)];
+        }
+
+        size_t index_ng_size() const;
+        void   index_ng_clear();
+
+        void       init_depends_seqno(TrxHandle*) const;
+        TestResult test_(TrxHandle*, bool store_keys, bool locked);
+        TestResult do_test(TrxHandle*, bool store_keys, bool locked);
         TestResult do_test_v1to2(TrxHandle*, bool);
         TestResult do_test_v3(TrxHandle*, bool);
         TestResult do_test_preordered(TrxHandle*);
@@ -129,6 +339,10 @@ namespace galera
         // unprotected variants for internal use
         wsrep_seqno_t get_safe_to_discard_seqno_() const;
         wsrep_seqno_t purge_trxs_upto_(wsrep_seqno_t, bool sync);
+        void          purge_step_();
+        void          append_begin_(TrxHandle*);
+        void          append_end_(TrxHandle*);
+        void          prefetch_keys_(TrxHandle*);
 
         class PurgeAndDiscard
         {
@@ -136,10 +350,11 @@ namespace galera
 
             PurgeAndDiscard(Certification& cert) : cert_(cert) { }
 
-            void operator()(TrxMap::value_type& vt) const
+            void operator()(TrxHandle* const trx) const
             {
+                if (NULL == trx) return; // seqno gap
+
                 {
-                    TrxHandle* trx(vt.second);
                     TrxHandleLock lock(*trx);
 
                     if (trx->is_committed() == false)
@@ -159,7 +374,7 @@ namespace galera
                                   << " refcnt " << trx->refcnt();
                     }
                 }
-                vt.second->unref();
+                trx->unref();
             }
 
             PurgeAndDiscard(const PurgeAndDiscard& other) : cert_(other.cert_)
@@ -172,9 +387,10 @@ namespace galera
         };
 
         int           version_;
+        bool          key_escalation_;
         TrxMap        trx_map_;
         CertIndex     cert_index_;
-        CertIndexNG   cert_index_ng_;
+        IndexShard    index_ng_[index_shards_];
         DepsSet       deps_set_;
         ServiceThd&   service_thd_;
         gu::Mutex     mutex_;
@@ -183,13 +399,16 @@ namespace galera
         wsrep_seqno_t position_;
         wsrep_seqno_t safe_to_discard_seqno_;
         wsrep_seqno_t last_pa_unsafe_;
+        wsrep_seqno_t purge_seqno_;  // pending incremental purge target
+        wsrep_seqno_t purge_gcache_; // gcache may be released up to this
+        wsrep_seqno_t gcache_released_; // last seqno released by purge_step_
         wsrep_seqno_t last_preordered_seqno_;
         wsrep_trx_id_t last_preordered_id_;
         gu::Mutex     stats_mutex_;
         size_t        n_certified_;
         wsrep_seqno_t deps_dist_;
         wsrep_seqno_t cert_interval_;
-        size_t        index_size_;
+        size_t        index_size_; // cert_index_ only, see index_ng_size()
 
         gu::Atomic<long>    key_count_;
 
@@ -202,6 +421,11 @@ namespace galera
 
         unsigned int const max_length_check_; /* Mask how often to check */
         static int   const purge_interval_ = (1UL<<10);
+        size_t       const purge_budget_; /* Max trxs to purge at once,
+                                           * 0 - unlimited */
+        int          const key_deps_max_; /* Max key-level dependencies
+                                           * recorded per trx, 0 - none */
+        bool         const index_flat_;   /* index shards use CertIndexFlat */
 
         bool               log_conflicts_;
     };
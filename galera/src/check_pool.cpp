@@ -0,0 +1,127 @@
+//
+// Copyright (C) 2014 Codership Oy <info@codership.com>
+//
+
+#include "check_pool.hpp"
+
+#include <algorithm>
+
+galera::CheckPool* galera::CheckPool::default_ = NULL;
+
+void*
+galera::CheckPool::thd_func(void* arg)
+{
+    CheckPool* const pool(static_cast<CheckPool*>(arg));
+    gu::Lock lock(pool->mtx_);
+
+    for (;;)
+    {
+        while (pool->queue_.empty() && !pool->exit_) lock.wait(pool->cond_);
+
+        if (pool->queue_.empty()) break; // exit and nothing left to do
+
+        Job* const job(pool->queue_.front());
+        pool->queue_.pop_front();
+
+        assert(Job::S_QUEUED == job->state_);
+        job->state_ = Job::S_RUNNING;
+
+        pool->mtx_.unlock();
+        job->func_(job->arg_);
+        pool->mtx_.lock();
+
+        job->state_ = Job::S_DONE;
+        pool->done_.broadcast();
+    }
+
+    return NULL;
+}
+
+galera::CheckPool::CheckPool(int const threads)
+    :
+    mtx_    (),
+    cond_   (),
+    done_   (),
+    queue_  (),
+    threads_(),
+    exit_   (false)
+{
+    threads_.reserve(std::max(threads, 0));
+
+    for (int i(0); i < threads; ++i)
+    {
+        gu_thread_t thd;
+        int const err(gu_thread_create(&thd, NULL, thd_func, this));
+
+        if (gu_unlikely(0 != err))
+        {
+            log_warn << "Failed to start checksum thread " << i << ": "
+                     << err << " (" << ::strerror(err) << ')';
+            break;
+        }
+
+        threads_.push_back(thd);
+    }
+}
+
+galera::CheckPool::~CheckPool()
+{
+    {
+        gu::Lock lock(mtx_);
+        exit_ = true;
+        cond_.broadcast();
+    }
+
+    for (size_t i(0); i < threads_.size(); ++i)
+    {
+        gu_thread_join(threads_[i], NULL);
+    }
+
+    assert(queue_.empty());
+}
+
+bool
+galera::CheckPool::submit(Job& job)
+{
+    assert(Job::S_NONE == job.state_);
+
+    gu::Lock lock(mtx_);
+
+    if (gu_unlikely(threads_.empty() || exit_)) return false;
+
+    job.state_ = Job::S_QUEUED;
+    queue_.push_back(&job);
+    cond_.signal();
+
+    return true;
+}
+
+void
+galera::CheckPool::wait(Job& job)
+{
+    gu::Lock lock(mtx_);
+
+    switch (job.state_)
+    {
+    case Job::S_QUEUED:
+    {
+        std::deque<Job*>::iterator const i
+            (std::find(queue_.begin(), queue_.end(), &job));
+        assert(i != queue_.end());
+        queue_.erase(i);
+        job.state_ = Job::S_RUNNING;
+        break;
+    }
+    case Job::S_RUNNING:
+        while (Job::S_DONE != job.state_) lock.wait(done_);
+        /* fall through */
+    default:
+        return;
+    }
+
+    mtx_.unlock();
+    job.func_(job.arg_);
+    mtx_.lock();
+
+    job.state_ = Job::S_DONE;
+}
@@ -0,0 +1,95 @@
+//
+// Copyright (C) 2014 Codership Oy <info@codership.com>
+//
+
+#ifndef GALERA_CHECK_POOL_HPP
+#define GALERA_CHECK_POOL_HPP
+
+#include <galerautils.h>
+#include <galerautils.hpp>
+
+#include <deque>
+#include <vector>
+
+namespace galera
+{
+    /*!
+     * Fixed set of threads verifying checksums of big incoming writesets
+     * in background.
+     *
+     * A job which has not been picked up by a pool thread by the time its
+     * result is needed is taken back and run by the waiting thread, so a
+     * busy pool never delays a writeset more than checksumming it inline.
+     */
+    class CheckPool
+    {
+    public:
+
+        class Job
+        {
+        public:
+
+            typedef void (*func_t)(void* arg);
+
+            Job(func_t func, void* arg)
+                : func_(func), arg_(arg), state_(S_NONE) {}
+
+        private:
+
+            friend class CheckPool;
+
+            enum State
+            {
+                S_NONE,
+                S_QUEUED,
+                S_RUNNING,
+                S_DONE
+            };
+
+            func_t const func_;
+            void*  const arg_;
+            State        state_;
+
+            Job(const Job&);
+            void operator=(const Job&);
+        };
+
+        /*! @param threads number of pool threads, 0 makes submit() fail */
+        explicit CheckPool(int threads);
+
+        /*! waits for all submitted jobs to complete */
+        ~CheckPool();
+
+        /*! @return false if the job was not queued and must be run inline */
+        bool submit(Job& job);
+
+        /*! returns when the job is complete, runs it if it is still queued */
+        void wait(Job& job);
+
+        int threads() const { return threads_.size(); }
+
+        /*! pool to be used for incoming writesets, may be NULL */
+        static CheckPool* default_pool() { return default_; }
+
+        /*! @param pool must stay valid until reset to NULL */
+        static void set_default_pool(CheckPool* pool) { default_ = pool; }
+
+    private:
+
+        CheckPool(const CheckPool&);
+        void operator=(const CheckPool&);
+
+        static void* thd_func(void* arg);
+
+        gu::Mutex                mtx_;
+        gu::Cond                 cond_;  // new job or exit
+        gu::Cond                 done_;  // job done
+        std::deque<Job*>         queue_;
+        std::vector<gu_thread_t> threads_;
+        bool                     exit_;
+
+        static CheckPool*        default_;
+    };
+}
+
+#endif // GALERA_CHECK_POOL_HPP
@@ -1,6 +1,144 @@
 //
-// Copyright (C) 2013 Codership Oy <info@codership.com>
+// Copyright (C) 2013-2014 Codership Oy <info@codership.com>
 //
 
 #include "data_set.hpp"
 
+#include "gu_lz4.h"
+
+size_t
+galera::DataSetOut::append_block (const void* const src,
+                                  size_t      const size,
+                                  bool        const store)
+{
+    /* type + 2 uleb128 encoded size_t values */
+    gu::byte_t hdr[1 + 2 * ((sizeof(size_t) * 8 + 6) / 7)];
+    size_t     hdr_size(1);
+
+    if (size >= DataSet::MIN_COMPRESS_SIZE)
+    {
+        size_t const bound(gu_lz4_compress_bound(size));
+
+        if (zbuf_.size() < bound) zbuf_.resize(bound);
+
+        /* don't bother if compression saves less than 1/16 */
+        size_t const zsize(gu_lz4_compress(src, size, &zbuf_[0],
+                                           size - (size >> 4)));
+        if (zsize > 0)
+        {
+            hdr[0] = DataSet::BLOCK_LZ4;
+            hdr_size = gu::uleb128_encode(size,  hdr, sizeof(hdr), hdr_size);
+            hdr_size = gu::uleb128_encode(zsize, hdr, sizeof(hdr), hdr_size);
+
+            gu::RecordSetOut<DataSet::RecordOut>::append (hdr, hdr_size,
+                                                          true, false);
+            gu::RecordSetOut<DataSet::RecordOut>::append (&zbuf_[0], zsize,
+                                                          true, false);
+            return size;
+        }
+    }
+
+    hdr[0] = DataSet::BLOCK_STORED;
+    hdr_size = gu::uleb128_encode(size, hdr, sizeof(hdr), hdr_size);
+
+    gu::RecordSetOut<DataSet::RecordOut>::append (hdr, hdr_size, true, false);
+
+    if (size > 0)
+    {
+        gu::RecordSetOut<DataSet::RecordOut>::append (src, size, store, false);
+    }
+
+    return size;
+}
+
+static void
+throw_malformed (size_t const off)
+{
+    gu_throw_error(EINVAL) << "Malformed DataSet block at offset " << off;
+}
+
+gu::Buf
+galera::DataSetIn::unpack (const gu::Buf& packed) const
+{
+    const gu::byte_t* const buf(static_cast<const gu::byte_t*>(packed.ptr));
+    size_t const            size(packed.size);
+
+    if (unpacked_ok_)
+    {
+        gu::Buf const ret = { unpacked_.data(), ssize_t(unpacked_.size()) };
+        return ret;
+    }
+
+    /* first pass: validate block headers and find the unpacked size */
+    size_t total(0);
+
+    for (size_t off(0); off < size;)
+    {
+        size_t const blk_off(off);
+        int const    type(buf[off++]);
+        size_t       raw_size(0);
+        size_t       blk_size(0);
+
+        if (gu_unlikely(off >= size)) throw_malformed(blk_off);
+        off = gu::uleb128_decode(buf, size, off, raw_size);
+
+        switch (type)
+        {
+        case DataSet::BLOCK_STORED:
+            blk_size = raw_size;
+            break;
+        case DataSet::BLOCK_LZ4:
+            if (gu_unlikely(off >= size)) throw_malformed(blk_off);
+            off = gu::uleb128_decode(buf, size, off, blk_size);
+            /* LZ4 can't expand data more than 255 times */
+            if (gu_unlikely(raw_size / 255 > blk_size))
+                throw_malformed(blk_off);
+            break;
+        default:
+            throw_malformed(blk_off);
+        }
+
+        if (gu_unlikely(blk_size > size - off)) throw_malformed(blk_off);
+
+        off   += blk_size;
+        total += raw_size;
+    }
+
+    unpacked_.resize(total);
+
+    /* second pass: unpack, headers are known to be sane */
+    gu::byte_t* dst(unpacked_.data());
+
+    for (size_t off(0); off < size;)
+    {
+        size_t const blk_off(off);
+        int const    type(buf[off++]);
+        size_t       raw_size(0);
+
+        off = gu::uleb128_decode(buf, size, off, raw_size);
+
+        if (DataSet::BLOCK_STORED == type)
+        {
+            if (raw_size > 0) ::memcpy(dst, buf + off, raw_size);
+            off += raw_size;
+        }
+        else
+        {
+            size_t blk_size(0);
+            off = gu::uleb128_decode(buf, size, off, blk_size);
+
+            long const ret(gu_lz4_decompress(buf + off, blk_size,
+                                             dst, raw_size));
+            if (gu_unlikely(ret != long(raw_size))) throw_malformed(blk_off);
+
+            off += blk_size;
+        }
+
+        dst += raw_size;
+    }
+
+    unpacked_ok_ = true;
+
+    gu::Buf const ret = { unpacked_.data(), ssize_t(unpacked_.size()) };
+    return ret;
+}
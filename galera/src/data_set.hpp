@@ -9,6 +9,8 @@
 #include "gu_rset.hpp"
 #include "gu_vlq.hpp"
 
+#include <vector>
+
 
 namespace galera
 {
@@ -19,10 +21,11 @@ namespace galera
         enum Version
         {
             EMPTY = 0,
-            VER1
+            VER1,
+            VER2  // data is stored in optionally compressed blocks
         };
 
-        static Version const MAX_VERSION = VER1;
+        static Version const MAX_VERSION = VER2;
 
         static Version version (unsigned int ver)
         {
@@ -32,6 +35,22 @@ namespace galera
             gu_throw_error (EINVAL) << "Unrecognized DataSet version: " << ver;
         }
 
+        /*
+         * VER2 record is a sequence of blocks, one per append():
+         *   1 byte  - block type (BLOCK_STORED or BLOCK_LZ4)
+         *   uleb128 - unpacked block size
+         *   uleb128 - packed block size (BLOCK_LZ4 only)
+         *   block payload
+         */
+        enum BlockType
+        {
+            BLOCK_STORED = 0,
+            BLOCK_LZ4
+        };
+
+        /*! appends shorter than that are not worth compressing */
+        static size_t const MIN_COMPRESS_SIZE = 256;
+
         /*! Dummy class to instantiate DataSetOut */
         class RecordOut {};
 
@@ -79,7 +98,7 @@ namespace galera
 
         DataSetOut () // empty ctor for slave TrxHandle
             :
-            gu::RecordSetOut<DataSet::RecordOut>(), version_()
+            gu::RecordSetOut<DataSet::RecordOut>(), version_(), zbuf_()
         {}
 
         DataSetOut (gu::byte_t*             reserved,
@@ -94,12 +113,16 @@ namespace galera
                 check_type      (version),
                 ds_to_rs_version(version)
                 ),
-            version_(version)
+            version_(version),
+            zbuf_   ()
         {}
 
         size_t
         append (const void* const src, size_t const size, bool const store)
         {
+            if (DataSet::VER2 == version_)
+                return append_block (src, size, store);
+
             /* append data as is, don't count as a new record */
             gu::RecordSetOut<DataSet::RecordOut>::append (src, size, store,
                                                           false);
@@ -118,13 +141,19 @@ namespace galera
         // depending on version we may pack data differently
         DataSet::Version const version_;
 
+        std::vector<gu::byte_t> zbuf_; // compression buffer
+
+        /* appends data as a (compressed if worth it) VER2 block */
+        size_t append_block (const void* src, size_t size, bool store);
+
         static gu::RecordSet::CheckType
         check_type (DataSet::Version ver)
         {
             switch (ver)
             {
             case DataSet::EMPTY: break; /* Can't create EMPTY DataSetOut */
-            case DataSet::VER1:  return gu::RecordSet::CHECK_MMH128;
+            case DataSet::VER1:
+            case DataSet::VER2:  return gu::RecordSet::CHECK_MMH128;
             }
             throw;
         }
@@ -135,7 +164,8 @@ namespace galera
             switch (ver)
             {
             case DataSet::EMPTY: break; /* Can't create EMPTY DataSetOut */
-            case DataSet::VER1:  return gu::RecordSet::VER1;
+            case DataSet::VER1:
+            case DataSet::VER2:  return gu::RecordSet::VER1;
             }
             throw;
         }
@@ -149,28 +179,45 @@ namespace galera
         DataSetIn (DataSet::Version ver, const gu::byte_t* buf, size_t size)
             :
             gu::RecordSetIn<DataSet::RecordIn>(buf, size, false),
-            version_(ver)
+            version_(ver),
+            unpacked_(),
+            unpacked_ok_(false)
         {}
 
         DataSetIn () : gu::RecordSetIn<DataSet::RecordIn>(),
-                       version_(DataSet::EMPTY)
+                       version_(DataSet::EMPTY),
+                       unpacked_(),
+                       unpacked_ok_(false)
         {}
 
         void init (DataSet::Version ver, const gu::byte_t* buf, size_t size)
         {
             gu::RecordSetIn<DataSet::RecordIn>::init(buf, size, false);
             version_ = ver;
+            unpacked_ok_ = false;
         }
 
         gu::Buf next () const
         {
-            return gu::RecordSetIn<DataSet::RecordIn>::next().buf();
+            gu::Buf const ret
+                (gu::RecordSetIn<DataSet::RecordIn>::next().buf());
+
+            if (DataSet::VER2 == version_) return unpack (ret);
+
+            return ret;
         }
 
     private:
 
         DataSet::Version version_;
 
+        /* VER2 data unpacked on first access */
+        mutable std::vector<gu::byte_t> unpacked_;
+        mutable bool                    unpacked_ok_;
+
+        /*! @throws EINVAL if the blocks are malformed */
+        gu::Buf unpack (const gu::Buf& packed) const;
+
     }; /* class DataSetIn */
 
 #if defined(__GNUG__)
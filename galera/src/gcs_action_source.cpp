@@ -12,35 +12,91 @@
 
 #include <cassert>
 
-// Exception-safe way to release action pointer when it goes out
+// Exception-safe way to release action pointers when they go out
 // of scope
 class Release
 {
 public:
-    Release(struct gcs_action& act, gcache::GCache& gcache)
+    Release(const struct gcs_action* acts, long n, gcache::GCache& gcache)
         :
-        act_(act),
+        acts_(acts),
+        n_(n),
         gcache_(gcache)
     {}
 
     ~Release()
     {
-        switch (act_.type)
+        for (long i(0); i < n_; ++i)
         {
-        case GCS_ACT_TORDERED:
-            break;
-        case GCS_ACT_STATE_REQ:
-            gcache_.free(const_cast<void*>(act_.buf));
-            break;
-        default:
-            ::free(const_cast<void*>(act_.buf));
-            break;
+            const struct gcs_action& act(acts_[i]);
+
+            switch (act.type)
+            {
+            case GCS_ACT_TORDERED:
+                break;
+            case GCS_ACT_STATE_REQ:
+                gcache_.free(const_cast<void*>(act.buf));
+                break;
+            default:
+                ::free(const_cast<void*>(act.buf));
+                break;
+            }
         }
     }
 
 private:
-    struct gcs_action& act_;
-    gcache::GCache&    gcache_;
+    Release(const Release&);
+    void operator=(const Release&);
+
+    const struct gcs_action* const acts_;
+    long const                     n_;
+    gcache::GCache&                gcache_;
+};
+
+
+// Exception-safe holder of trxs created from a run of TORDERED actions
+class TrxRun
+{
+public:
+    TrxRun(galera::TrxHandle::SlavePool& pool,
+           const struct gcs_action*      acts,
+           long                          n)
+        :
+        n_(0)
+    {
+        try
+        {
+            for (; n_ < n; ++n_)
+            {
+                trxs_[n_] = galera::GcsActionTrx::create(pool, acts[n_]);
+            }
+        }
+        catch (...)
+        {
+            release();
+            throw;
+        }
+    }
+
+    ~TrxRun() { release(); }
+
+    galera::TrxHandle* const* trxs() const { return trxs_; }
+
+private:
+    TrxRun(const TrxRun&);
+    void operator=(const TrxRun&);
+
+    void release()
+    {
+        for (long i(0); i < n_; ++i)
+        {
+            trxs_[i]->unlock();
+            trxs_[i]->unref();
+        }
+    }
+
+    galera::TrxHandle* trxs_[galera::GcsActionSource::MAX_BATCH];
+    long               n_;
 };
 
 
@@ -69,27 +125,46 @@ static galera::Replicator::State state2repl(const gcs_act_conf_t& conf)
 }
 
 
-galera::GcsActionTrx::GcsActionTrx(TrxHandle::SlavePool&    pool,
-                                   const struct gcs_action& act)
-    :
-    trx_(TrxHandle::New(pool))
-    // TODO: this dynamic allocation should be unnecessary
+galera::TrxHandle*
+galera::GcsActionTrx::create(TrxHandle::SlavePool&    pool,
+                             const struct gcs_action& act)
 {
     assert(act.seqno_l != GCS_SEQNO_ILL);
     assert(act.seqno_g != GCS_SEQNO_ILL);
 
-    const gu::byte_t* const buf = static_cast<const gu::byte_t*>(act.buf);
+    TrxHandle* const trx(TrxHandle::New(pool));
+    // TODO: this dynamic allocation should be unnecessary
+
+    try
+    {
+        const gu::byte_t* const buf = static_cast<const gu::byte_t*>(act.buf);
 
-//    size_t offset(trx_->unserialize(buf, act.size, 0));
-    gu_trace(trx_->unserialize(buf, act.size, 0));
+//        size_t offset(trx->unserialize(buf, act.size, 0));
+        gu_trace(trx->unserialize(buf, act.size, 0));
 
-    //trx_->append_write_set(buf + offset, act.size - offset);
-    // moved to unserialize trx_->set_write_set_buffer(buf + offset, act.size - offset);
-    trx_->set_received(act.buf, act.seqno_l, act.seqno_g);
-    trx_->lock();
+        //trx->append_write_set(buf + offset, act.size - offset);
+        // moved to unserialize trx->set_write_set_buffer(buf + offset, act.size - offset);
+        trx->set_received(act.buf, act.seqno_l, act.seqno_g);
+    }
+    catch (...)
+    {
+        trx->unref();
+        throw;
+    }
+
+    trx->lock();
+
+    return trx;
 }
 
 
+galera::GcsActionTrx::GcsActionTrx(TrxHandle::SlavePool&    pool,
+                                   const struct gcs_action& act)
+    :
+    trx_(create(pool, act))
+{}
+
+
 galera::GcsActionTrx::~GcsActionTrx()
 {
     assert(trx_->refcnt() >= 1);
@@ -114,7 +189,8 @@ void galera::GcsActionSource::dispatch(void* const              recv_ctx,
         GcsActionTrx trx(trx_pool_, act);
         trx.trx()->set_state(TrxHandle::S_REPLICATING);
         gu_trace(replicator_.process_trx(recv_ctx, trx.trx()));
-        exit_loop = trx.trx()->exit_loop(); // this is the end of trx lifespan
+        // this is the end of trx lifespan
+        if (trx.trx()->exit_loop()) exit_loop = true;
         break;
     }
     case GCS_ACT_COMMIT_CUT:
@@ -168,17 +244,76 @@ void galera::GcsActionSource::dispatch(void* const              recv_ctx,
 }
 
 
+void galera::GcsActionSource::dispatch_trxs(void* const                    recv_ctx,
+                                            const struct gcs_action* const acts,
+                                            long const                     n,
+                                            bool&                          exit_loop)
+{
+    assert(n > 1);
+
+    TrxRun run(trx_pool_, acts, n);
+
+    for (long i(0); i < n; ++i)
+    {
+        run.trxs()[i]->set_state(TrxHandle::S_REPLICATING);
+    }
+
+    gu_trace(replicator_.process_trxs(recv_ctx, run.trxs(), n));
+
+    for (long i(0); i < n; ++i)
+    {
+        if (run.trxs()[i]->exit_loop()) exit_loop = true;
+    }
+}
+
+
 ssize_t galera::GcsActionSource::process(void* recv_ctx, bool& exit_loop)
 {
-    struct gcs_action act;
+    ApplierGate::Active active(gate_);
 
-    ssize_t rc(gcs_.recv(act));
+    struct gcs_action acts[MAX_BATCH];
+
+    exit_loop = false;
+
+    ssize_t rc(gcs_.recv_batch(acts, batch_));
     if (rc > 0)
     {
-        Release release(act, gcache_);
-        ++received_;
+        long const n(rc);
+        Release    release(acts, n, gcache_);
+
+        rc = 0;
+        for (long i(0); i < n; ++i) rc += acts[i].size;
+
+        received_       += n;
         received_bytes_ += rc;
-        gu_trace(dispatch(recv_ctx, act, exit_loop));
+
+        for (long i(0); i < n;)
+        {
+            // consecutive writesets are certified together
+            long j(i + 1);
+
+            if (GCS_ACT_TORDERED == acts[i].type)
+            {
+                while (j < n && GCS_ACT_TORDERED == acts[j].type &&
+                       acts[j].seqno_l == acts[j - 1].seqno_l + 1) ++j;
+            }
+
+            if (j - i > 1)
+            {
+                gu_trace(dispatch_trxs(recv_ctx, &acts[i], j - i, exit_loop));
+            }
+            else
+            {
+                gu_trace(dispatch(recv_ctx, acts[i], exit_loop));
+            }
+
+            i = j;
+        }
+    }
+    else if (rc != -ECANCELED)
+    {
+        // connection is gone, let parked threads find it out too
+        set_active_max(0);
     }
     return rc;
 }
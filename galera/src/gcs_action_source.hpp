@@ -6,6 +6,7 @@
 #define GALERA_GCS_ACTION_SOURCE_HPP
 
 #include "action_source.hpp"
+#include "applier_tuner.hpp"
 #include "galera_gcs.hpp"
 #include "replicator.hpp"
 #include "trx_handle.hpp"
@@ -20,18 +21,31 @@ namespace galera
     {
     public:
 
+        static long const MAX_BATCH = 64;
+
+        /*! @param batch max number of actions to receive at once */
         GcsActionSource(TrxHandle::SlavePool& sp,
                         GCS_IMPL&             gcs,
                         Replicator&           replicator,
-                        gcache::GCache&       gcache)
+                        gcache::GCache&       gcache,
+                        long                  batch = 1)
             :
             trx_pool_      (sp        ),
             gcs_           (gcs       ),
             replicator_    (replicator),
             gcache_        (gcache    ),
+            batch_         (batch     ),
             received_      (0         ),
-            received_bytes_(0         )
-        { }
+            received_bytes_(0         ),
+            gate_          (          )
+        {
+            if (batch_ < 1 || batch_ > MAX_BATCH)
+            {
+                gu_throw_error(EINVAL) << "Receive batch size " << batch_
+                                       << " out of range [1, " << MAX_BATCH
+                                       << ']';
+            }
+        }
 
         ~GcsActionSource()
         {
@@ -42,16 +56,25 @@ namespace galera
         long long received()       const { return received_(); }
         long long received_bytes() const { return received_bytes_(); }
 
+        /*! Limits the number of threads concurrently receiving and
+         *  processing actions, excess threads are parked on entry to
+         *  process(). 0 means no limit. */
+        void set_active_max(long n) { gate_.set_active_max(n); }
+        long parked() const { return gate_.parked(); }
+
     private:
 
         void dispatch(void*, const gcs_action&, bool& exit_loop);
+        void dispatch_trxs(void*, const gcs_action*, long n, bool& exit_loop);
 
         TrxHandle::SlavePool& trx_pool_;
         GCS_IMPL&             gcs_;
         Replicator&           replicator_;
         gcache::GCache&       gcache_;
+        long const            batch_;
         gu::Atomic<long long> received_;
         gu::Atomic<long long> received_bytes_;
+        ApplierGate           gate_;
     };
 
     class GcsActionTrx
@@ -60,6 +83,8 @@ namespace galera
         GcsActionTrx(TrxHandle::SlavePool& sp, const struct gcs_action& act);
         ~GcsActionTrx();
         TrxHandle* trx() const { return trx_; }
+        /*! creates locked trx from action */
+        static TrxHandle* create(TrxHandle::SlavePool&, const gcs_action&);
     private:
         GcsActionTrx(const GcsActionTrx&);
         void operator=(const GcsActionTrx&);
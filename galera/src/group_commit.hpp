@@ -0,0 +1,142 @@
+//
+// Copyright (C) 2014 Codership Oy <info@codership.com>
+//
+
+#ifndef GALERA_GROUP_COMMIT_HPP
+#define GALERA_GROUP_COMMIT_HPP
+
+#include "wsrep_api.h"
+
+#include <galerautils.hpp>
+
+namespace galera
+{
+    /*!
+     * Groups durability syncs of writesets committed in order.
+     *
+     * After committing (and leaving commit monitor) every thread joins the
+     * group and waits until its seqno has been made durable. The first thread
+     * which finds no sync in progress becomes a leader: it syncs everything
+     * committed so far and releases all threads covered by that sync at once.
+     * Threads which join while the leader syncs form the next group.
+     * If the sync fails, all waiting and later joining threads fail too.
+     *
+     * Application opts in with repl.group_commit provider option and gets
+     * these flags in the commit callback on top of WSREP_FLAG_... ones.
+     */
+    class GroupCommit
+    {
+    public:
+
+        enum
+        {
+            /*! making committed writeset durable may be deferred */
+            F_DEFER = 1 << 29,
+            /*! no writeset to commit, make durable all writesets in
+             *  (meta->depends_on, meta->gtid.seqno] committed with F_DEFER */
+            F_SYNC  = 1 << 30
+        };
+
+        GroupCommit()
+            :
+            mutex_    (),
+            cond_     (),
+            committed_(-1),
+            synced_   (-1),
+            syncing_  (false),
+            failed_   (false)
+        {}
+
+        /*!
+         * Registers committed seqno and waits for it to be synced.
+         *
+         * @param seqno committed seqno, all preceding seqnos must have
+         *              been committed too
+         * @param from  set to the last synced seqno if the caller is to
+         *              become a leader
+         * @param upto  set to the seqno up to which leader must sync
+         * @return true if the caller must sync (from, upto] and then call
+         *         synced(upto) or failed()
+         * @throws gu::Exception if a sync has failed
+         */
+        bool join(wsrep_seqno_t  seqno,
+                  wsrep_seqno_t& from,
+                  wsrep_seqno_t& upto)
+        {
+            gu::Lock lock(mutex_);
+
+            if (committed_ < seqno) committed_ = seqno;
+
+            while (synced_ < seqno)
+            {
+                if (gu_unlikely(failed_))
+                {
+                    gu_throw_fatal << "Group sync failed before seqno "
+                                   << seqno << " was synced";
+                }
+
+                if (!syncing_)
+                {
+                    syncing_ = true;
+                    from     = synced_;
+                    upto     = committed_;
+                    return true;
+                }
+
+                lock.wait(cond_);
+            }
+
+            return false;
+        }
+
+        /*! releases all threads waiting for seqnos up to upto */
+        void synced(wsrep_seqno_t upto)
+        {
+            gu::Lock lock(mutex_);
+
+            assert(syncing_);
+            assert(upto > synced_);
+
+            synced_  = upto;
+            syncing_ = false;
+            cond_.broadcast();
+        }
+
+        /*! aborts the sync in progress and fails all waiting threads */
+        void failed()
+        {
+            gu::Lock lock(mutex_);
+
+            assert(syncing_);
+
+            syncing_ = false;
+            failed_  = true;
+            cond_.broadcast();
+        }
+
+        /*! resets synced position, e.g. after state transfer */
+        void set_initial_position(wsrep_seqno_t seqno)
+        {
+            gu::Lock lock(mutex_);
+
+            assert(!syncing_);
+
+            committed_ = synced_ = seqno;
+            failed_    = false;
+        }
+
+    private:
+
+        GroupCommit(const GroupCommit&);
+        void operator=(const GroupCommit&);
+
+        gu::Mutex     mutex_;
+        gu::Cond      cond_;
+        wsrep_seqno_t committed_; // highest seqno committed
+        wsrep_seqno_t synced_;    // highest seqno made durable
+        bool          syncing_;   // leader is syncing
+        bool          failed_;    // sync failed, nothing can be synced
+    };
+}
+
+#endif // GALERA_GROUP_COMMIT_HPP
@@ -279,6 +279,28 @@ KeySetOut::KeyPart::print (std::ostream& os) const
 
 size_t
 KeySetOut::append (const KeyData& kd)
+{
+    size_t ret;
+
+    if (esc_threshold_ > 0 && appended_ >= esc_threshold_ && kd.parts_num > 2)
+    {
+        KeyData const parent(kd.proto_ver, kd.parts, kd.parts_num - 1,
+                             WSREP_KEY_EXCLUSIVE, kd.copy);
+        ret = append_key (parent);
+        escalated_ = true;
+    }
+    else
+    {
+        ret = append_key (kd);
+    }
+
+    appended_ += (ret > 0);
+
+    return ret;
+}
+
+size_t
+KeySetOut::append_key (const KeyData& kd)
 {
     int i(0);
 
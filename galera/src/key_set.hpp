@@ -200,6 +200,23 @@ public:
             return ret; // (ret ^ (ret << HEADER_BITS)) to cover 0 bits
         }
 
+        /* for flat hash tables that store hash inline:
+         * first 8 bytes of the hash with the header cleared */
+        uint64_t
+        hash_head () const
+        {
+            return (gtoh64(reinterpret_cast<const uint64_t*>(data_)[0]) >>
+                    HEADER_BITS);
+        }
+
+        /* second 8 bytes of the 16-byte hash, 0 for 8-byte hashes */
+        uint64_t
+        hash_tail () const
+        {
+            return (version() >= FLAT16 ?
+                    reinterpret_cast<const uint64_t*>(data_)[1] : 0);
+        }
+
         static size_t
         serial_size (const gu::byte_t* const buf, size_t const size)
         {
@@ -615,13 +632,20 @@ public:
         added_(),
         prev_ (),
         new_  (),
-        version_()
+        version_(),
+        esc_threshold_(0),
+        appended_(0),
+        escalated_(false)
     {}
 
+    /* esc_threshold: after that many keys are added, keys of 3 or more
+     * parts (row-level) are replaced with exclusive keys of their parent
+     * part (table-level), 0 - never */
     KeySetOut (gu::byte_t*             reserved,
                size_t                  reserved_size,
                const BaseName&         base_name,
-               KeySet::Version const   version)
+               KeySet::Version const   version,
+               size_t const            esc_threshold = 0)
         :
         gu::RecordSetOut<KeySet::KeyPart> (
             reserved,
@@ -633,7 +657,10 @@ public:
         added_(),
         prev_ (),
         new_  (),
-        version_(version)
+        version_(version),
+        esc_threshold_(esc_threshold),
+        appended_(0),
+        escalated_(false)
     {
         assert (version_ != KeySet::EMPTY);
         KeyPart zero(version_);
@@ -646,7 +673,11 @@ public:
     append (const KeyData& kd);
 
     KeySet::Version
-    version () { return count() ? version_ : KeySet::EMPTY; }
+    version () const { return count() ? version_ : KeySet::EMPTY; }
+
+    /* true if some keys were replaced with their parents */
+    bool
+    escalated () const { return escalated_; }
 
 private:
 
@@ -655,6 +686,12 @@ private:
     gu::Vector<KeyPart,5> prev_;
     gu::Vector<KeyPart,5> new_;
     KeySet::Version       version_;
+    size_t                esc_threshold_;
+    size_t                appended_;
+    bool                  escalated_;
+
+    size_t
+    append_key (const KeyData& kd);
 
     static gu::RecordSet::CheckType
     check_type (KeySet::Version ver)
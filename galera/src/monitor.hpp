@@ -7,6 +7,7 @@
 
 #include "trx_handle.hpp"
 #include <galerautils.hpp>
+#include "gu_histogram.hpp"
 
 #include <vector>
 
@@ -17,51 +18,64 @@ namespace galera
     {
     private:
 
+        // Slots are zero-initialized: all-zero slot is idle, so the pages of
+        // the array get allocated only when the slots are actually used.
+        // Condition variables are attached only while somebody waits.
         struct Process
         {
-            Process() : obj_(0), cond_(), wait_cond_(), state_(S_IDLE) { }
-
-            const C* obj_;
-            gu::Cond cond_;
-            gu::Cond wait_cond_;
+            const C*  obj_;
+            gu::Cond* cond_;       // waiting to enter
+            gu::Cond* wait_cond_;  // waiting in wait()
+            long      wait_refs_;  // number of threads in wait()
             enum State
             {
-                S_IDLE,     // Slot is free
+                S_IDLE = 0, // Slot is free
                 S_WAITING,  // Waiting to enter applying critical section
                 S_CANCELED,
                 S_APPLYING, // Applying
                 S_FINISHED  // Finished
             } state_;
-
-        private:
-
-            // non-copyable
-            Process(const Process& other);
-            void operator=(const Process&);
+            long long entered_at_; // time when S_APPLYING was entered
         };
 
-        static const ssize_t process_size_ = (1ULL << 16);
-        static const size_t  process_mask_ = process_size_ - 1;
-
     public:
 
-        Monitor()
+        static const ssize_t DEFAULT_SIZE = (1ULL << 16);
+
+        /* size is the max distance between last left and entering seqno,
+         * rounded up to a power of 2 */
+        explicit
+        Monitor(ssize_t size = DEFAULT_SIZE)
             :
             mutex_(),
             cond_(),
             last_entered_(-1),
             last_left_(-1),
             drain_seqno_(LLONG_MAX),
-            process_(new Process[process_size_]),
+            process_size_(window_size(size)),
+            process_mask_(process_size_ - 1),
+            process_(static_cast<Process*>(
+                         gu_calloc(process_size_, sizeof(Process)))),
+            conds_(),
             entered_(0),
             oooe_(0),
             oool_(0),
-            win_size_(0)
-        { }
+            win_size_(0),
+            wait_hist_(),
+            hold_hist_(),
+            wake_on_finish_(false)
+        {
+            if (0 == process_)
+            {
+                gu_throw_error(ENOMEM) << "Failed to allocate "
+                                       << process_size_ << " monitor slots";
+            }
+        }
 
         ~Monitor()
         {
-            delete[] process_;
+            gu_free(process_);
+            for (size_t i(0); i < conds_.size(); ++i) delete conds_[i];
             if (entered_ > 0)
             {
                 log_info << "mon: entered " << entered_
@@ -91,13 +105,13 @@ namespace galera
             }
             if (seqno != -1)
             {
-                const size_t idx(indexof(seqno));
-                process_[idx].wait_cond_.broadcast();
+                notify_waiters(process_[indexof(seqno)]);
             }
         }
 
         void enter(C& obj)
         {
+            const long long     start(gu_time_monotonic());
             const wsrep_seqno_t obj_seqno(obj.seqno());
             const size_t        idx(indexof(obj_seqno));
             gu::Lock            lock(mutex_);
@@ -113,12 +127,20 @@ namespace galera
                 process_[idx].state_ = Process::S_WAITING;
                 process_[idx].obj_   = &obj;
 
-                while (may_enter(obj) == false &&
-                       process_[idx].state_ == Process::S_WAITING)
+                if (may_enter(obj) == false)
                 {
-                    obj.unlock();
-                    lock.wait(process_[idx].cond_);
-                    obj.lock();
+                    process_[idx].cond_ = get_cond();
+
+                    while (may_enter(obj) == false &&
+                           process_[idx].state_ == Process::S_WAITING)
+                    {
+                        obj.unlock();
+                        lock.wait(*process_[idx].cond_);
+                        obj.lock();
+                    }
+
+                    put_cond(process_[idx].cond_);
+                    process_[idx].cond_ = 0;
                 }
 
                 if (process_[idx].state_ != Process::S_CANCELED)
@@ -126,11 +148,13 @@ namespace galera
                     assert(process_[idx].state_ == Process::S_WAITING ||
                            process_[idx].state_ == Process::S_APPLYING);
 
-                    process_[idx].state_ = Process::S_APPLYING;
+                    process_[idx].state_   = Process::S_APPLYING;
+                    process_[idx].entered_at_ = gu_time_monotonic();
 
                     ++entered_;
                     oooe_     += ((last_left_ + 1) < obj_seqno);
                     win_size_ += (last_entered_ - last_left_);
+                    wait_hist_.insert(process_[idx].entered_at_ - start);
                     return;
                 }
             }
@@ -143,14 +167,18 @@ namespace galera
 
         void leave(const C& obj)
         {
-#ifndef NDEBUG
             size_t   idx(indexof(obj.seqno()));
-#endif /* NDEBUG */
             gu::Lock lock(mutex_);
 
             assert(process_[idx].state_ == Process::S_APPLYING ||
                    process_[idx].state_ == Process::S_CANCELED);
 
+            if (gu_likely(process_[idx].state_ == Process::S_APPLYING))
+            {
+                hold_hist_.insert(gu_time_monotonic() -
+                                  process_[idx].entered_at_);
+            }
+
             assert(process_[indexof(last_left_)].state_ == Process::S_IDLE);
 
             post_leave(obj, lock);
@@ -164,15 +192,21 @@ namespace galera
 
             assert(obj_seqno > last_left_);
 
+            bool warned(false);
+
             while (obj_seqno - last_left_ >= process_size_)
                 // TODO: exit on error
             {
-                log_warn << "Trying to self-cancel seqno out of process "
-                         << "space: obj_seqno - last_left_ = " << obj_seqno
-                         << " - " << last_left_ << " = "
-                         << (obj_seqno - last_left_)
-                         << ", process_size_: "  << process_size_
-                         << ". Deadlock is very likely.";
+                if (!warned)
+                {
+                    warned = true;
+                    log_warn << "Trying to self-cancel seqno out of process "
+                             << "space: obj_seqno - last_left_ = " << obj_seqno
+                             << " - " << last_left_ << " = "
+                             << (obj_seqno - last_left_)
+                             << ", process_size_: "  << process_size_
+                             << ". Deadlock is very likely.";
+                }
                 obj.unlock();
                 lock.wait(cond_);
                 obj.lock();
@@ -210,7 +244,7 @@ namespace galera
                 process_[idx].state_ == Process::S_WAITING )
             {
                 process_[idx].state_ = Process::S_CANCELED;
-                process_[idx].cond_.signal();
+                if (process_[idx].cond_) process_[idx].cond_->signal();
                 // since last_left + 1 cannot be <= S_WAITING we're not
                 // modifying a window here. No broadcasting.
             }
@@ -223,6 +257,24 @@ namespace galera
             }
         }
 
+        /* If set, waiters are re-examined also when an object leaves out of
+         * order. Needed if C::condition() depends on finished() rather than
+         * only on last_left. */
+        void set_wake_on_finish(bool val)
+        {
+            gu::Lock lock(mutex_);
+            wake_on_finish_ = val;
+        }
+
+        /* whether object with seqno has left the monitor.
+         * Must be called under mutex_, e.g. from C::condition() */
+        bool finished(wsrep_seqno_t seqno) const
+        {
+            return (seqno <= last_left_ ||
+                    (seqno - last_left_ < process_size_ &&
+                     process_[indexof(seqno)].state_ == Process::S_FINISHED));
+        }
+
         wsrep_seqno_t last_left()   const
         {
             gu::Lock lock(mutex_);
@@ -236,6 +288,13 @@ namespace galera
                     seqno > drain_seqno_);
         }
 
+        /* whether obj could enter right away */
+        bool ready(const C& obj) const
+        {
+            gu::Lock lock(mutex_);
+            return (!would_block(obj.seqno()) && may_enter(obj));
+        }
+
         void drain(wsrep_seqno_t seqno)
         {
             gu::Lock lock(mutex_);
@@ -259,8 +318,7 @@ namespace galera
             gu::Lock lock(mutex_);
             if (last_left_ < seqno)
             {
-                size_t idx(indexof(seqno));
-                lock.wait(process_[idx].wait_cond_);
+                wait_slot(process_[indexof(seqno)], lock, 0);
             }
         }
 
@@ -269,8 +327,7 @@ namespace galera
             gu::Lock lock(mutex_);
             if (last_left_ < seqno)
             {
-                size_t idx(indexof(seqno));
-                lock.wait(process_[idx].wait_cond_, wait_until);
+                wait_slot(process_[indexof(seqno)], lock, &wait_until);
             }
         }
 
@@ -295,15 +352,73 @@ namespace galera
         {
             gu::Lock lock(mutex_);
             oooe_ = 0; oool_ = 0; win_size_ = 0; entered_ = 0;
+            wait_hist_.clear(); hold_hist_.clear();
         }
 
+        /* distributions of time (ns) spent waiting in enter() and
+         * between enter() and leave() */
+        const gu::LatencyHistogram& wait_hist() const { return wait_hist_; }
+        const gu::LatencyHistogram& hold_hist() const { return hold_hist_; }
+
     private:
 
-        size_t indexof(wsrep_seqno_t seqno)
+        static ssize_t window_size(ssize_t size)
+        {
+            ssize_t ret(2);
+            while (ret < size) ret <<= 1;
+            return ret;
+        }
+
+        size_t indexof(wsrep_seqno_t seqno) const
         {
             return (seqno & process_mask_);
         }
 
+        gu::Cond* get_cond()
+        {
+            if (conds_.empty()) return new gu::Cond;
+
+            gu::Cond* const ret(conds_.back());
+            conds_.pop_back();
+            return ret;
+        }
+
+        void put_cond(gu::Cond* cond) { conds_.push_back(cond); }
+
+        // must be called under mutex_
+        void wait_slot(Process& p, gu::Lock& lock,
+                       const gu::datetime::Date* wait_until)
+        {
+            if (0 == p.wait_refs_++) p.wait_cond_ = get_cond();
+
+            try
+            {
+                if (wait_until) lock.wait(*p.wait_cond_, *wait_until);
+                else            lock.wait(*p.wait_cond_);
+            }
+            catch (...)
+            {
+                release_wait_cond(p);
+                throw;
+            }
+
+            release_wait_cond(p);
+        }
+
+        void release_wait_cond(Process& p)
+        {
+            if (0 == --p.wait_refs_)
+            {
+                put_cond(p.wait_cond_);
+                p.wait_cond_ = 0;
+            }
+        }
+
+        void notify_waiters(Process& p)
+        {
+            if (p.wait_cond_) p.wait_cond_->broadcast();
+        }
+
         bool may_enter(const C& obj) const
         {
             return obj.condition(last_entered_, last_left_);
@@ -337,7 +452,7 @@ namespace galera
                 {
                     a.state_   = Process::S_IDLE;
                     last_left_ = i;
-                    a.wait_cond_.broadcast();
+                    notify_waiters(a);
                 }
                 else
                 {
@@ -361,7 +476,7 @@ namespace galera
                     // there will be  nobody to clean up and advance
                     // last_left_.
                     a.state_ = Process::S_APPLYING;
-                    a.cond_.signal();
+                    if (a.cond_) a.cond_->signal();
                 }
             }
         }
@@ -375,7 +490,7 @@ namespace galera
             {
                 process_[idx].state_ = Process::S_IDLE;
                 last_left_           = obj_seqno;
-                process_[idx].wait_cond_.broadcast();
+                notify_waiters(process_[idx]);
 
                 update_last_left();
                 oool_ += (last_left_ > obj_seqno);
@@ -386,6 +501,8 @@ namespace galera
             else
             {
                 process_[idx].state_ = Process::S_FINISHED;
+
+                if (wake_on_finish_) wake_up_next();
             }
 
             process_[idx].obj_ = 0;
@@ -432,11 +549,35 @@ namespace galera
         wsrep_seqno_t last_entered_;
         wsrep_seqno_t last_left_;
         wsrep_seqno_t drain_seqno_;
+        ssize_t const process_size_;
+        size_t  const process_mask_;
         Process*      process_;
+        std::vector<gu::Cond*> conds_; // unused condition variables
         long entered_;  // entered
         long oooe_;     // out of order entered
         long oool_;     // out of order left
         long win_size_; // window between last_left_ and last_entered_
+        gu::LatencyHistogram wait_hist_;
+        gu::LatencyHistogram hold_hist_;
+        bool wake_on_finish_;
+    };
+}
+
+#ifdef GALERA_MONITOR_LOCKFREE
+#include "monitor_lf.hpp"
+#endif
+
+namespace galera
+{
+    /* Monitor implementation to be used by the replicator */
+    template <class C>
+    struct MonitorOf
+    {
+#ifdef GALERA_MONITOR_LOCKFREE
+        typedef MonitorLF<C> type;
+#else
+        typedef Monitor<C>   type;
+#endif
     };
 }
 
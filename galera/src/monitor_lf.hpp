@@ -0,0 +1,615 @@
+//
+// Copyright (C) 2014 Codership Oy
+//
+
+#ifndef GALERA_MONITOR_LF_HPP
+#define GALERA_MONITOR_LF_HPP
+
+#include "trx_handle.hpp"
+#include <galerautils.hpp>
+#include "gu_atomic.h"
+#include "gu_futex.hpp"
+#include "gu_histogram.hpp"
+
+#include <sched.h>
+
+namespace galera
+{
+    /*!
+     * Lock-free variant of Monitor with the same interface and semantics.
+     *
+     * Window boundaries and process slot states are updated with atomic
+     * operations only. A waiting thread sleeps on a futex word of its own
+     * slot, so a leaving thread wakes exactly those waiters whose condition
+     * became true instead of serializing on the monitor mutex. Waits for
+     * window space, drain() and wait() share a single event futex word which
+     * is bumped every time last_left_ advances.
+     *
+     * A thread evaluating the condition of a waiter holds the waiter's slot
+     * in S_CHECKING state, which keeps the waiting object in place.
+     *
+     * Linux only, selected with lockfree_monitor=1 build option.
+     */
+    template <class C>
+    class MonitorLF
+    {
+    private:
+
+        enum State
+        {
+            S_IDLE = 0, // Slot is free
+            S_WAITING,  // Waiting to enter applying critical section
+            S_CANCELED,
+            S_APPLYING, // Applying
+            S_FINISHED, // Finished
+            S_CHECKING  // Waiter's condition is being evaluated
+        };
+
+        // Zero-initialized, see Monitor::Process. seqno_ is meaningful only
+        // in S_FINISHED state.
+        struct Process
+        {
+            const C*      obj_;
+            wsrep_seqno_t seqno_;      // seqno that has finished in this slot
+            int           state_;      // futex word
+            long long     entered_at_; // time when S_APPLYING was entered
+        };
+
+    public:
+
+        static const ssize_t DEFAULT_SIZE = (1ULL << 16);
+
+        explicit
+        MonitorLF(ssize_t size = DEFAULT_SIZE)
+            :
+            last_entered_(-1),
+            last_left_(-1),
+            drain_seqno_(LLONG_MAX),
+            process_size_(window_size(size)),
+            process_mask_(process_size_ - 1),
+            process_(static_cast<Process*>(
+                         gu_calloc(process_size_, sizeof(Process)))),
+            event_(0),
+            event_waiters_(0),
+            entered_(0),
+            oooe_(0),
+            oool_(0),
+            win_size_(0),
+            wait_hist_(),
+            hold_hist_(),
+            wake_on_finish_(false)
+        {
+            if (0 == process_)
+            {
+                gu_throw_error(ENOMEM) << "Failed to allocate "
+                                       << process_size_ << " monitor slots";
+            }
+        }
+
+        ~MonitorLF()
+        {
+            gu_free(process_);
+            if (entered_ > 0)
+            {
+                log_info << "mon: entered " << entered_
+                         << " oooe fraction " << double(oooe_)/entered_
+                         << " oool fraction " << double(oool_)/entered_;
+            }
+            else
+            {
+                log_info << "apply mon: entered 0";
+            }
+        }
+
+        void set_initial_position(wsrep_seqno_t seqno)
+        {
+            if (get(last_entered_) == -1 || seqno == -1)
+            {
+                // first call or reset
+                set(last_entered_, seqno);
+                set(last_left_, seqno);
+            }
+            else
+            {
+                // drain monitor up to seqno but don't reset last_entered_
+                // or last_left_
+                set(drain_seqno_, seqno);
+                drain_common(seqno);
+                set(drain_seqno_, wsrep_seqno_t(LLONG_MAX));
+            }
+
+            notify_event();
+        }
+
+        void enter(C& obj)
+        {
+            const long long     start(gu_time_monotonic());
+            const wsrep_seqno_t obj_seqno(obj.seqno());
+            Process&            p(process_[indexof(obj_seqno)]);
+
+            assert(obj_seqno > get(last_left_));
+
+            pre_enter(obj);
+
+            p.obj_ = &obj; // published by the state change below
+
+            for (;;)
+            {
+                int const state(get(p.state_));
+
+                if (S_IDLE == state)
+                {
+                    cas(p.state_, int(S_IDLE), int(S_WAITING));
+                }
+                else if (S_WAITING == state)
+                {
+                    if (may_enter(obj))
+                    {
+                        if (cas(p.state_, int(S_WAITING), int(S_APPLYING)))
+                            break;
+                    }
+                    else
+                    {
+                        obj.unlock();
+                        gu::futex_wait(&p.state_, S_WAITING);
+                        obj.lock();
+                    }
+                }
+                else if (S_APPLYING == state)
+                {
+                    break; // let in by a leaving thread
+                }
+                else if (S_CANCELED == state)
+                {
+                    p.obj_ = 0;
+                    set(p.state_, int(S_IDLE));
+
+                    gu_throw_error(EINTR);
+                }
+                else
+                {
+                    // S_CHECKING: our condition is being evaluated,
+                    // S_FINISHED: previous slot owner is being retired
+                    sched_yield();
+                }
+            }
+
+            p.entered_at_ = gu_time_monotonic();
+            wait_hist_.insert(p.entered_at_ - start);
+
+            wsrep_seqno_t const ll(get(last_left_));
+
+            gu_atomic_fetch_and_add(&entered_, 1);
+            gu_atomic_fetch_and_add(&oooe_, long((ll + 1) < obj_seqno));
+            gu_atomic_fetch_and_add(&win_size_, long(get(last_entered_) - ll));
+        }
+
+        void leave(const C& obj)
+        {
+            const Process& p(process_[indexof(obj.seqno())]);
+
+            assert(get(p.state_) == S_APPLYING || get(p.state_) == S_CANCELED);
+
+            if (gu_likely(get(p.state_) == S_APPLYING))
+            {
+                hold_hist_.insert(gu_time_monotonic() - p.entered_at_);
+            }
+
+            post_leave(obj);
+        }
+
+        void self_cancel(C& obj)
+        {
+            wsrep_seqno_t const obj_seqno(obj.seqno());
+            Process&            p(process_[indexof(obj_seqno)]);
+
+            assert(obj_seqno > get(last_left_));
+
+            bool warned(false);
+
+            for (int ev(get(event_));
+                 obj_seqno - get(last_left_) >= process_size_;
+                 ev = get(event_))
+                // TODO: exit on error
+            {
+                if (!warned)
+                {
+                    warned = true;
+                    log_warn << "Trying to self-cancel seqno out of process "
+                             << "space: obj_seqno - last_left_ = " << obj_seqno
+                             << " - " << get(last_left_) << " = "
+                             << (obj_seqno - get(last_left_))
+                             << ", process_size_: "  << process_size_
+                             << ". Deadlock is very likely.";
+                }
+                obj.unlock();
+                wait_event(ev);
+                obj.lock();
+            }
+
+            wait_retired(p, obj_seqno);
+
+            assert(get(p.state_) == S_IDLE || get(p.state_) == S_CANCELED);
+
+            update_last_entered(obj_seqno);
+
+            if (obj_seqno <= get(drain_seqno_))
+            {
+                post_leave(obj);
+            }
+            else
+            {
+                set(p.seqno_, obj_seqno);
+                set(p.state_, int(S_FINISHED));
+            }
+        }
+
+        void interrupt(const C& obj)
+        {
+            wsrep_seqno_t const obj_seqno(obj.seqno());
+            Process&            p(process_[indexof(obj_seqno)]);
+
+            for (int ev(get(event_));
+                 obj_seqno - get(last_left_) >= process_size_;
+                 ev = get(event_))
+                // TODO: exit on error
+            {
+                wait_event(ev);
+            }
+
+            for (;;)
+            {
+                int const state(get(p.state_));
+
+                if ((S_IDLE == state && obj_seqno > get(last_left_)) ||
+                    S_WAITING == state)
+                {
+                    if (cas(p.state_, state, int(S_CANCELED)))
+                    {
+                        gu::futex_wake(&p.state_, 1);
+                        break;
+                    }
+                }
+                else if (S_CHECKING == state ||
+                         (S_FINISHED == state && get(p.seqno_) != obj_seqno))
+                {
+                    sched_yield();
+                }
+                else
+                {
+                    log_debug << "interrupting " << obj_seqno
+                              << " state " << state
+                              << " le " << get(last_entered_)
+                              << " ll " << get(last_left_);
+                    break;
+                }
+            }
+        }
+
+        /* If set, waiters are re-examined also when an object leaves out of
+         * order. Needed if C::condition() depends on finished() rather than
+         * only on last_left. Must be set before the monitor is used. */
+        void set_wake_on_finish(bool val)
+        {
+            wake_on_finish_ = val;
+        }
+
+        /* whether object with seqno has left the monitor */
+        bool finished(wsrep_seqno_t seqno) const
+        {
+            wsrep_seqno_t const ll(get(last_left_));
+
+            if (seqno <= ll) return true;
+            if (seqno - ll >= process_size_) return false;
+
+            const Process& p(process_[indexof(seqno)]);
+
+            return (get(p.state_) == S_FINISHED && get(p.seqno_) == seqno);
+        }
+
+        wsrep_seqno_t last_left()   const { return get(last_left_); }
+        ssize_t       size()        const { return process_size_;   }
+
+        bool would_block (wsrep_seqno_t seqno) const
+        {
+            return (seqno - get(last_left_) >= process_size_ ||
+                    seqno > get(drain_seqno_));
+        }
+
+        /* whether obj could enter right away */
+        bool ready(const C& obj) const
+        {
+            return (!would_block(obj.seqno()) && may_enter(obj));
+        }
+
+        void drain(wsrep_seqno_t seqno)
+        {
+            for (int ev(get(event_));
+                 !cas(drain_seqno_, wsrep_seqno_t(LLONG_MAX), seqno);
+                 ev = get(event_))
+            {
+                wait_event(ev);
+            }
+
+            drain_common(seqno);
+
+            // there can be some stale canceled entries
+            update_last_left();
+
+            set(drain_seqno_, wsrep_seqno_t(LLONG_MAX));
+            notify_event();
+        }
+
+        void wait(wsrep_seqno_t seqno)
+        {
+            for (int ev(get(event_)); get(last_left_) < seqno; ev = get(event_))
+            {
+                wait_event(ev);
+            }
+        }
+
+        void wait(wsrep_seqno_t seqno, const gu::datetime::Date& wait_until)
+        {
+            for (int ev(get(event_)); get(last_left_) < seqno; ev = get(event_))
+            {
+                int const err(wait_event(ev, wait_until));
+
+                if (gu_unlikely(-ETIMEDOUT == err)) gu_throw_error(ETIMEDOUT);
+            }
+        }
+
+        void get_stats(double* oooe, double* oool, double* win_size)
+        {
+            long const entered(get(entered_));
+
+            if (entered > 0)
+            {
+                long const oooe_n(get(oooe_));
+                long const oool_n(get(oool_));
+                long const win_n(get(win_size_));
+
+                *oooe = (oooe_n > 0 ? double(oooe_n)/entered : .0);
+                *oool = (oool_n > 0 ? double(oool_n)/entered : .0);
+                *win_size = (win_n > 0 ? double(win_n)/entered : .0);
+            }
+            else
+            {
+                *oooe = .0; *oool = .0; *win_size = .0;
+            }
+        }
+
+        void flush_stats()
+        {
+            set(oooe_, 0L); set(oool_, 0L); set(win_size_, 0L);
+            set(entered_, 0L);
+            wait_hist_.clear(); hold_hist_.clear();
+        }
+
+        /* distributions of time (ns) spent waiting in enter() and
+         * between enter() and leave() */
+        const gu::LatencyHistogram& wait_hist() const { return wait_hist_; }
+        const gu::LatencyHistogram& hold_hist() const { return hold_hist_; }
+
+    private:
+
+        template <typename T>
+        static T get(const T& val)
+        {
+            T ret;
+            gu_atomic_get(const_cast<T*>(&val), &ret);
+            return ret;
+        }
+
+        template <typename T>
+        static void set(T& val, T to)
+        {
+            gu_atomic_set(&val, &to);
+        }
+
+        template <typename T>
+        static bool cas(T& val, T from, T to)
+        {
+            return gu_atomic_bool_cas(&val, from, to);
+        }
+
+        static ssize_t window_size(ssize_t size)
+        {
+            ssize_t ret(2);
+            while (ret < size) ret <<= 1;
+            return ret;
+        }
+
+        size_t indexof(wsrep_seqno_t seqno) const
+        {
+            return (seqno & process_mask_);
+        }
+
+        bool may_enter(const C& obj) const
+        {
+            return obj.condition(get(last_entered_), get(last_left_));
+        }
+
+        // Event futex: a waiter samples event_ before checking its condition
+        // and sleeps only if event_ has not changed since.
+        int wait_event(int ev)
+        {
+            gu_atomic_fetch_and_add(&event_waiters_, 1);
+            int const ret(gu::futex_wait(&event_, ev));
+            gu_atomic_fetch_and_sub(&event_waiters_, 1);
+            return ret;
+        }
+
+        int wait_event(int ev, const gu::datetime::Date& until)
+        {
+            gu_atomic_fetch_and_add(&event_waiters_, 1);
+            int const ret(gu::futex_wait(&event_, ev, until));
+            gu_atomic_fetch_and_sub(&event_waiters_, 1);
+            return ret;
+        }
+
+        void notify_event()
+        {
+            gu_atomic_fetch_and_add(&event_, 1);
+            if (get(event_waiters_) > 0) gu::futex_wake(&event_);
+        }
+
+        // slot may still hold FINISHED state of the previous owner, which
+        // is reset only after last_left_ has been advanced past it
+        void wait_retired(const Process& p, wsrep_seqno_t seqno) const
+        {
+            while (get(p.state_) == S_FINISHED && get(p.seqno_) != seqno)
+            {
+                sched_yield();
+            }
+        }
+
+        // wait until it is possible to grab slot in monitor,
+        // update last entered
+        void pre_enter(C& obj)
+        {
+            const wsrep_seqno_t obj_seqno(obj.seqno());
+
+            for (int ev(get(event_)); would_block(obj_seqno); ev = get(event_))
+                // TODO: exit on error
+            {
+                obj.unlock();
+                wait_event(ev);
+                obj.lock();
+            }
+
+            update_last_entered(obj_seqno);
+        }
+
+        void update_last_entered(wsrep_seqno_t seqno)
+        {
+            for (wsrep_seqno_t le(get(last_entered_)); le < seqno;
+                 le = get(last_entered_))
+            {
+                if (cas(last_entered_, le, seqno)) break;
+            }
+        }
+
+        // Advances last_left_ over consecutive finished slots. Advancing by
+        // one is claimed by CAS on last_left_, so concurrent leavers never
+        // retire the same slot twice.
+        // @return true if last_left_ was advanced by this call
+        bool update_last_left()
+        {
+            bool ret(false);
+
+            for (;;)
+            {
+                wsrep_seqno_t const ll(get(last_left_));
+                wsrep_seqno_t const next(ll + 1);
+                Process&            a(process_[indexof(next)]);
+
+                if (get(a.state_) != S_FINISHED || get(a.seqno_) != next) break;
+
+                if (cas(last_left_, ll, next))
+                {
+                    set(a.state_, int(S_IDLE));
+                    ret = true;
+                }
+            }
+
+            return ret;
+        }
+
+        void wake_up_next()
+        {
+            wsrep_seqno_t const le(get(last_entered_));
+
+            for (wsrep_seqno_t i = get(last_left_) + 1; i <= le; ++i)
+            {
+                Process& a(process_[indexof(i)]);
+                int      state;
+
+                // wait for concurrent check to complete, it might have used
+                // stale window boundaries
+                while ((state = get(a.state_)) == S_CHECKING) sched_yield();
+
+                if (S_WAITING == state &&
+                    cas(a.state_, int(S_WAITING), int(S_CHECKING)))
+                {
+                    // Same as in Monitor: state is set to APPLYING here, so
+                    // that canceling last_left_ + 1 can't leave window stuck.
+                    if (may_enter(*a.obj_))
+                    {
+                        set(a.state_, int(S_APPLYING));
+                        gu::futex_wake(&a.state_, 1);
+                    }
+                    else
+                    {
+                        set(a.state_, int(S_WAITING));
+                    }
+                }
+            }
+        }
+
+        void post_leave(const C& obj)
+        {
+            const wsrep_seqno_t obj_seqno(obj.seqno());
+            Process&            p(process_[indexof(obj_seqno)]);
+
+            p.obj_ = 0;
+            set(p.seqno_, obj_seqno);
+            set(p.state_, int(S_FINISHED));
+
+            if (update_last_left()) // we've shrunk window
+            {
+                gu_atomic_fetch_and_add(&oool_,
+                                        long(get(last_left_) > obj_seqno));
+                // wake up waiters that may remain above us
+                wake_up_next();
+                // window space, drain and wait() waiters
+                notify_event();
+            }
+            else if (wake_on_finish_)
+            {
+                wake_up_next();
+            }
+        }
+
+        void drain_common(wsrep_seqno_t seqno)
+        {
+            log_debug << "draining up to " << seqno;
+
+            if (get(last_left_) > seqno)
+            {
+                log_debug << "last left greater than drain seqno";
+                for (wsrep_seqno_t i = seqno; i <= get(last_left_); ++i)
+                {
+                    const Process& a(process_[indexof(i)]);
+                    log_debug << "applier " << i
+                              << " in state " << get(a.state_);
+                }
+            }
+
+            for (int ev(get(event_)); get(last_left_) < seqno; ev = get(event_))
+            {
+                wait_event(ev);
+            }
+        }
+
+        MonitorLF(const MonitorLF&);
+        void operator=(const MonitorLF&);
+
+        wsrep_seqno_t last_entered_;
+        wsrep_seqno_t last_left_;
+        wsrep_seqno_t drain_seqno_;
+        ssize_t const process_size_;
+        size_t  const process_mask_;
+        Process*      process_;
+        int           event_;         // futex word
+        int           event_waiters_;
+        long entered_;  // entered
+        long oooe_;     // out of order entered
+        long oool_;     // out of order left
+        long win_size_; // window between last_left_ and last_entered_
+        gu::LatencyHistogram wait_hist_;
+        gu::LatencyHistogram hold_hist_;
+        bool wake_on_finish_;
+    };
+}
+
+#endif // GALERA_MONITOR_LF_HPP
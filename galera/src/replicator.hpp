@@ -93,6 +93,9 @@ namespace galera
 
         // action source interface
         virtual void process_trx(void* recv_ctx, TrxHandle* trx) = 0;
+        // processes n remote trxs with consecutive local seqnos as a batch
+        virtual void process_trxs(void* recv_ctx, TrxHandle* const* trxs,
+                                  size_t n) = 0;
         virtual void process_commit_cut(wsrep_seqno_t seq,
                                         wsrep_seqno_t seqno_l) = 0;
         virtual void process_conf_change(void*                    recv_ctx,
@@ -145,7 +145,8 @@ galera::ReplicatorSMM::ReplicatorSMM(const struct wsrep_init_args* args)
     trx_params_         (data_dir_, -1,
                          KeySet::version(config_.get(Param::key_format)),
                          gu::from_string<int>(config_.get(
-                             Param::max_write_set_size))),
+                             Param::max_write_set_size)),
+                         0 /* no escalation until protocol is known */),
     uuid_               (WSREP_UUID_UNDEFINED),
     state_uuid_         (WSREP_UUID_UNDEFINED),
     state_uuid_str_     (),
@@ -168,17 +169,30 @@ galera::ReplicatorSMM::ReplicatorSMM(const struct wsrep_init_args* args)
     gcs_                (config_, gcache_, proto_max_, args->proto_ver,
                          args->node_name, args->node_incoming),
     service_thd_        (gcs_, gcache_),
+    check_pool_         (gu::from_string<int>(
+                             config_.get(Param::checksum_threads))),
     slave_pool_         (sizeof(TrxHandle), 1024, "SlaveTrxHandle"),
     as_                 (0),
-    gcs_as_             (slave_pool_, gcs_, *this, gcache_),
+    gcs_as_             (slave_pool_, gcs_, *this, gcache_,
+                         gu::from_string<long>(config_.get(Param::recv_batch))),
     ist_receiver_       (config_, slave_pool_, args->node_address),
     ist_senders_        (gcs_, gcache_),
     wsdb_               (),
     cert_               (config_, service_thd_),
-    local_monitor_      (),
-    apply_monitor_      (),
-    commit_monitor_     (),
+    local_monitor_      (monitor_window(config_)),
+    apply_monitor_      (monitor_window(config_)),
+    commit_monitor_     (monitor_window(config_)),
+    commit_group_       (),
+    apply_sched_        (apply_queue(config_)),
+    applier_tuner_      (),
     causal_read_timeout_(config_.get(Param::causal_read_timeout)),
+    precertify_         (config_.get<bool>(Param::precertify)),
+    group_commit_       (config_.get<bool>(Param::group_commit)),
+    appliers_mutex_     (),
+    auto_appliers_      (config_.get<bool>(Param::auto_appliers)),
+    compress_data_      (config_.get<bool>(Param::compress_data)),
+    key_escalation_threshold_(key_escalation_threshold(
+                                  config_.get(Param::key_escalation_threshold))),
     receivers_          (),
     replicated_         (),
     replicated_bytes_   (),
@@ -230,6 +244,13 @@ galera::ReplicatorSMM::ReplicatorSMM(const struct wsrep_init_args* args)
 
     local_monitor_.set_initial_position(0);
 
+    if (group_commit_ && co_mode_ != CommitOrder::NO_OOOC)
+    {
+        log_warn << Param::group_commit << " requires " << Param::commit_order
+                 << " = " << CommitOrder::NO_OOOC << ", disabling it.";
+        group_commit_ = false;
+    }
+
     wsrep_uuid_t  uuid;
     wsrep_seqno_t seqno;
 
@@ -251,11 +272,18 @@ galera::ReplicatorSMM::ReplicatorSMM(const struct wsrep_init_args* args)
 
     cc_seqno_ = seqno; // is it needed here?
     apply_monitor_.set_initial_position(seqno);
+    apply_monitor_.set_wake_on_finish(cert_.key_deps());
 
     if (co_mode_ != CommitOrder::BYPASS)
+    {
         commit_monitor_.set_initial_position(seqno);
+        commit_group_.set_initial_position(seqno);
+    }
+
+    cert_.assign_initial_position(seqno, trx_proto_ver(),
+                                  key_escalation(protocol_version_));
 
-    cert_.assign_initial_position(seqno, trx_proto_ver());
+    CheckPool::set_default_pool(&check_pool_);
 
     build_stats_vars(wsrep_stats_);
 }
@@ -279,6 +307,11 @@ galera::ReplicatorSMM::~ReplicatorSMM()
     case S_DESTROYED:
         break;
     }
+
+    if (CheckPool::default_pool() == &check_pool_)
+    {
+        CheckPool::set_default_pool(NULL);
+    }
 }
 
 
@@ -303,7 +336,9 @@ wsrep_status_t galera::ReplicatorSMM::connect(const std::string& cluster_name,
         ret = WSREP_NODE_FAIL;
     }
 
-    gcache_.reset();
+    /* cache history (possibly recovered on startup) is preserved only if it
+     * leads to the current state */
+    if (!gcache_.seqno_reset(to_gu_uuid(gcs_uuid), seqno)) gcache_.reset();
 
     if (ret == WSREP_OK &&
         (err = gcs_.connect(cluster_name, cluster_url, bootstrap)) != 0)
@@ -413,7 +448,35 @@ wsrep_status_t galera::ReplicatorSMM::async_recv(void* recv_ctx)
 }
 
 
-void galera::ReplicatorSMM::apply_trx(void* recv_ctx, TrxHandle* trx)
+void galera::ReplicatorSMM::sync_commit_group(void*         recv_ctx,
+                                              wsrep_seqno_t seqno)
+{
+    wsrep_seqno_t from, upto;
+
+    if (commit_group_.join(seqno, from, upto))
+    {
+        // leader: sync everything committed since the last sync
+        // sync request is a commit callback call with only F_SYNC flag set,
+        // meta tells the range (depends_on, gtid.seqno] to be made durable
+        wsrep_trx_meta_t meta = {{ state_uuid_, upto }, from };
+        wsrep_bool_t     exit_loop(false);
+
+        wsrep_cb_status_t const rcode(
+            commit_cb_(recv_ctx, GroupCommit::F_SYNC, &meta, &exit_loop,true));
+
+        if (gu_unlikely (rcode > 0))
+        {
+            commit_group_.failed();
+            gu_throw_fatal << "Group sync failed for seqnos " << from
+                           << " - " << upto;
+        }
+
+        commit_group_.synced(upto);
+    }
+}
+
+
+bool galera::ReplicatorSMM::apply_trx(void* recv_ctx, TrxHandle* trx)
 {
     assert(trx != 0);
     assert(trx->global_seqno() > 0);
@@ -421,7 +484,7 @@ void galera::ReplicatorSMM::apply_trx(void* recv_ctx, TrxHandle* trx)
     assert(trx->global_seqno() > STATE_SEQNO());
     assert(trx->is_local() == false);
 
-    ApplyOrder ao(*trx);
+    ApplyOrder ao(*trx, apply_monitor_);
     CommitOrder co(*trx, co_mode_);
 
     gu_trace(apply_monitor_.enter(ao));
@@ -444,7 +507,8 @@ void galera::ReplicatorSMM::apply_trx(void* recv_ctx, TrxHandle* trx)
     wsrep_cb_status_t const rcode(
         commit_cb_(
             recv_ctx,
-            TrxHandle::trx_flags_to_wsrep_flags(trx->flags()),
+            TrxHandle::trx_flags_to_wsrep_flags(trx->flags()) |
+            (group_commit_ ? GroupCommit::F_DEFER : 0),
             &meta,
             &exit_loop,
             true));
@@ -456,6 +520,12 @@ void galera::ReplicatorSMM::apply_trx(void* recv_ctx, TrxHandle* trx)
     {
         commit_monitor_.leave(co);
     }
+
+    if (group_commit_)
+    {
+        // let following trxs commit while we're waiting for sync
+        gu_trace(sync_commit_group(recv_ctx, trx->global_seqno()));
+    }
     trx->set_state(TrxHandle::S_COMMITTED);
 
     if (trx->local_seqno() != -1)
@@ -472,7 +542,7 @@ void galera::ReplicatorSMM::apply_trx(void* recv_ctx, TrxHandle* trx)
 
     apply_monitor_.leave(ao);
 
-    trx->set_exit_loop(exit_loop);
+    return exit_loop;
 }
 
 
@@ -495,6 +565,17 @@ wsrep_status_t galera::ReplicatorSMM::replicate(TrxHandle* trx,
         return retval;
     }
 
+    if (trx->new_version() &&
+        gu_unlikely(!write_set_compatible(trx->write_set_out(),
+                                          protocol_version_)))
+    {
+        log_debug << "Writeset of trx " << trx->trx_id()
+                  << " is not supported by protocol " << protocol_version_
+                  << ", aborting.";
+        trx->set_state(TrxHandle::S_MUST_ABORT);
+        goto must_abort;
+    }
+
     WriteSetNG::GatherVector actv;
 
     gcs_action act;
@@ -526,6 +607,22 @@ wsrep_status_t galera::ReplicatorSMM::replicate(TrxHandle* trx,
         assert (act.size > 0);
     }
 
+    wsrep_seqno_t last_seen(WSREP_SEQNO_UNDEFINED);
+
+    if (precertify_ && trx->new_version())
+    {
+        /* probe must use the same last seen seqno as the write set,
+         * so it is taken once, before scheduling, which may be delayed
+         * and retried */
+        last_seen = last_committed();
+
+        if (gu_unlikely(precertify(trx, actv, last_seen)))
+        {
+            trx->set_state(TrxHandle::S_MUST_ABORT);
+            goto must_abort;
+        }
+    }
+
     trx->set_state(TrxHandle::S_REPLICATING);
 
     ssize_t rcode(-1);
@@ -547,7 +644,8 @@ wsrep_status_t galera::ReplicatorSMM::replicate(TrxHandle* trx,
 
         if (trx->new_version())
         {
-            trx->set_last_seen_seqno(last_committed());
+            trx->set_last_seen_seqno(last_seen != WSREP_SEQNO_UNDEFINED ?
+                                     last_seen : last_committed());
             assert(trx->last_seen_seqno() >= 0);
             trx->unlock();
             assert (act.buf == NULL); // just a sanity check
@@ -1084,8 +1182,8 @@ writeset_from_handle (wsrep_po_handle_t& handle,
                 trx_params.working_dir_, wsrep_trx_id_t(&handle),
                 /* key format is not essential since we're not adding keys */
                 KeySet::version(trx_params.key_format_), NULL, 0,
-                0, WriteSetNG::MAX_VERSION, DataSet::MAX_VERSION, DataSet::MAX_VERSION,
-                trx_params.max_write_set_size_);
+                0, WriteSetNG::MAX_VERSION, trx_params.data_format_,
+                trx_params.data_format_, trx_params.max_write_set_size_);
 
             handle.opaque = ret;
         }
@@ -1215,34 +1313,191 @@ void galera::ReplicatorSMM::process_trx(void* recv_ctx, TrxHandle* trx)
 
     wsrep_status_t const retval(cert_and_catch(trx));
 
-    switch (retval)
+    process_certified(recv_ctx, trx, retval);
+}
+
+
+void galera::ReplicatorSMM::process_trxs(void*                   recv_ctx,
+                                         TrxHandle* const* const trxs,
+                                         size_t const            n)
+{
+    assert(recv_ctx != 0);
+    assert(n > 0);
+
+    if (1 == n)
     {
-    case WSREP_OK:
-        try
+        process_trx(recv_ctx, trxs[0]);
+        return;
+    }
+
+    std::vector<wsrep_status_t> retvals(n);
+
+    /* pretty much any exception here is fatal as it blocks local_monitor_ */
+    try
+    {
+        cert_trxs(trxs, n, &retvals[0]);
+    }
+    catch (std::exception& e)
+    {
+        log_fatal << "Certification exception: " << e.what();
+        abort();
+    }
+    catch (...)
+    {
+        log_fatal << "Unknown certification exception";
+        abort();
+    }
+
+    std::vector<TrxHandle*> certified;
+    certified.reserve(n);
+
+    for (size_t i(0); i < n; ++i)
+    {
+        if (certified_ok(trxs[i], retvals[i])) certified.push_back(trxs[i]);
+    }
+
+    if (certified.empty()) return;
+
+    if (apply_sched_.enabled())
+    {
+        // the whole batch is queued at once, so that other threads can
+        // apply it in parallel and the watcher never waits for a writeset
+        // held back by this thread
+        certified[0]->set_exit_loop(
+            schedule_trxs(recv_ctx, &certified[0], certified.size()));
+    }
+    else
+    {
+        for (size_t i(0); i < certified.size(); ++i)
         {
-            gu_trace(apply_trx(recv_ctx, trx));
+            certified[i]->set_exit_loop(
+                apply_certified(recv_ctx, certified[i]));
         }
-        catch (std::exception& e)
-        {
-            st_.mark_corrupt();
+    }
+}
 
-            log_fatal << "Failed to apply trx: " << *trx;
-            log_fatal << e.what();
-            log_fatal << "Node consistency compromized, aborting...";
-            abort();
+
+void galera::ReplicatorSMM::process_certified(void*          recv_ctx,
+                                              TrxHandle*     trx,
+                                              wsrep_status_t retval)
+{
+    if (!certified_ok(trx, retval)) return;
+
+    if (apply_sched_.enabled())
+    {
+        trx->set_exit_loop(schedule_trxs(recv_ctx, &trx, 1));
+    }
+    else
+    {
+        trx->set_exit_loop(apply_certified(recv_ctx, trx));
+    }
+}
+
+
+/* Returns true if remote trx passed certification and must be applied */
+bool galera::ReplicatorSMM::certified_ok(TrxHandle*     trx,
+                                         wsrep_status_t retval)
+{
+    switch (retval)
+    {
+    case WSREP_OK:
+        if (applier_tuner_.sample(trx->global_seqno() - trx->depends_seqno()))
+        {
+            tune_appliers();
         }
-        break;
+        return true;
     case WSREP_TRX_FAIL:
         // certification failed, apply monitor has been canceled
         trx->set_state(TrxHandle::S_ABORTING);
         trx->set_state(TrxHandle::S_ROLLED_BACK);
-        break;
+        return false;
     default:
         // this should not happen for remote actions
         gu_throw_error(EINVAL)
             << "unrecognized retval for remote trx certification: "
             << retval << " trx: " << *trx;
     }
+
+    return false; // not reached
+}
+
+
+bool galera::ReplicatorSMM::apply_certified(void* recv_ctx, TrxHandle* trx)
+{
+    try
+    {
+        return apply_trx(recv_ctx, trx);
+    }
+    catch (std::exception& e)
+    {
+        st_.mark_corrupt();
+
+        log_fatal << "Failed to apply trx: " << *trx;
+        log_fatal << e.what();
+        log_fatal << "Node consistency compromized, aborting...";
+        abort();
+    }
+
+    return false; // not reached
+}
+
+
+void galera::ReplicatorSMM::tune_appliers()
+{
+    gcs_stats stats;
+    gcs_.get_stats(&stats);
+
+    long const n(applier_tuner_.update(receivers_(), stats.recv_q_len));
+
+    // set_param() may be disabling it concurrently
+    gu::Lock lock(appliers_mutex_);
+    if (auto_appliers_) gcs_as_.set_active_max(n);
+}
+
+
+/* Queues certified trxs and applies whatever is ready in the queue.
+ * Returns true if exit was requested while committing any of the trxs
+ * applied by the calling thread. */
+bool galera::ReplicatorSMM::schedule_trxs(void*             recv_ctx,
+                                          TrxHandle* const* trxs,
+                                          size_t const      n)
+{
+    wsrep_seqno_t const own_first(trxs[0]->global_seqno());
+    wsrep_seqno_t const own_last(trxs[n - 1]->global_seqno());
+    bool                watcher(false);
+    bool                exit_loop(false);
+
+    // queue holds its own references, trx is locked by the thread applying it
+    for (size_t i(0); i < n; ++i)
+    {
+        trxs[i]->ref();
+        trxs[i]->unlock();
+    }
+
+    apply_sched_.push(trxs, n);
+
+    for (;;)
+    {
+        TrxHandle*    next(0);
+        wsrep_seqno_t wait_seqno(-1);
+
+        switch (apply_sched_.next(ApplyReady(apply_monitor_), own_first,
+                                  own_last, watcher, next, wait_seqno))
+        {
+        case ApplyScheduler::A_APPLY:
+            next->lock();
+            if (apply_certified(recv_ctx, next)) exit_loop = true;
+            next->unlock();
+            next->unref();
+            break;
+        case ApplyScheduler::A_WAIT:
+            apply_monitor_.wait(wait_seqno);
+            break;
+        case ApplyScheduler::A_RETURN:
+            for (size_t i(0); i < n; ++i) trxs[i]->lock();
+            return exit_loop;
+        }
+    }
 }
 
 
@@ -1295,6 +1550,16 @@ void galera::ReplicatorSMM::establish_protocol_versions (int proto_ver)
         trx_params_.version_ = 3;
         str_proto_ver_ = 2;
         break;
+    case 8:
+        // Compressed writeset data, no effect to TRX or STR protocols.
+        trx_params_.version_ = 3;
+        str_proto_ver_ = 2;
+        break;
+    case 9:
+        // Escalated key sets, no effect to TRX or STR protocols.
+        trx_params_.version_ = 3;
+        str_proto_ver_ = 2;
+        break;
     default:
         log_fatal << "Configuration change resulted in an unsupported protocol "
             "version: " << proto_ver << ". Can't continue.";
@@ -1302,6 +1567,9 @@ void galera::ReplicatorSMM::establish_protocol_versions (int proto_ver)
     };
 
     protocol_version_ = proto_ver;
+    trx_params_.data_format_ = data_format(protocol_version_);
+    trx_params_.key_escalation_threshold_ =
+        key_escalation_threshold(protocol_version_);
     log_info << "REPL Protocols: " << protocol_version_ << " ("
               << trx_params_.version_ << ", " << str_proto_ver_ << ")";
 }
@@ -1414,7 +1682,8 @@ galera::ReplicatorSMM::process_conf_change(void*                    recv_ctx,
 
         // we have to reset cert initial position here, SST does not contain
         // cert index yet (see #197).
-        cert_.assign_initial_position(group_seqno, trx_params_.version_);
+        cert_.assign_initial_position(group_seqno, trx_params_.version_,
+                                      key_escalation(protocol_version_));
         // at this point there is no ongoing master or slave transactions
         // and no new requests to service thread should be possible
 
@@ -1440,9 +1709,13 @@ galera::ReplicatorSMM::process_conf_change(void*                    recv_ctx,
             if (view_info.view == 1 || !app_wants_st)
             {
                 update_state_uuid (group_uuid);
+                gcache_.seqno_reset(to_gu_uuid(group_uuid), group_seqno);
                 apply_monitor_.set_initial_position(group_seqno);
                 if (co_mode_ != CommitOrder::BYPASS)
+                {
                     commit_monitor_.set_initial_position(group_seqno);
+                    commit_group_.set_initial_position(group_seqno);
+                }
             }
 
             if (state_() == S_CONNECTED || state_() == S_DONOR)
@@ -1696,59 +1969,7 @@ wsrep_status_t galera::ReplicatorSMM::cert(TrxHandle* trx)
 
     if (gu_likely (!interrupted))
     {
-        switch (cert_.append_trx(trx))
-        {
-        case Certification::TEST_OK:
-            if (gu_likely(applicable))
-            {
-                if (trx->state() == TrxHandle::S_CERTIFYING)
-                {
-                    retval = WSREP_OK;
-                }
-                else
-                {
-                    assert(trx->state() == TrxHandle::S_MUST_ABORT);
-                    trx->set_state(TrxHandle::S_MUST_REPLAY_AM);
-                    retval = WSREP_BF_ABORT;
-                }
-            }
-            else
-            {
-                // this can happen after SST position has been submitted
-                // but not all actions preceding SST initial position
-                // have been processed
-                trx->set_state(TrxHandle::S_MUST_ABORT);
-                retval = WSREP_TRX_FAIL;
-            }
-            break;
-        case Certification::TEST_FAILED:
-            if (gu_unlikely(trx->is_toi() && applicable)) // small sanity check
-            {
-                // may happen on configuration change
-                log_warn << "Certification failed for TO isolated action: "
-                         << *trx;
-                assert(0);
-            }
-            local_cert_failures_ += trx->is_local();
-            trx->set_state(TrxHandle::S_MUST_ABORT);
-            retval = WSREP_TRX_FAIL;
-            break;
-        }
-
-        if (gu_unlikely(WSREP_TRX_FAIL == retval))
-        {
-            report_last_committed(cert_.set_trx_committed(trx));
-        }
-
-        // at this point we are about to leave local_monitor_. Make sure
-        // trx checksum was alright before that.
-        trx->verify_checksum();
-
-        // we must do it 'in order' for std::map reasons, so keeping
-        // it inside the monitor
-        gcache_.seqno_assign (trx->action(),
-                              trx->global_seqno(),
-                              trx->depends_seqno());
+        retval = cert_verdict(trx, cert_.append_trx(trx), applicable);
 
         local_monitor_.leave(lo);
     }
@@ -1776,6 +1997,136 @@ wsrep_status_t galera::ReplicatorSMM::cert(TrxHandle* trx)
     return retval;
 }
 
+/* Sets trx state according to certification result and assigns seqnos to
+ * trx action in gcache. Must be called in local_monitor_. */
+wsrep_status_t
+galera::ReplicatorSMM::cert_verdict(TrxHandle*                const trx,
+                                    Certification::TestResult const res,
+                                    bool                      const applicable)
+{
+    wsrep_status_t retval(WSREP_OK);
+
+    switch (res)
+    {
+    case Certification::TEST_OK:
+        if (gu_likely(applicable))
+        {
+            if (trx->state() == TrxHandle::S_CERTIFYING)
+            {
+                retval = WSREP_OK;
+            }
+            else
+            {
+                assert(trx->state() == TrxHandle::S_MUST_ABORT);
+                trx->set_state(TrxHandle::S_MUST_REPLAY_AM);
+                retval = WSREP_BF_ABORT;
+            }
+        }
+        else
+        {
+            // this can happen after SST position has been submitted
+            // but not all actions preceding SST initial position
+            // have been processed
+            trx->set_state(TrxHandle::S_MUST_ABORT);
+            retval = WSREP_TRX_FAIL;
+        }
+        break;
+    case Certification::TEST_FAILED:
+        if (gu_unlikely(trx->is_toi() && applicable)) // small sanity check
+        {
+            // may happen on configuration change
+            log_warn << "Certification failed for TO isolated action: "
+                     << *trx;
+            assert(0);
+        }
+        local_cert_failures_ += trx->is_local();
+        trx->set_state(TrxHandle::S_MUST_ABORT);
+        retval = WSREP_TRX_FAIL;
+        break;
+    }
+
+    if (gu_unlikely(WSREP_TRX_FAIL == retval))
+    {
+        report_last_committed(cert_.set_trx_committed(trx));
+    }
+
+    // at this point we are about to leave local_monitor_. Make sure
+    // trx checksum was alright before that.
+    trx->verify_checksum();
+
+    // we must do it 'in order' for std::map reasons, so keeping
+    // it inside the monitor
+    gcache_.seqno_assign (trx->action(),
+                          trx->global_seqno(),
+                          trx->depends_seqno());
+
+    return retval;
+}
+
+
+/* Certifies n remote trxs with consecutive local seqnos entering
+ * local_monitor_ only once: the first trx enters the monitor, the rest are
+ * self-canceled after it leaves, so nobody else can get in between. */
+void
+galera::ReplicatorSMM::cert_trxs(TrxHandle* const* const trxs,
+                                 size_t const            n,
+                                 wsrep_status_t* const   retvals)
+{
+    assert(n > 0);
+
+    std::vector<Certification::TestResult> results(n);
+    std::vector<bool>                      applicable(n);
+
+    for (size_t i(0); i < n; ++i)
+    {
+        TrxHandle* const trx(trxs[i]);
+
+        assert(trx->state() == TrxHandle::S_REPLICATING);
+        assert(trx->local_seqno()     != WSREP_SEQNO_UNDEFINED);
+        assert(trx->global_seqno()    != WSREP_SEQNO_UNDEFINED);
+        assert(trx->last_seen_seqno() >= 0);
+        assert(trx->last_seen_seqno() < trx->global_seqno());
+        assert(0 == i || trx->local_seqno() == trxs[i-1]->local_seqno() + 1);
+
+        trx->set_state(TrxHandle::S_CERTIFYING);
+    }
+
+    LocalOrder lo(*trxs[0]);
+
+    // remote trxs are never interrupted
+    gu_trace(local_monitor_.enter(lo));
+
+    cert_.append_trxs(trxs, n, &results[0]);
+
+    for (size_t i(0); i < n; ++i)
+    {
+        applicable[i] = (trxs[i]->global_seqno() > STATE_SEQNO());
+        retvals[i]    = cert_verdict(trxs[i], results[i], applicable[i]);
+    }
+
+    local_monitor_.leave(lo);
+
+    for (size_t i(1); i < n; ++i)
+    {
+        LocalOrder lo_i(*trxs[i]);
+        local_monitor_.self_cancel(lo_i);
+    }
+
+    for (size_t i(0); i < n; ++i)
+    {
+        if (gu_unlikely(WSREP_TRX_FAIL == retvals[i] && applicable[i]))
+        {
+            // applicable but failed certification: self-cancel monitors
+            ApplyOrder  ao(*trxs[i]);
+            CommitOrder co(*trxs[i], co_mode_);
+
+            apply_monitor_.self_cancel(ao);
+            if (co_mode_ != CommitOrder::BYPASS) commit_monitor_.self_cancel(co);
+        }
+    }
+}
+
+
 /* pretty much any exception in cert() is fatal as it blocks local_monitor_ */
 wsrep_status_t galera::ReplicatorSMM::cert_and_catch(TrxHandle* trx)
 {
@@ -1825,6 +2176,29 @@ wsrep_status_t galera::ReplicatorSMM::cert_for_aborted(TrxHandle* trx)
 }
 
 
+/* Local trx is bound to fail certification if some of its keys were
+ * modified by a conflicting trx after last_seen. Such write set is
+ * not worth replicating. */
+bool
+galera::ReplicatorSMM::precertify(TrxHandle* const                trx,
+                                  const WriteSetNG::GatherVector& actv,
+                                  wsrep_seqno_t const             last_seen)
+{
+    KeySetIn                ksi;
+    std::vector<gu::byte_t> buf;
+
+    trx->write_set_out().gathered_keys(actv, ksi, buf);
+
+    if (cert_.precertify(trx, ksi, last_seen))
+    {
+        ++local_cert_failures_;
+        return true;
+    }
+
+    return false;
+}
+
+
 void
 galera::ReplicatorSMM::update_state_uuid (const wsrep_uuid_t& uuid)
 {
@@ -16,11 +16,15 @@
 #include "GCache.hpp"
 #include "gcs.hpp"
 #include "monitor.hpp"
+#include "group_commit.hpp"
+#include "apply_scheduler.hpp"
+#include "applier_tuner.hpp"
 #include "wsdb.hpp"
 #include "certification.hpp"
 #include "trx_handle.hpp"
 #include "write_set.hpp"
 #include "galera_service_thd.hpp"
+#include "check_pool.hpp"
 #include "fsm.hpp"
 #include "gcs_action_source.hpp"
 #include "ist.hpp"
@@ -91,7 +95,7 @@ namespace galera
             wsdb_.discard_conn(conn_id);
         }
 
-        void apply_trx(void* recv_ctx, TrxHandle* trx);
+        bool apply_trx(void* recv_ctx, TrxHandle* trx);
 
         wsrep_status_t replicate(TrxHandle* trx, wsrep_trx_meta_t*);
         void abort_trx(TrxHandle* trx) ;
@@ -120,6 +124,7 @@ namespace galera
                                     int                 rcode);
 
         void process_trx(void* recv_ctx, TrxHandle* trx);
+        void process_trxs(void* recv_ctx, TrxHandle* const* trxs, size_t n);
         void process_commit_cut(wsrep_seqno_t seq, wsrep_seqno_t seqno_l);
         void process_conf_change(void* recv_ctx,
                                  const wsrep_view_info_t& view,
@@ -173,6 +178,15 @@ namespace galera
             static const std::string commit_order;
             static const std::string causal_read_timeout;
             static const std::string max_write_set_size;
+            static const std::string key_escalation_threshold;
+            static const std::string precertify;
+            static const std::string group_commit;
+            static const std::string monitor_window;
+            static const std::string apply_queue;
+            static const std::string auto_appliers;
+            static const std::string recv_batch;
+            static const std::string checksum_threads;
+            static const std::string compress_data;
         };
 
         typedef std::pair<std::string, std::string> Default;
@@ -200,9 +214,25 @@ namespace galera
             }
         }
 
+        void           sync_commit_group(void* recv_ctx, wsrep_seqno_t seqno);
         wsrep_status_t cert(TrxHandle* trx);
         wsrep_status_t cert_and_catch(TrxHandle* trx);
+        void           cert_trxs(TrxHandle* const* trxs, size_t n,
+                                 wsrep_status_t* retvals);
+        wsrep_status_t cert_verdict(TrxHandle* trx,
+                                    Certification::TestResult res,
+                                    bool applicable);
+        void           process_certified(void* recv_ctx, TrxHandle* trx,
+                                         wsrep_status_t retval);
+        bool           certified_ok(TrxHandle* trx, wsrep_status_t retval);
+        bool           apply_certified(void* recv_ctx, TrxHandle* trx);
+        bool           schedule_trxs(void* recv_ctx, TrxHandle* const* trxs,
+                                     size_t n);
+        void           tune_appliers();
         wsrep_status_t cert_for_aborted(TrxHandle* trx);
+        bool           precertify(TrxHandle* trx,
+                                  const WriteSetNG::GatherVector& actv,
+                                  wsrep_seqno_t last_seen);
 
         void update_state_uuid (const wsrep_uuid_t& u);
         void update_incoming_list (const wsrep_view_info_t& v);
@@ -247,7 +277,12 @@ namespace galera
         {
         public:
 
-            ApplyOrder(TrxHandle& trx) : trx_(trx) { }
+            ApplyOrder(TrxHandle& trx) : trx_(trx), mon_(0) { }
+
+            /* if trx has key-level dependencies, waits only for them to
+             * leave mon instead of everything up to depends_seqno */
+            ApplyOrder(TrxHandle& trx, const MonitorOf<ApplyOrder>::type& mon)
+                : trx_(trx), mon_(&mon) { }
 
             void lock()   { trx_.lock();   }
             void unlock() { trx_.unlock(); }
@@ -258,12 +293,55 @@ namespace galera
                            wsrep_seqno_t last_left) const
             {
                 return (trx_.is_local() == true ||
-                        last_left >= trx_.depends_seqno());
+                        last_left >= trx_.depends_seqno() ||
+                        (mon_ != 0 && key_deps_finished(last_left)));
             }
 
         private:
+
+            bool key_deps_finished(wsrep_seqno_t last_left) const
+            {
+                if (!trx_.key_deps_valid() ||
+                    last_left < trx_.key_deps_floor()) return false;
+
+                for (int i(0); i < trx_.key_deps_size(); ++i)
+                {
+                    if (!mon_->finished(trx_.key_dep(i))) return false;
+                }
+
+                return true;
+            }
+
             ApplyOrder(const ApplyOrder&);
-            TrxHandle& trx_;
+            TrxHandle&                         trx_;
+            const MonitorOf<ApplyOrder>::type* mon_;
+        };
+
+        /* ApplyScheduler predicate */
+        class ApplyReady
+        {
+        public:
+
+            explicit
+            ApplyReady(const MonitorOf<ApplyOrder>::type& mon) : mon_(mon) { }
+
+            bool operator()(TrxHandle& trx) const
+            {
+                ApplyOrder const ao(trx, mon_);
+                return mon_.ready(ao);
+            }
+
+            /* trx is ready once this seqno has left, key dependencies
+             * may make it ready earlier */
+            wsrep_seqno_t wait_seqno(TrxHandle& trx) const
+            {
+                return std::max(trx.depends_seqno(),
+                                trx.global_seqno() - mon_.size() + 1);
+            }
+
+        private:
+
+            const MonitorOf<ApplyOrder>::type& mon_;
         };
 
     public:
@@ -381,6 +459,45 @@ namespace galera
 
         void establish_protocol_versions (int version);
 
+        /* compressed data can be sent only if all members understand it */
+        static DataSet::Version max_data_format (int const proto_ver)
+        {
+            return (proto_ver >= 8) ? DataSet::VER2 : DataSet::VER1;
+        }
+
+        DataSet::Version data_format (int const proto_ver) const
+        {
+            return compress_data_ ? max_data_format(proto_ver) : DataSet::VER1;
+        }
+
+        /* escalated key sets are certified differently, so keys can be
+         * escalated only if all members honour WriteSetNG::F_ESCALATED */
+        static bool key_escalation (int const proto_ver)
+        {
+            return (proto_ver >= 9);
+        }
+
+        /* writeset format is fixed when trx is created, so it may be not
+         * understood by all members after protocol downgrade */
+        static bool write_set_compatible (const WriteSetOut& ws,
+                                          int const          proto_ver)
+        {
+            return (ws.data_version() <= max_data_format(proto_ver) &&
+                    (key_escalation(proto_ver) ||
+                     !(ws.flags() & WriteSetNG::F_ESCALATED)));
+        }
+
+        int key_escalation_threshold (int const proto_ver) const
+        {
+            return key_escalation(proto_ver) ? key_escalation_threshold_ : 0;
+        }
+
+        static int key_escalation_threshold (const std::string& value);
+
+        static size_t apply_queue (const gu::Config& conf);
+
+        static ssize_t monitor_window (const gu::Config& conf);
+
         bool state_transfer_required(const wsrep_view_info_t& view_info);
 
         void prepare_for_IST (void*& req, ssize_t& req_len,
@@ -441,7 +558,11 @@ namespace galera
          * |                 5 |              3 |              1 |
          * |                 6 |              3 |              2 |
          * |                 7 |              3 |              2 |
+         * |                 8 |              3 |              2 |
+         * |                 9 |              3 |              2 |
          * -------------------------------------------------------
+         * Protocol 8 allows compressed writeset data (DataSet::VER2).
+         * Protocol 9 allows escalated key sets (WriteSetNG::F_ESCALATED).
          */
 
         int                    str_proto_ver_;// state transfer request protocol
@@ -490,6 +611,7 @@ namespace galera
         gcache::GCache gcache_;
         GCS_IMPL       gcs_;
         ServiceThd     service_thd_;
+        CheckPool      check_pool_;
 
         // action sources
         TrxHandle::SlavePool slave_pool_;
@@ -503,10 +625,19 @@ namespace galera
         Certification   cert_;
 
         // concurrency control
-        Monitor<LocalOrder>  local_monitor_;
-        Monitor<ApplyOrder>  apply_monitor_;
-        Monitor<CommitOrder> commit_monitor_;
+        MonitorOf<LocalOrder>::type  local_monitor_;
+        MonitorOf<ApplyOrder>::type  apply_monitor_;
+        MonitorOf<CommitOrder>::type commit_monitor_;
+        GroupCommit                  commit_group_;
+        ApplyScheduler               apply_sched_;
+        ApplierTuner                 applier_tuner_;
         gu::datetime::Period causal_read_timeout_;
+        bool                 precertify_; // probe cert index before repl
+        bool                 group_commit_; // sync applied trxs in groups
+        gu::Mutex            appliers_mutex_; // serializes active max changes
+        bool                 auto_appliers_; // park excess applier threads
+        bool                 compress_data_; // compress writeset data
+        int                  key_escalation_threshold_; // configured value
 
         // counters
         gu::Atomic<size_t>    receivers_;
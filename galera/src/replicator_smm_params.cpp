@@ -23,8 +23,26 @@ const std::string galera::ReplicatorSMM::Param::key_format =
     common_prefix + "key_format";
 const std::string galera::ReplicatorSMM::Param::max_write_set_size =
     common_prefix + "max_ws_size";
-
-int const galera::ReplicatorSMM::MAX_PROTO_VER(7);
+const std::string galera::ReplicatorSMM::Param::key_escalation_threshold =
+    common_prefix + "key_escalation_threshold";
+const std::string galera::ReplicatorSMM::Param::precertify =
+    common_prefix + "precertify";
+const std::string galera::ReplicatorSMM::Param::group_commit =
+    common_prefix + "group_commit";
+const std::string galera::ReplicatorSMM::Param::monitor_window =
+    common_prefix + "monitor_window";
+const std::string galera::ReplicatorSMM::Param::apply_queue =
+    common_prefix + "apply_queue";
+const std::string galera::ReplicatorSMM::Param::auto_appliers =
+    common_prefix + "auto_appliers";
+const std::string galera::ReplicatorSMM::Param::recv_batch =
+    common_prefix + "recv_batch";
+const std::string galera::ReplicatorSMM::Param::checksum_threads =
+    common_prefix + "checksum_threads";
+const std::string galera::ReplicatorSMM::Param::compress_data =
+    common_prefix + "compress_data";
+
+int const galera::ReplicatorSMM::MAX_PROTO_VER(9);
 
 galera::ReplicatorSMM::Defaults::Defaults() : map_()
 {
@@ -36,6 +54,16 @@ galera::ReplicatorSMM::Defaults::Defaults() : map_()
     const int max_write_set_size(galera::WriteSetNG::MAX_SIZE);
     map_.insert(Default(Param::max_write_set_size,
                         gu::to_string(max_write_set_size)));
+    map_.insert(Default(Param::key_escalation_threshold, "0"));
+    map_.insert(Default(Param::precertify, "no"));
+    map_.insert(Default(Param::group_commit, "no"));
+    map_.insert(Default(Param::monitor_window,
+                        gu::to_string(Monitor<LocalOrder>::DEFAULT_SIZE)));
+    map_.insert(Default(Param::apply_queue, "0"));
+    map_.insert(Default(Param::auto_appliers, "no"));
+    map_.insert(Default(Param::recv_batch, "1"));
+    map_.insert(Default(Param::checksum_threads, "2"));
+    map_.insert(Default(Param::compress_data, "no"));
 }
 
 const galera::ReplicatorSMM::Defaults galera::ReplicatorSMM::defaults;
@@ -112,12 +140,71 @@ galera::ReplicatorSMM::ParseOptions::ParseOptions(gu::Config&       conf,
 }
 
 
+/* 0 disables key escalation */
+int
+galera::ReplicatorSMM::key_escalation_threshold (const std::string& value)
+{
+    int const ret(gu::from_string<int>(value));
+
+    if (ret < 0)
+    {
+        gu_throw_error(EINVAL) << "Bad value '" << value << "' for '"
+                               << Param::key_escalation_threshold
+                               << "': must be non-negative, 0 disables "
+                               << "key escalation";
+    }
+
+    return ret;
+}
+
+
+ssize_t
+galera::ReplicatorSMM::monitor_window (const gu::Config& conf)
+{
+    static ssize_t const max_window(1 << 20);
+
+    std::string const& value(conf.get(Param::monitor_window));
+    ssize_t const      ret(gu::from_string<ssize_t>(value));
+
+    if (ret < 1 || ret > max_window)
+    {
+        gu_throw_error(EINVAL) << "Bad value '" << value << "' for '"
+                               << Param::monitor_window
+                               << "': must be in range [1, " << max_window
+                               << "]";
+    }
+
+    return ret;
+}
+
+
+size_t
+galera::ReplicatorSMM::apply_queue (const gu::Config& conf)
+{
+    size_t const ret(gu::from_string<size_t>(conf.get(Param::apply_queue)));
+    long   const batch(gu::from_string<long>(conf.get(Param::recv_batch)));
+
+    /* writesets received in a batch are handed to the scheduler together,
+     * so that they can be applied by other threads in parallel */
+    if (0 == ret && batch > 1)
+    {
+        log_info << "Enabling " << Param::apply_queue << " = " << batch
+                 << " for " << Param::recv_batch << " = " << batch;
+        return batch;
+    }
+
+    return ret;
+}
+
+
 /* helper for param_set() below */
 void
 galera::ReplicatorSMM::set_param (const std::string& key,
                                   const std::string& value)
 {
-    if (key == Param::commit_order)
+    if (key == Param::commit_order || key == Param::group_commit ||
+        key == Param::monitor_window || key == Param::apply_queue ||
+        key == Param::recv_batch || key == Param::checksum_threads)
     {
         log_error << "setting '" << key << "' during runtime not allowed";
         gu_throw_error(EPERM)
@@ -127,6 +214,22 @@ galera::ReplicatorSMM::set_param (const std::string& key,
     {
         causal_read_timeout_ = gu::datetime::Period(value);
     }
+    else if (key == Param::precertify)
+    {
+        precertify_ = gu::Config::from_config<bool>(value);
+    }
+    else if (key == Param::auto_appliers)
+    {
+        bool const val(gu::Config::from_config<bool>(value));
+        gu::Lock lock(appliers_mutex_);
+        auto_appliers_ = val;
+        if (!auto_appliers_) gcs_as_.set_active_max(0);
+    }
+    else if (key == Param::compress_data)
+    {
+        compress_data_ = gu::Config::from_config<bool>(value);
+        trx_params_.data_format_ = data_format(protocol_version_);
+    }
     else if (key == Param::base_host ||
              key == Param::base_port ||
              key == Param::proto_max)
@@ -142,6 +245,12 @@ galera::ReplicatorSMM::set_param (const std::string& key,
     {
         trx_params_.max_write_set_size_ = gu::from_string<int>(value);
     }
+    else if (key == Param::key_escalation_threshold)
+    {
+        key_escalation_threshold_ = key_escalation_threshold(value);
+        trx_params_.key_escalation_threshold_ =
+            key_escalation_threshold(protocol_version_);
+    }
     else
     {
         log_warn << "parameter '" << "' not found";
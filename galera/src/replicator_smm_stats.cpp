@@ -21,6 +21,17 @@ static const char* state_str[GALERA_STAGE_MAX] =
     "Destroyed"
 };
 
+// fills 3 consecutive stats vars starting from first with p50, p95 and p99
+static void
+latency_stats(std::vector<struct wsrep_stats_var>& sv,
+              size_t const                        first,
+              const gu::LatencyHistogram&         hist)
+{
+    sv[first    ].value._int64 = hist.percentile(0.50);
+    sv[first + 1].value._int64 = hist.percentile(0.95);
+    sv[first + 2].value._int64 = hist.percentile(0.99);
+}
+
 // @todo: should be protected static member of the parent class
 static wsrep_member_status_t state2stats(galera::ReplicatorSMM::State state)
 {
@@ -111,6 +122,29 @@ typedef enum status_vars
     STATS_CERT_INDEX_SIZE,
     STATS_CAUSAL_READS,
     STATS_CERT_INTERVAL,
+    STATS_CERT_DEPS_WINDOW,
+    STATS_LOCAL_WAIT_P50,
+    STATS_LOCAL_WAIT_P95,
+    STATS_LOCAL_WAIT_P99,
+    STATS_LOCAL_HOLD_P50,
+    STATS_LOCAL_HOLD_P95,
+    STATS_LOCAL_HOLD_P99,
+    STATS_APPLY_WAIT_P50,
+    STATS_APPLY_WAIT_P95,
+    STATS_APPLY_WAIT_P99,
+    STATS_APPLY_HOLD_P50,
+    STATS_APPLY_HOLD_P95,
+    STATS_APPLY_HOLD_P99,
+    STATS_COMMIT_WAIT_P50,
+    STATS_COMMIT_WAIT_P95,
+    STATS_COMMIT_WAIT_P99,
+    STATS_COMMIT_HOLD_P50,
+    STATS_COMMIT_HOLD_P95,
+    STATS_COMMIT_HOLD_P99,
+    STATS_APPLY_QUEUED,
+    STATS_APPLY_STOLEN,
+    STATS_APPLIERS_RECOMMENDED,
+    STATS_APPLIERS_PARKED,
     STATS_INCOMING_LIST,
     STATS_MAX
 } StatusVars;
@@ -156,6 +190,29 @@ static const struct wsrep_stats_var wsrep_stats[STATS_MAX + 1] =
     { "cert_index_size",          WSREP_VAR_INT64,  { 0 }  },
     { "causal_reads",             WSREP_VAR_INT64,  { 0 }  },
     { "cert_interval",            WSREP_VAR_DOUBLE, { 0 }  },
+    { "cert_deps_window",         WSREP_VAR_INT64,  { 0 }  },
+    { "local_wait_p50_ns",        WSREP_VAR_INT64,  { 0 }  },
+    { "local_wait_p95_ns",        WSREP_VAR_INT64,  { 0 }  },
+    { "local_wait_p99_ns",        WSREP_VAR_INT64,  { 0 }  },
+    { "local_hold_p50_ns",        WSREP_VAR_INT64,  { 0 }  },
+    { "local_hold_p95_ns",        WSREP_VAR_INT64,  { 0 }  },
+    { "local_hold_p99_ns",        WSREP_VAR_INT64,  { 0 }  },
+    { "apply_wait_p50_ns",        WSREP_VAR_INT64,  { 0 }  },
+    { "apply_wait_p95_ns",        WSREP_VAR_INT64,  { 0 }  },
+    { "apply_wait_p99_ns",        WSREP_VAR_INT64,  { 0 }  },
+    { "apply_hold_p50_ns",        WSREP_VAR_INT64,  { 0 }  },
+    { "apply_hold_p95_ns",        WSREP_VAR_INT64,  { 0 }  },
+    { "apply_hold_p99_ns",        WSREP_VAR_INT64,  { 0 }  },
+    { "commit_wait_p50_ns",       WSREP_VAR_INT64,  { 0 }  },
+    { "commit_wait_p95_ns",       WSREP_VAR_INT64,  { 0 }  },
+    { "commit_wait_p99_ns",       WSREP_VAR_INT64,  { 0 }  },
+    { "commit_hold_p50_ns",       WSREP_VAR_INT64,  { 0 }  },
+    { "commit_hold_p95_ns",       WSREP_VAR_INT64,  { 0 }  },
+    { "commit_hold_p99_ns",       WSREP_VAR_INT64,  { 0 }  },
+    { "apply_queued",             WSREP_VAR_INT64,  { 0 }  },
+    { "apply_stolen",             WSREP_VAR_INT64,  { 0 }  },
+    { "appliers_recommended",     WSREP_VAR_INT64,  { 0 }  },
+    { "appliers_parked",          WSREP_VAR_INT64,  { 0 }  },
     { "incoming_addresses",       WSREP_VAR_STRING, { 0 }  },
     { 0,                          WSREP_VAR_STRING, { 0 }  }
 };
@@ -217,29 +274,43 @@ galera::ReplicatorSMM::stats_get() const
     double avg_cert_interval(0);
     double avg_deps_dist(0);
     size_t index_size(0);
-    cert_.stats_get(avg_cert_interval, avg_deps_dist, index_size);
+    size_t deps_window(0);
+    cert_.stats_get(avg_cert_interval, avg_deps_dist, index_size, deps_window);
 
     sv[STATS_CERT_DEPS_DISTANCE  ].value._double = avg_deps_dist;
     sv[STATS_CERT_INTERVAL       ].value._double = avg_cert_interval;
     sv[STATS_CERT_INDEX_SIZE     ].value._int64 = index_size;
+    sv[STATS_CERT_DEPS_WINDOW    ].value._int64 = deps_window;
 
     double oooe;
     double oool;
     double win;
-    const_cast<Monitor<ApplyOrder>&>(apply_monitor_).
+    const_cast<MonitorOf<ApplyOrder>::type&>(apply_monitor_).
         get_stats(&oooe, &oool, &win);
 
     sv[STATS_APPLY_OOOE          ].value._double = oooe;
     sv[STATS_APPLY_OOOL          ].value._double = oool;
     sv[STATS_APPLY_WINDOW        ].value._double = win;
 
-    const_cast<Monitor<CommitOrder>&>(commit_monitor_).
+    const_cast<MonitorOf<CommitOrder>::type&>(commit_monitor_).
         get_stats(&oooe, &oool, &win);
 
     sv[STATS_COMMIT_OOOE         ].value._double = oooe;
     sv[STATS_COMMIT_OOOL         ].value._double = oool;
     sv[STATS_COMMIT_WINDOW       ].value._double = win;
 
+    latency_stats(sv, STATS_LOCAL_WAIT_P50,  local_monitor_.wait_hist());
+    latency_stats(sv, STATS_LOCAL_HOLD_P50,  local_monitor_.hold_hist());
+    latency_stats(sv, STATS_APPLY_WAIT_P50,  apply_monitor_.wait_hist());
+    latency_stats(sv, STATS_APPLY_HOLD_P50,  apply_monitor_.hold_hist());
+    latency_stats(sv, STATS_COMMIT_WAIT_P50, commit_monitor_.wait_hist());
+    latency_stats(sv, STATS_COMMIT_HOLD_P50, commit_monitor_.hold_hist());
+
+    sv[STATS_APPLY_QUEUED        ].value._int64  = apply_sched_.queued();
+    sv[STATS_APPLY_STOLEN        ].value._int64  = apply_sched_.stolen();
+    sv[STATS_APPLIERS_RECOMMENDED].value._int64  =
+        applier_tuner_.recommended();
+    sv[STATS_APPLIERS_PARKED     ].value._int64  = gcs_as_.parked();
 
     sv[STATS_LOCAL_STATE         ].value._int64  = state2stats(state_());
     sv[STATS_LOCAL_STATE_COMMENT ].value._string = state2stats_str(state_(),
@@ -332,6 +403,8 @@ galera::ReplicatorSMM::stats_reset()
 
     gcs_.flush_stats ();
 
+    local_monitor_.flush_stats();
+
     apply_monitor_.flush_stats();
 
     commit_monitor_.flush_stats();
@@ -662,8 +662,9 @@ ReplicatorSMM::request_state_transfer (void* recv_ctx,
     state_.shift_to(S_JOINING);
     sst_state_ = SST_WAIT;
     /* while waiting for state transfer to complete is a good point
-     * to reset gcache, since it may involve some IO too */
-    gcache_.seqno_reset();
+     * to reset gcache, since it may involve some IO too. History leading to
+     * the local state is kept in case IST follows. */
+    gcache_.seqno_reset(to_gu_uuid(group_uuid), STATE_SEQNO());
 
     if (sst_req_len != 0)
     {
@@ -695,6 +696,8 @@ ReplicatorSMM::request_state_transfer (void* recv_ctx,
         else
         {
             update_state_uuid (sst_uuid_);
+            /* SST may have left a gap after the kept history */
+            gcache_.seqno_reset(to_gu_uuid(sst_uuid_), sst_seqno_);
             apply_monitor_.set_initial_position(-1);
             apply_monitor_.set_initial_position(sst_seqno_);
 
@@ -702,6 +705,7 @@ ReplicatorSMM::request_state_transfer (void* recv_ctx,
             {
                 commit_monitor_.set_initial_position(-1);
                 commit_monitor_.set_initial_position(sst_seqno_);
+                commit_group_.set_initial_position(sst_seqno_);
             }
 
             log_debug << "Installed new state: " << state_uuid_ << ":" << sst_seqno_;
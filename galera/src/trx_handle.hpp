@@ -44,10 +44,16 @@ namespace galera
             int             version_;
             KeySet::Version key_format_;
             int             max_write_set_size_;
+            int             key_escalation_threshold_;
+            DataSet::Version data_format_;
             Params (const std::string& wdir, int ver, KeySet::Version kformat,
-                    int max_write_set_size = WriteSetNG::MAX_SIZE) :
+                    int max_write_set_size = WriteSetNG::MAX_SIZE,
+                    int key_escalation_threshold = 0,
+                    DataSet::Version dformat = DataSet::VER1) :
                 working_dir_(wdir), version_(ver), key_format_(kformat),
-                max_write_set_size_(max_write_set_size) {}
+                max_write_set_size_(max_write_set_size),
+                key_escalation_threshold_(key_escalation_threshold),
+                data_format_(dformat) {}
         };
 
         static const Params Defaults;
@@ -62,7 +68,8 @@ namespace galera
             F_ANNOTATION  = 1 << 5,
             F_ISOLATION   = 1 << 6,
             F_PA_UNSAFE   = 1 << 7,
-            F_PREORDERED  = 1 << 8
+            F_PREORDERED  = 1 << 8,
+            F_ESCALATED   = 1 << 9
         };
 
         static inline uint32_t wsrep_flags_to_trx_flags (uint32_t flags)
@@ -106,6 +113,7 @@ namespace galera
 
             if (flags & WriteSetNG::F_TOI)       ret |= F_ISOLATION;
             if (flags & WriteSetNG::F_PA_UNSAFE) ret |= F_PA_UNSAFE;
+            if (flags & WriteSetNG::F_ESCALATED) ret |= F_ESCALATED;
 
             return ret;
         }
@@ -135,6 +143,12 @@ namespace galera
             return ((write_set_flags_ & F_PREORDERED) != 0);
         }
 
+        /* some row-level keys were replaced with table-level ones */
+        bool keys_escalated() const
+        {
+            return ((write_set_flags_ & F_ESCALATED) != 0);
+        }
+
         typedef enum
         {
             S_EXECUTING,
@@ -304,6 +318,64 @@ namespace galera
             depends_seqno_ = seqno_lt;
         }
 
+        static int const MAX_KEY_DEPS = 16;
+
+        /* Key-level dependencies: seqnos of the trxs this one actually
+         * depends on in addition to everything up to key_deps_floor().
+         * If more than max dependencies are added, key deps become invalid
+         * and only depends_seqno() can be used. */
+        void init_key_deps(wsrep_seqno_t const floor, int const max)
+        {
+            assert(max > 0 && max <= MAX_KEY_DEPS);
+            key_deps_floor_ = floor;
+            key_deps_max_   = max;
+            key_deps_size_  = 0;
+        }
+
+        void add_key_dep(wsrep_seqno_t const seqno)
+        {
+            if (key_deps_size_ < 0 || seqno <= key_deps_floor_) return;
+
+            for (int i(0); i < key_deps_size_; ++i)
+            {
+                if (key_deps_[i] == seqno) return;
+            }
+
+            if (key_deps_size_ < key_deps_max_)
+            {
+                key_deps_[key_deps_size_++] = seqno;
+            }
+            else
+            {
+                key_deps_size_ = -1; // fall back to depends_seqno
+            }
+        }
+
+        /* Everything up to seqno must be finished: for dependencies which
+         * can't be enumerated. Drops key deps which the floor covers. */
+        void raise_key_deps_floor(wsrep_seqno_t const seqno)
+        {
+            if (key_deps_size_ < 0 || seqno <= key_deps_floor_) return;
+
+            key_deps_floor_ = seqno;
+
+            int n(0);
+            for (int i(0); i < key_deps_size_; ++i)
+            {
+                if (key_deps_[i] > seqno) key_deps_[n++] = key_deps_[i];
+            }
+            key_deps_size_ = n;
+        }
+
+        bool          key_deps_valid() const { return key_deps_size_ >= 0; }
+        wsrep_seqno_t key_deps_floor() const { return key_deps_floor_; }
+        int           key_deps_size()  const { return key_deps_size_; }
+        wsrep_seqno_t key_dep(int i)   const
+        {
+            assert(i >= 0 && i < key_deps_size_);
+            return key_deps_[i];
+        }
+
         State state() const { return state_(); }
         void set_state(State state) { state_.shift_to(state); }
 
@@ -625,6 +697,10 @@ namespace galera
             global_seqno_      (WSREP_SEQNO_UNDEFINED),
             last_seen_seqno_   (WSREP_SEQNO_UNDEFINED),
             depends_seqno_     (WSREP_SEQNO_UNDEFINED),
+            key_deps_floor_    (WSREP_SEQNO_UNDEFINED),
+            key_deps_          (),
+            key_deps_size_     (-1),
+            key_deps_max_      (0),
             timestamp_         (),
             write_set_         (Defaults.version_),
             write_set_in_      (),
@@ -664,6 +740,10 @@ namespace galera
             global_seqno_      (WSREP_SEQNO_UNDEFINED),
             last_seen_seqno_   (WSREP_SEQNO_UNDEFINED),
             depends_seqno_     (WSREP_SEQNO_UNDEFINED),
+            key_deps_floor_    (WSREP_SEQNO_UNDEFINED),
+            key_deps_          (),
+            key_deps_size_     (-1),
+            key_deps_max_      (0),
             timestamp_         (gu_time_calendar()),
             write_set_         (params.version_),
             write_set_in_      (),
@@ -707,9 +787,10 @@ namespace galera
                                        store_size - sizeof(WriteSetOut),
                                        0,
                                        WriteSetNG::MAX_VERSION,
-                                       DataSet::MAX_VERSION,
-                                       DataSet::MAX_VERSION,
-                                       params.max_write_set_size_);
+                                       params.data_format_,
+                                       params.data_format_,
+                                       params.max_write_set_size_,
+                                       params.key_escalation_threshold_);
             }
         }
 
@@ -726,6 +807,10 @@ namespace galera
         wsrep_seqno_t          global_seqno_;
         wsrep_seqno_t          last_seen_seqno_;
         wsrep_seqno_t          depends_seqno_;
+        wsrep_seqno_t          key_deps_floor_;
+        wsrep_seqno_t          key_deps_[MAX_KEY_DEPS];
+        int                    key_deps_size_;
+        int                    key_deps_max_;
         int64_t                timestamp_;
         WriteSet               write_set_;
         WriteSetIn             write_set_in_;
@@ -189,7 +189,7 @@ const char WriteSetOut::annt_suffix[] = "_annt";
 void
 WriteSetIn::init (ssize_t const st)
 {
-    assert(false == check_thr_);
+    assert(false == check_pending_);
 
     const gu::byte_t* const pptr (header_.payload());
     ssize_t           const psize(size_ - header_.size());
@@ -201,26 +201,23 @@ WriteSetIn::init (ssize_t const st)
     if (kver != KeySet::EMPTY) gu_trace(keys_.init (kver, pptr, psize));
 
     assert (false == check_);
-    assert (false == check_thr_);
+    assert (NULL  == check_pool_);
 
     if (gu_likely(st > 0)) /* checksum enforced */
     {
         if (size_ >= st)
         {
-            /* buffer too big, start checksumming in background */
-            int const err(pthread_create (&check_thr_id_, NULL,
-                                          checksum_thread, this));
+            /* buffer too big, checksum it in background if there is a pool
+             * or postpone it until verify_checksum() otherwise */
+            check_pool_ = CheckPool::default_pool();
 
-            if (gu_likely(0 == err))
+            if (check_pool_ && !check_pool_->submit(check_job_))
             {
-                check_thr_ = true;
-                return;
+                check_pool_ = NULL;
             }
 
-            log_warn << "Starting checksum thread failed: " << err
-                     << '(' << ::strerror(err) << ')';
-
-            /* fall through to checksum in foreground */
+            check_pending_ = true;
+            return;
         }
 
         checksum();
@@ -17,6 +17,7 @@
 #include "wsrep_api.h"
 #include "key_set.hpp"
 #include "data_set.hpp"
+#include "check_pool.hpp"
 
 #include "gu_serialize.hpp"
 #include "gu_vector.hpp"
@@ -25,8 +26,6 @@
 #include <string>
 #include <iomanip>
 
-#include <pthread.h>
-
 namespace galera
 {
     class WriteSetNG
@@ -102,7 +101,8 @@ namespace galera
             F_TOI         = 1 << 2,
             F_PA_UNSAFE   = 1 << 3,
             F_COMMUTATIVE = 1 << 4,
-            F_NATIVE      = 1 << 5
+            F_NATIVE      = 1 << 5,
+            F_ESCALATED   = 1 << 6  // not an API flag: key set was escalated
         };
 
         /* this takes care of converting wsrep API flags to on-the-wire flags */
@@ -494,7 +494,8 @@ namespace galera
                      WriteSetNG::Version     ver      = WriteSetNG::MAX_VERSION,
                      DataSet::Version        dver     = DataSet::MAX_VERSION,
                      DataSet::Version        uver     = DataSet::MAX_VERSION,
-                     size_t                  max_size = WriteSetNG::MAX_SIZE)
+                     size_t                  max_size = WriteSetNG::MAX_SIZE,
+                     size_t                  key_esc  = 0)
             :
             header_(ver),
             base_name_(dir_name, id),
@@ -502,7 +503,7 @@ namespace galera
             kbn_   (base_name_),
             keys_  (reserved,
                     (reserved_size >>= 6, reserved_size <<= 3, reserved_size),
-                    kbn_, kver),
+                    kbn_, kver, key_esc),
             /* 5/8 of reserved goes to data set  */
             dbn_   (base_name_),
             data_  (reserved + reserved_size, reserved_size*5, dbn_, dver),
@@ -512,9 +513,11 @@ namespace galera
             /* annotation set is not allocated unless requested */
             abn_   (base_name_),
             annt_  (NULL),
+            aver_  (dver),
             left_  (max_size - keys_.size() - data_.size() - unrd_.size()
                     - header_.size()),
-            flags_ (flags)
+            flags_ (flags),
+            keys_idx_(0)
         {}
 
         ~WriteSetOut() { delete annt_; }
@@ -538,13 +541,27 @@ namespace galera
         {
             if (NULL == annt_)
             {
-                annt_ = new DataSetOut(NULL, 0, abn_, DataSet::MAX_VERSION);
+                annt_ = new DataSetOut(NULL, 0, abn_, aver_);
                 left_ -= annt_->size();
             }
 
             left_ -= annt_->append(data, data_len, store);
         }
 
+        /* escalation flag is set by the key set, so it survives set_flags() */
+        uint16_t flags() const
+        {
+            return flags_ | (keys_.escalated() ? WriteSetNG::F_ESCALATED : 0);
+        }
+
+        /* highest data set format used by the writeset */
+        DataSet::Version data_version() const
+        {
+            DataSet::Version ret(std::max(data_.version(), unrd_.version()));
+            if (NULL != annt_ && annt_->version() > ret) ret = annt_->version();
+            return ret;
+        }
+
         void set_flags(uint16_t flags) { flags_  = flags; }
         void add_flags(uint16_t flags) { flags_ |= flags; }
         void mark_toi()                { flags_ |= WriteSetNG::F_TOI; }
@@ -574,9 +591,10 @@ namespace galera
                                              data_.version(),
                                              unrd_.version() != DataSet::EMPTY,
                                              NULL != annt_,
-                                             flags_, source, conn, trx,
+                                             flags(), source, conn, trx,
                                              out));
 
+            keys_idx_ = out->size();
             out_size += keys_.gather(out);
             out_size += data_.gather(out);
             out_size += unrd_.gather(out);
@@ -591,6 +609,39 @@ namespace galera
             header_.set_last_seen(ls);
         }
 
+        /* Initializes ksi with the key set gathered into out by gather().
+         * If the key set spans several buffers, it is copied into buf. */
+        void gathered_keys(const WriteSetNG::GatherVector& out,
+                           KeySetIn&                       ksi,
+                           std::vector<gu::byte_t>&        buf) const
+        {
+            if (0 == keys_.count()) return;
+
+            assert(keys_idx_ + keys_.page_count() <= out->size());
+
+            const gu::Buf& first(out[keys_idx_]);
+
+            if (1 == keys_.page_count())
+            {
+                ksi.init(keys_.version(),
+                         static_cast<const gu::byte_t*>(first.ptr),
+                         first.size);
+                return;
+            }
+
+            buf.clear();
+
+            for (ssize_t i(0); i < keys_.page_count(); ++i)
+            {
+                const gu::Buf&    page(out[keys_idx_ + i]);
+                const gu::byte_t* ptr(static_cast<const gu::byte_t*>
+                                      (page.ptr));
+                buf.insert(buf.end(), ptr, ptr + page.size);
+            }
+
+            ksi.init(keys_.version(), &buf[0], buf.size());
+        }
+
         void set_preordered (ssize_t pa_range)
         {
             assert (pa_range >= 0);
@@ -653,8 +704,10 @@ namespace galera
         DataSetOut          unrd_;
         BaseNameImpl<annt_suffix> abn_;
         DataSetOut*         annt_;
+        DataSet::Version const aver_; // annotation is read with data version
         ssize_t             left_;
         uint16_t            flags_;
+        size_t              keys_idx_; // key set position in gather vector
 
         void check_size()
         {
@@ -679,8 +732,9 @@ namespace galera
               data_  (),
               unrd_  (),
               annt_  (NULL),
-              check_thr_id_(),
-              check_thr_(false),
+              check_job_(checksum_job, this),
+              check_pool_(NULL),
+              check_pending_(false),
               check_ (false)
         {
             init (st);
@@ -693,8 +747,9 @@ namespace galera
               data_  (),
               unrd_  (),
               annt_  (NULL),
-              check_thr_id_(),
-              check_thr_(false),
+              check_job_(checksum_job, this),
+              check_pool_(NULL),
+              check_pending_(false),
               check_ (false)
         {}
 
@@ -719,10 +774,10 @@ namespace galera
 
         ~WriteSetIn ()
         {
-            if (gu_unlikely(check_thr_))
+            if (gu_unlikely(check_pending_ && check_pool_))
             {
-                /* checksum was performed in a parallel thread */
-                pthread_join (check_thr_id_, NULL);
+                /* checksum job must not outlive the writeset */
+                check_pool_->wait (check_job_);
             }
 
             delete annt_;
@@ -755,11 +810,20 @@ namespace galera
          * and before it is finalized. */
         void verify_checksum() const /* throws */
         {
-            if (gu_unlikely(check_thr_))
+            if (gu_unlikely(check_pending_))
             {
-                /* checksum was performed in a parallel thread */
-                pthread_join (check_thr_id_, NULL);
-                check_thr_ = false;
+                if (check_pool_)
+                {
+                    /* checksum was performed in a pool thread */
+                    check_pool_->wait (check_job_);
+                }
+                else
+                {
+                    /* checksum was postponed until now */
+                    const_cast<WriteSetIn*>(this)->checksum();
+                }
+
+                check_pending_ = false;
                 checksum_fin();
             }
         }
@@ -798,8 +862,9 @@ namespace galera
         DataSetIn          data_;
         DataSetIn          unrd_;
         DataSetIn*         annt_;
-        pthread_t          check_thr_id_;
-        bool mutable       check_thr_;
+        CheckPool::Job mutable check_job_;
+        CheckPool*         check_pool_;    // pool running check_job_
+        bool mutable       check_pending_; // payload checksum not verified
         bool               check_;
 
         static size_t const SIZE_THRESHOLD = 1 << 22; /* 4Mb */
@@ -814,11 +879,10 @@ namespace galera
             }
         }
 
-        static void* checksum_thread (void* arg)
+        static void checksum_job (void* arg)
         {
             WriteSetIn* ws(reinterpret_cast<WriteSetIn*>(arg));
             ws->checksum();
-            return NULL;
         }
 
         /* late initialization after default constructor */
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2014 Codership Oy <info@codership.com>
+ */
+
+#include "../src/applier_tuner.hpp"
+
+#include <check.h>
+#include <pthread.h>
+#include <unistd.h>
+
+using namespace galera;
+
+namespace
+{
+    /* feeds tuner with one update period of the given distance */
+    bool sample_period(ApplierTuner& tuner, wsrep_seqno_t distance)
+    {
+        bool update(false);
+
+        for (long long i(0); i < ApplierTuner::PERIOD; ++i)
+        {
+            fail_if(update, "update requested before the period ended");
+            update = tuner.sample(distance);
+        }
+
+        return update;
+    }
+
+    struct Applier
+    {
+        explicit Applier(ApplierGate& gate) : gate_(gate), entered_(0) { }
+
+        ApplierGate&    gate_;
+        gu::Atomic<int> entered_;
+
+        bool entered() const { return entered_() != 0; }
+
+    private:
+
+        Applier(const Applier&);
+        void operator=(const Applier&);
+    };
+
+    void* applier_thread(void* arg)
+    {
+        Applier& a(*static_cast<Applier*>(arg));
+
+        a.gate_.enter();
+        a.entered_ = 1;
+        a.gate_.leave();
+
+        return 0;
+    }
+
+    /* waits for a while for the thread to be parked */
+    bool parked(const ApplierGate& gate, long n)
+    {
+        for (int i(0); i < 100 && gate.parked() != n; ++i) usleep(10000);
+        return gate.parked() == n;
+    }
+}
+
+START_TEST(test_applier_tuner)
+{
+    ApplierTuner tuner;
+    long const   threads(8);
+
+    fail_if(tuner.recommended() != 0);
+
+    /* no samples: at least one thread */
+    fail_if(tuner.update(threads, 0) != 1);
+
+    /* distance tells how many writesets can be applied in parallel */
+    fail_unless(sample_period(tuner, 3));
+    fail_if(tuner.update(threads, 0) != 3);
+
+    /* grows at once, rounding up */
+    for (long long i(0); i < ApplierTuner::PERIOD; ++i)
+    {
+        tuner.sample(i % 2 ? 5 : 6);
+    }
+    fail_if(tuner.update(threads, 0) != 6);
+
+    /* never more than there are threads */
+    fail_unless(sample_period(tuner, 100));
+    fail_if(tuner.update(threads, 0) != threads);
+
+    /* shrinks one thread per update */
+    fail_unless(sample_period(tuner, 1));
+    fail_if(tuner.update(threads, 0) != threads - 1);
+    fail_unless(sample_period(tuner, 1));
+    fail_if(tuner.update(threads, 0) != threads - 2);
+
+    /* no new samples, no change */
+    fail_if(tuner.update(threads, 0) != threads - 2);
+
+    /* catching up: receive queue longer than the number of threads */
+    fail_unless(sample_period(tuner, 1));
+    fail_if(tuner.update(threads, threads + 1) != threads);
+    fail_if(tuner.recommended() != threads);
+
+    /* fewer threads than recommended */
+    fail_if(tuner.update(2, 0) != 2);
+}
+END_TEST
+
+START_TEST(test_applier_gate)
+{
+    ApplierGate gate;
+
+    /* no limit */
+    gate.enter();
+    gate.enter();
+    fail_if(gate.active() != 2);
+    gate.leave();
+    gate.leave();
+
+    gate.set_active_max(1);
+    gate.enter();
+
+    Applier   a1(gate), a2(gate);
+    pthread_t t1, t2;
+
+    /* second thread is parked until the first one leaves */
+    fail_if(pthread_create(&t1, 0, applier_thread, &a1));
+    fail_unless(parked(gate, 1));
+    fail_if(a1.entered());
+
+    gate.leave();
+    pthread_join(t1, 0);
+    fail_unless(a1.entered());
+    fail_if(gate.parked() != 0);
+    fail_if(gate.active() != 0);
+
+    /* disabling the limit releases parked threads */
+    gate.enter();
+    fail_if(pthread_create(&t2, 0, applier_thread, &a2));
+    fail_unless(parked(gate, 1));
+
+    gate.set_active_max(0);
+    pthread_join(t2, 0);
+    fail_unless(a2.entered());
+    gate.leave();
+    fail_if(gate.active() != 0);
+}
+END_TEST
+
+Suite* applier_tuner_suite()
+{
+    Suite* s = suite_create("applier_tuner");
+    TCase* tc;
+
+    tc = tcase_create("test_applier_tuner");
+    tcase_add_test(tc, test_applier_tuner);
+    tcase_add_test(tc, test_applier_gate);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
@@ -0,0 +1,294 @@
+/*
+ * Copyright (C) 2014 Codership Oy <info@codership.com>
+ */
+
+#include "../src/apply_scheduler.hpp"
+
+#include <check.h>
+#include <set>
+
+using namespace galera;
+
+namespace
+{
+    /* trxs which can enter apply monitor */
+    class Ready
+    {
+    public:
+
+        Ready() : seqnos_() { }
+
+        void set(wsrep_seqno_t seqno) { seqnos_.insert(seqno); }
+
+        bool operator()(TrxHandle& trx) const
+        {
+            return seqnos_.find(trx.global_seqno()) != seqnos_.end();
+        }
+
+        wsrep_seqno_t wait_seqno(TrxHandle& trx) const
+        {
+            return trx.depends_seqno();
+        }
+
+    private:
+
+        std::set<wsrep_seqno_t> seqnos_;
+    };
+
+    class Trxs
+    {
+    public:
+
+        Trxs() : pool_(TrxHandle::LOCAL_STORAGE_SIZE, 16, "apply_sched"),
+                 trxs_() { }
+
+        ~Trxs()
+        {
+            for (size_t i(0); i < trxs_.size(); ++i) trxs_[i]->unref();
+        }
+
+        TrxHandle* create(wsrep_seqno_t seqno, wsrep_seqno_t depends)
+        {
+            wsrep_uuid_t const uuid = {{1, }};
+            TrxHandle* const trx(TrxHandle::New(pool_, TrxHandle::Defaults,
+                                                uuid, -1, seqno));
+            trx->set_received(0, seqno, seqno);
+            trx->set_depends_seqno(depends);
+            trxs_.push_back(trx);
+            return trx;
+        }
+
+    private:
+
+        TrxHandle::LocalPool    pool_;
+        std::vector<TrxHandle*> trxs_;
+    };
+
+    /* range of seqnos queued by the caller */
+    struct Own
+    {
+        Own(wsrep_seqno_t seqno) : first(seqno), last(seqno) { }
+        Own(wsrep_seqno_t f, wsrep_seqno_t l) : first(f), last(l) { }
+
+        wsrep_seqno_t first;
+        wsrep_seqno_t last;
+    };
+
+    void check_apply(ApplyScheduler& sched, const Ready& ready,
+                     const Own& own, bool& watcher, wsrep_seqno_t seqno)
+    {
+        TrxHandle*    trx(0);
+        wsrep_seqno_t wait(-1);
+
+        ApplyScheduler::Action const a(
+            sched.next(ready, own.first, own.last, watcher, trx, wait));
+
+        fail_if(a != ApplyScheduler::A_APPLY, "expected A_APPLY, got %d", a);
+        fail_if(trx->global_seqno() != seqno, "expected %lld, got %lld",
+                (long long)seqno, (long long)trx->global_seqno());
+    }
+
+    void check_wait(ApplyScheduler& sched, const Ready& ready,
+                    const Own& own, bool& watcher, wsrep_seqno_t seqno)
+    {
+        TrxHandle*    trx(0);
+        wsrep_seqno_t wait(-1);
+
+        ApplyScheduler::Action const a(
+            sched.next(ready, own.first, own.last, watcher, trx, wait));
+
+        fail_if(a != ApplyScheduler::A_WAIT, "expected A_WAIT, got %d", a);
+        fail_if(wait != seqno, "expected wait for %lld, got %lld",
+                (long long)seqno, (long long)wait);
+    }
+
+    void check_return(ApplyScheduler& sched, const Ready& ready,
+                      const Own& own, bool& watcher)
+    {
+        TrxHandle*    trx(0);
+        wsrep_seqno_t wait(-1);
+
+        ApplyScheduler::Action const a(
+            sched.next(ready, own.first, own.last, watcher, trx, wait));
+
+        fail_if(a != ApplyScheduler::A_RETURN, "expected A_RETURN, got %d",a);
+    }
+}
+
+/* ready writesets are applied lowest seqno first */
+START_TEST(test_apply_sched_order)
+{
+    Trxs           trxs;
+    ApplyScheduler sched(16);
+    Ready          ready;
+    bool           watcher(false);
+
+    sched.push(trxs.create(3, 0));
+    sched.push(trxs.create(1, 0));
+    sched.push(trxs.create(2, 0));
+
+    ready.set(1); ready.set(2); ready.set(3);
+
+    check_apply(sched, ready, 1, watcher, 1);
+    check_apply(sched, ready, 1, watcher, 2);
+    check_apply(sched, ready, 1, watcher, 3);
+    check_return(sched, ready, 1, watcher);
+
+    fail_if(watcher);
+    fail_if(sched.queued() != 3);
+    fail_if(sched.stolen() != 2);
+}
+END_TEST
+
+/* watcher does not take a writeset which may block on a lower queued one
+ * and keeps draining the queue when lower writesets become ready */
+START_TEST(test_apply_sched_watcher)
+{
+    Trxs           trxs;
+    ApplyScheduler sched(16);
+    Ready          ready;
+    bool           w1(false), w2(false);
+
+    sched.push(trxs.create(1, 0));
+    sched.push(trxs.create(2, 0));
+    ready.set(2);
+
+    /* 2 would wait for 1 to commit, caller must stay and watch 1 */
+    check_wait(sched, ready, 2, w1, 0);
+    fail_unless(w1);
+
+    /* other thread may take 2 while the watcher is there */
+    sched.push(trxs.create(3, 1));
+    check_apply(sched, ready, 3, w2, 2);
+    fail_if(w2);
+    fail_if(sched.stolen() != 1);
+
+    /* 1 becomes ready, e.g. after local trx left apply monitor,
+     * watcher takes it and gives up watching */
+    ready.set(1);
+    check_apply(sched, ready, 2, w1, 1);
+    fail_if(w1);
+
+    /* back from applying, watcher takes over again */
+    check_wait(sched, ready, 2, w1, 1);
+    fail_unless(w1);
+
+    /* nothing ready, other threads return to receiving */
+    check_return(sched, ready, 4, w2);
+
+    ready.set(3);
+    check_apply(sched, ready, 2, w1, 3);
+    check_return(sched, ready, 2, w1);
+    fail_if(w1);
+    fail_if(sched.size() != 0);
+}
+END_TEST
+
+/* without a watcher the lowest ready writeset is taken */
+START_TEST(test_apply_sched_no_watcher)
+{
+    Trxs           trxs;
+    ApplyScheduler sched(16);
+    Ready          ready;
+    bool           w1(false), w2(false);
+
+    sched.push(trxs.create(1, 0));
+    sched.push(trxs.create(2, 0));
+    ready.set(1); ready.set(2);
+
+    check_apply(sched, ready, 2, w1, 1);
+    fail_if(w1);
+    check_apply(sched, ready, 2, w2, 2);
+    check_return(sched, ready, 2, w2);
+}
+END_TEST
+
+/* writeset is applied by its owner in blocking way if the watcher may be
+ * waiting for it or if the queue is full */
+START_TEST(test_apply_sched_blocking)
+{
+    Trxs           trxs;
+    ApplyScheduler sched(2);
+    Ready          ready;
+    bool           w1(false), w2(false);
+
+    sched.push(trxs.create(5, 3));
+    check_wait(sched, ready, 5, w1, 3);
+
+    /* watcher waits for 3 */
+    sched.push(trxs.create(3, 2));
+    check_apply(sched, ready, 3, w2, 3);
+    fail_if(w2);
+
+    sched.push(trxs.create(6, 5));
+    check_return(sched, ready, 6, w2);
+
+    /* queue is full */
+    sched.push(trxs.create(7, 5));
+    check_apply(sched, ready, 7, w2, 7);
+    fail_if(sched.size() != 2);
+}
+END_TEST
+
+/* writesets certified together are queued at once, the watcher never
+ * waits for one which is held back by its owner */
+START_TEST(test_apply_sched_batch)
+{
+    Trxs           trxs;
+    ApplyScheduler sched(16);
+    Ready          ready;
+    bool           w1(false), w2(false);
+    TrxHandle*     batch[3];
+
+    batch[0] = trxs.create(5, 4);
+    batch[1] = trxs.create(6, 5);
+    batch[2] = trxs.create(7, 4);
+    sched.push(batch, 3);
+
+    Own const own(5, 7);
+
+    check_wait(sched, ready, own, w1, 4);
+    fail_unless(w1);
+
+    /* 8 depends on 6 of the batch, other thread returns to receiving */
+    sched.push(trxs.create(8, 6));
+    check_return(sched, ready, 8, w2);
+
+    ready.set(5);
+    check_apply(sched, ready, own, w1, 5);
+    fail_if(w1);
+
+    /* 6 is queued, so waiting for 5 to leave is what it takes */
+    check_wait(sched, ready, own, w1, 5);
+    fail_unless(w1);
+
+    ready.set(6); ready.set(7);
+    check_apply(sched, ready, own, w1, 6);
+    check_apply(sched, ready, own, w1, 7);
+
+    ready.set(8);
+    check_apply(sched, ready, own, w1, 8);
+    check_return(sched, ready, own, w1);
+
+    fail_if(w1);
+    fail_if(sched.size() != 0);
+    fail_if(sched.queued() != 4);
+    fail_if(sched.stolen() != 1);
+}
+END_TEST
+
+Suite* apply_scheduler_suite()
+{
+    Suite* s = suite_create("apply_scheduler");
+    TCase* tc;
+
+    tc = tcase_create("test_apply_sched");
+    tcase_add_test(tc, test_apply_sched_order);
+    tcase_add_test(tc, test_apply_sched_watcher);
+    tcase_add_test(tc, test_apply_sched_no_watcher);
+    tcase_add_test(tc, test_apply_sched_blocking);
+    tcase_add_test(tc, test_apply_sched_batch);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
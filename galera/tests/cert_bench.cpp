@@ -0,0 +1,481 @@
+/*
+ * Copyright (C) 2014 Codership Oy <info@codership.com>
+ */
+
+/*!
+ * @file Certification benchmark: certifies a stream of synthetic write sets
+ *       the way a node does it for replicated actions and reports throughput,
+ *       append_trx() latency percentiles, index size and memory usage.
+ *
+ * Write sets are prepared before the measurement starts, so serialization
+ * and unserialization costs are not included. Each write set has keys of
+ * the form db:table:row drawn from one of the distributions:
+ *
+ *   uniform  - rows and tables are uniformly distributed,
+ *   zipf     - rows follow Zipf distribution (-z sets the exponent),
+ *   disjoint - each source node modifies its own range of rows,
+ *   huge     - uniform, but every -H'th transaction has -K keys.
+ *
+ * Transactions are committed in order with the lag of -w transactions,
+ * index is purged whenever set_trx_committed() asks for it.
+ *
+ * To run:
+ * cert_bench [-d dist] [-n trxs] [-k keys] [-r rows] [-t tables] [-s sources]
+ *            [-l last seen lag] [-w commit window] [-z zipf exponent]
+ *            [-H huge trx period] [-K huge trx keys] [-S seed]
+ *            [-o "cert.param1=value1;cert.param2=value2"] [-D gcache dir]
+ *
+ * GCache files are created in a temporary directory unless -D is given.
+ *
+ * e.g. cert_bench -d zipf -n 1000000 -o "cert.index_type=flat"
+ */
+
+#include "certification.hpp"
+#include "galera_service_thd.hpp"
+#include "galera_gcs.hpp"
+#include "trx_handle.hpp"
+#include "key_data.hpp"
+
+#include "gu_time.h"
+
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include <unistd.h>
+
+using namespace galera;
+
+namespace
+{
+    enum Dist
+    {
+        D_UNIFORM,
+        D_ZIPF,
+        D_DISJOINT,
+        D_HUGE
+    };
+
+    struct Options
+    {
+        Dist        dist;
+        long        trxs;
+        long        keys;
+        long        rows;
+        long        tables;
+        long        sources;
+        long        lag;
+        long        window;
+        double      zipf;
+        long        huge_period;
+        long        huge_keys;
+        unsigned    seed;
+        std::string cert_opts;
+        std::string dir;
+
+        Options()
+            :
+            dist        (D_UNIFORM),
+            trxs        (100000),
+            keys        (4),
+            rows        (1000000),
+            tables      (16),
+            sources     (4),
+            lag         (16),
+            window      (64),
+            zipf        (0.99),
+            huge_period (1000),
+            huge_keys   (10000),
+            seed        (1),
+            cert_opts   (),
+            dir         ()
+        {}
+    };
+
+    /* xorshift64*, good enough and reproducible across platforms */
+    class Rand
+    {
+    public:
+
+        explicit Rand(unsigned seed) : x_(seed * 0x9E3779B97F4A7C15ULL + 1) {}
+
+        uint64_t operator()()
+        {
+            x_ ^= x_ >> 12;
+            x_ ^= x_ << 25;
+            x_ ^= x_ >> 27;
+            return x_ * 2685821657736338717ULL;
+        }
+
+        /* uniform in [0, 1) */
+        double real() { return ((*this)() >> 11) * (1.0 / 9007199254740992.0); }
+
+    private:
+
+        uint64_t x_;
+    };
+
+    /* row ranks are drawn by binary search in the precomputed CDF */
+    class Zipf
+    {
+    public:
+
+        Zipf(long n, double s) : cdf_(n)
+        {
+            double sum(0);
+
+            for (long i(0); i < n; ++i)
+            {
+                sum += 1.0 / ::pow(double(i + 1), s);
+                cdf_[i] = sum;
+            }
+
+            for (long i(0); i < n; ++i) cdf_[i] /= sum;
+        }
+
+        long operator()(Rand& rnd) const
+        {
+            return std::lower_bound(cdf_.begin(), cdf_.end(), rnd.real())
+                - cdf_.begin();
+        }
+
+    private:
+
+        std::vector<double> cdf_;
+    };
+
+    struct Trx
+    {
+        TrxHandle*              trx;
+        std::vector<gu::byte_t> buf; // trx points into it
+
+        Trx() : trx(NULL), buf() {}
+    };
+
+    class KeyGen
+    {
+    public:
+
+        KeyGen(const Options& opts)
+            :
+            opts_(opts),
+            rnd_ (opts.seed),
+            zipf_(opts.dist == D_ZIPF ? opts.rows : 0, opts.zipf)
+        {}
+
+        void operator()(long const source, uint64_t& table, uint64_t& row)
+        {
+            switch (opts_.dist)
+            {
+            case D_ZIPF:
+                row = zipf_(rnd_);
+                /* hot rows should not be clustered in one table */
+                table = (row * 0x9E3779B97F4A7C15ULL) % opts_.tables;
+                return;
+            case D_DISJOINT:
+            {
+                uint64_t const range(opts_.rows / opts_.sources);
+                row = source * range + rnd_() % range;
+                table = row % opts_.tables;
+                return;
+            }
+            case D_UNIFORM:
+            case D_HUGE:
+                row = rnd_() % opts_.rows;
+                table = rnd_() % opts_.tables;
+                return;
+            }
+        }
+
+        Rand& rnd() { return rnd_; }
+
+    private:
+
+        const Options& opts_;
+        Rand           rnd_;
+        Zipf           zipf_;
+    };
+
+    TrxHandle::LocalPool local_pool(TrxHandle::LOCAL_STORAGE_SIZE, 4,
+                                    "cert_bench_local");
+    TrxHandle::SlavePool slave_pool(sizeof(TrxHandle), 1024,
+                                    "cert_bench_slave");
+
+    /* builds write set locally and unserializes it as a slave trx would be */
+    void
+    make_trx(Trx& t, const Options& opts, KeyGen& gen,
+             wsrep_seqno_t const seqno)
+    {
+        static const char db[] = "db";
+
+        long const source(seqno % opts.sources);
+        long const node(source + 1); // all-zero UUID is undefined
+        wsrep_uuid_t uuid;
+        memset(&uuid, 0, sizeof(uuid));
+        memcpy(&uuid, &node, sizeof(node));
+
+        TrxHandle::Params const params(".", 3, KeySet::MAX_VERSION);
+        TrxHandle* const local(TrxHandle::New(local_pool, params, uuid,
+                                              source, seqno));
+
+        long const keys(opts.dist == D_HUGE && seqno % opts.huge_period == 0 ?
+                        opts.huge_keys : opts.keys);
+
+        for (long k(0); k < keys; ++k)
+        {
+            uint64_t table, row;
+            gen(source, table, row);
+
+            wsrep_buf_t const parts[3] =
+            {
+                { db,     sizeof(db)    },
+                { &table, sizeof(table) },
+                { &row,   sizeof(row)   }
+            };
+
+            local->append_key(KeyData(3, parts, 3, WSREP_KEY_EXCLUSIVE, true));
+        }
+
+        local->set_flags(TrxHandle::F_COMMIT);
+
+        WriteSetNG::GatherVector out;
+        local->write_set_out().gather(uuid, source, seqno, out);
+
+        wsrep_seqno_t const last_seen
+            (std::max<wsrep_seqno_t>(0, seqno - 1 -
+                                     gen.rnd()() % (opts.lag + 1)));
+        local->set_last_seen_seqno(last_seen);
+
+        for (size_t i(0); i < out->size(); ++i)
+        {
+            const gu::byte_t* const ptr
+                (static_cast<const gu::byte_t*>(out[i].ptr));
+            t.buf.insert(t.buf.end(), ptr, ptr + out[i].size);
+        }
+
+        local->unref();
+
+        t.trx = TrxHandle::New(slave_pool);
+        t.trx->unserialize(&t.buf[0], t.buf.size(), 0);
+        t.trx->set_received(&t.buf[0], seqno, seqno);
+    }
+
+    long
+    rss_kb()
+    {
+        std::ifstream statm("/proc/self/statm");
+        long size(0), resident(0);
+        statm >> size >> resident;
+        return resident * (sysconf(_SC_PAGESIZE) / 1024);
+    }
+
+    void
+    usage(const char* const prog)
+    {
+        std::cerr << "Usage: " << prog
+                  << " [-d uniform|zipf|disjoint|huge] [-n trxs] [-k keys]"
+                  << " [-r rows] [-t tables] [-s sources] [-l lag]"
+                  << " [-w window] [-z exponent] [-H huge period]"
+                  << " [-K huge keys] [-S seed] [-o cert options]"
+                  << " [-D gcache dir]" << std::endl;
+        ::exit(EXIT_FAILURE);
+    }
+
+    void
+    parse_options(int argc, char* argv[], Options& opts)
+    {
+        int c;
+
+        while ((c = getopt(argc, argv, "d:n:k:r:t:s:l:w:z:H:K:S:o:D:")) != -1)
+        {
+            switch (c)
+            {
+            case 'd':
+                if      (!strcmp(optarg, "uniform"))  opts.dist = D_UNIFORM;
+                else if (!strcmp(optarg, "zipf"))     opts.dist = D_ZIPF;
+                else if (!strcmp(optarg, "disjoint")) opts.dist = D_DISJOINT;
+                else if (!strcmp(optarg, "huge"))     opts.dist = D_HUGE;
+                else usage(argv[0]);
+                break;
+            case 'n': opts.trxs        = atol(optarg); break;
+            case 'k': opts.keys        = atol(optarg); break;
+            case 'r': opts.rows        = atol(optarg); break;
+            case 't': opts.tables      = atol(optarg); break;
+            case 's': opts.sources     = atol(optarg); break;
+            case 'l': opts.lag         = atol(optarg); break;
+            case 'w': opts.window      = atol(optarg); break;
+            case 'z': opts.zipf        = atof(optarg); break;
+            case 'H': opts.huge_period = atol(optarg); break;
+            case 'K': opts.huge_keys   = atol(optarg); break;
+            case 'S': opts.seed        = atoi(optarg); break;
+            case 'o': opts.cert_opts   = optarg;       break;
+            case 'D': opts.dir         = optarg;       break;
+            default:  usage(argv[0]);
+            }
+        }
+
+        if (opts.trxs <= 0 || opts.keys <= 0 || opts.rows < opts.sources ||
+            opts.tables <= 0 || opts.sources <= 0 || opts.lag < 0 ||
+            opts.window <= 0 || opts.huge_period <= 0 || opts.huge_keys <= 0)
+        {
+            usage(argv[0]);
+        }
+    }
+
+    long long
+    percentile(const std::vector<long long>& sorted, double const p)
+    {
+        return sorted[std::min(sorted.size() - 1,
+                               size_t(p * sorted.size() / 100))];
+    }
+}
+
+static void
+run(const Options& opts, const std::string& dir)
+{
+    gu::Config conf;
+    Certification::register_params(conf);
+    gcache::GCache::register_params(conf);
+    if (!opts.cert_opts.empty()) conf.parse(opts.cert_opts);
+
+    std::vector<Trx> trxs(opts.trxs); // write sets must outlive cert
+
+    gcache::GCache gcache(conf, dir);
+    DummyGcs       gcs(conf, gcache);
+    ServiceThd     thd(gcs, gcache);
+    Certification  cert(conf, thd);
+
+    cert.assign_initial_position(0, 3);
+
+    std::cout << "Preparing " << opts.trxs << " write sets..." << std::endl;
+
+    KeyGen gen(opts);
+    for (long i(0); i < opts.trxs; ++i) make_trx(trxs[i], opts, gen, i + 1);
+
+    long const rss_before(rss_kb());
+
+    std::vector<long long> lat(opts.trxs);
+    long long commit_time(0);
+    long long purge_time(0);
+    long      purges(0);
+    long      failed(0);
+    size_t    max_index(0);
+    long      committed(0);
+
+    long long const begin(gu_time_monotonic());
+
+    for (long i(0); i < opts.trxs; ++i)
+    {
+        long long const start(gu_time_monotonic());
+        Certification::TestResult const res(cert.append_trx(trxs[i].trx));
+        lat[i] = gu_time_monotonic() - start;
+
+        failed += (res != Certification::TEST_OK);
+
+        if (i % 1024 == 0)
+        {
+            double cert_interval, deps_dist;
+            size_t index_size, deps_window;
+            cert.stats_get(cert_interval, deps_dist, index_size, deps_window);
+            max_index = std::max(max_index, index_size);
+        }
+
+        /* commit with the lag of window trxs, like appliers would */
+        for (; committed <= i - opts.window || (i + 1 == opts.trxs &&
+                                                committed < opts.trxs);
+             ++committed)
+        {
+            long long const cstart(gu_time_monotonic());
+            wsrep_seqno_t const purge_seqno
+                (cert.set_trx_committed(trxs[committed].trx));
+            long long const cend(gu_time_monotonic());
+            commit_time += cend - cstart;
+
+            if (purge_seqno >= 0)
+            {
+                cert.purge_trxs_upto(purge_seqno, true);
+                purge_time += gu_time_monotonic() - cend;
+                ++purges;
+            }
+        }
+    }
+
+    long long const total(gu_time_monotonic() - begin);
+    long const rss_after(rss_kb());
+
+    double cert_interval, deps_dist;
+    size_t index_size, deps_window;
+    cert.stats_get(cert_interval, deps_dist, index_size, deps_window);
+
+    std::sort(lat.begin(), lat.end());
+
+    static const char* const dist_str[] =
+        { "uniform", "zipf", "disjoint", "huge" };
+
+    std::cout << std::fixed << std::setprecision(2)
+              << "distribution:    " << dist_str[opts.dist] << '\n'
+              << "transactions:    " << opts.trxs << ", failed: " << failed
+              << " (" << 100.0 * failed / opts.trxs << "%)\n"
+              << "throughput:      " << opts.trxs * 1.0e9 / total
+              << " trx/s\n"
+              << "append_trx (ns): p50 " << percentile(lat, 50)
+              << ", p90 " << percentile(lat, 90)
+              << ", p99 " << percentile(lat, 99)
+              << ", p99.9 " << percentile(lat, 99.9)
+              << ", max " << lat.back() << '\n'
+              << "commit (ns/trx): " << double(commit_time) / opts.trxs << '\n'
+              << "purge:           " << purges << " times, "
+              << (purges ? double(purge_time) / purges / 1000 : 0)
+              << " us avg\n"
+              << "avg cert interval: " << cert_interval
+              << ", avg deps dist: " << deps_dist << '\n'
+              << "index size:      " << index_size << " (max "
+              << max_index << ")\n"
+              << "deps window:     " << deps_window << '\n'
+              << "RSS (KiB):       " << rss_before << " -> " << rss_after
+              << std::endl;
+
+    for (long i(0); i < opts.trxs; ++i) trxs[i].trx->unref();
+}
+
+int
+main(int argc, char* argv[])
+{
+    Options opts;
+    parse_options(argc, argv, opts);
+
+    std::string dir(opts.dir);
+
+    if (dir.empty())
+    {
+        const char* const tmp(getenv("TMPDIR"));
+        std::string templ(std::string(tmp ? tmp : "/tmp") +
+                          "/cert_bench.XXXXXX");
+
+        if (NULL == mkdtemp(&templ[0]))
+        {
+            std::cerr << "Failed to create temporary directory " << templ
+                      << ": " << strerror(errno) << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        dir = templ;
+    }
+
+    run(opts, dir);
+
+    if (opts.dir.empty())
+    {
+        ::unlink((dir + "/galera.cache").c_str());
+        ::rmdir(dir.c_str());
+    }
+
+    return 0;
+}
@@ -0,0 +1,104 @@
+/* Copyright (C) 2014 Codership Oy <info@codership.com>
+ *
+ * $Id$
+ */
+
+#undef NDEBUG
+
+#include "../src/cert_index_flat.hpp"
+
+#include "gu_byteswap.hpp"
+
+#include <check.h>
+
+#include <vector>
+
+using namespace galera;
+
+/* makes serialized FLAT16 exclusive key part from two hash words */
+static void
+make_key (std::vector<uint64_t>& buf, uint64_t const head, uint64_t const tail)
+{
+    uint64_t const hdr((KeySet::FLAT16 << 2) | KeySet::Key::P_EXCLUSIVE);
+
+    buf.push_back(gu::htog<uint64_t>((head << 5) | hdr));
+    buf.push_back(tail);
+}
+
+static KeySet::KeyPart
+key_part (const std::vector<uint64_t>& buf, size_t const i)
+{
+    return KeySet::KeyPart(reinterpret_cast<const gu::byte_t*>(&buf[i * 2]),
+                           2 * sizeof(uint64_t));
+}
+
+START_TEST (ver0)
+{
+    size_t const n(10000);
+    std::vector<uint64_t> keys;
+    keys.reserve(2 * (n + 1));
+
+    for (size_t i(0); i < n; ++i)
+    {
+        /* lower bits the same for all keys, like within an index shard */
+        make_key(keys, (i + 1) << 4, i);
+    }
+
+    /* collision on head, differs only in tail */
+    make_key(keys, 1 << 4, 1);
+
+    CertIndexFlat index;
+    std::vector<KeyEntryNG*> entries;
+
+    fail_if(index.find(key_part(keys, 0)) != NULL);
+
+    for (size_t i(0); i <= n; ++i)
+    {
+        KeySet::KeyPart const kp(key_part(keys, i));
+        KeyEntryNG* const kep(index.insert(kp));
+        fail_if(NULL == kep);
+        fail_if(!kep->key().matches(kp));
+        entries.push_back(kep);
+    }
+
+    fail_if(index.size() != n + 1);
+    fail_if(index.capacity() * 7 < index.size() * 8);
+
+    for (size_t i(0); i <= n; ++i)
+    {
+        fail_if(index.find(key_part(keys, i)) != entries[i]);
+    }
+
+    /* erase every other key */
+    for (size_t i(0); i <= n; i += 2)
+    {
+        index.erase(entries[i]);
+    }
+
+    fail_if(index.size() != n / 2);
+
+    for (size_t i(0); i <= n; ++i)
+    {
+        KeyEntryNG* const kep(index.find(key_part(keys, i)));
+
+        if (i % 2) fail_if(kep != entries[i]);
+        else       fail_if(kep != NULL);
+    }
+
+    index.clear();
+
+    fail_if(index.size() != 0);
+    fail_if(index.find(key_part(keys, 1)) != NULL);
+}
+END_TEST
+
+Suite* cert_index_flat_suite ()
+{
+    TCase* t = tcase_create ("CertIndexFlat");
+    tcase_add_test (t, ver0);
+
+    Suite* s = suite_create ("CertIndexFlat");
+    suite_add_tcase (s, t);
+
+    return s;
+}
@@ -231,10 +231,71 @@ START_TEST (ver0)
 }
 END_TEST
 
+START_TEST (ver2)
+{
+    std::string const small("small record");
+    std::string       big;
+
+    for (int i(0); big.size() < (1 << 20); ++i)
+    {
+        std::ostringstream os;
+        os << "INSERT INTO t1 VALUES (" << i << ", 'row " << i % 17 << "');";
+        big += os.str();
+    }
+
+    gu::byte_t reserved[1024];
+    TestBaseName str("data_set_test");
+    DataSetOut dset_out(reserved, sizeof(reserved), str, DataSet::VER2);
+
+    size_t raw_size(0);
+    raw_size += dset_out.append (small.data(), small.size(), false);
+    raw_size += dset_out.append (big.data(), big.size(), false);
+    raw_size += dset_out.append (small.data(), small.size(), true);
+
+    fail_if (raw_size != 2 * small.size() + big.size());
+    fail_if (1 != dset_out.count());
+    fail_if (DataSet::VER2 != dset_out.version());
+
+    DataSetOut::GatherVector out_bufs;
+    size_t const out_size (dset_out.gather (out_bufs));
+
+    fail_if (out_size >= big.size() / 2, "Packed size: %zu", out_size);
+
+    std::vector<gu::byte_t> in_buf;
+    in_buf.reserve(out_size);
+    for (size_t i = 0; i < out_bufs->size(); ++i)
+    {
+        const gu::byte_t* ptr
+            (reinterpret_cast<const gu::byte_t*>(out_bufs[i].ptr));
+        in_buf.insert (in_buf.end(), ptr, ptr + out_bufs[i].size);
+    }
+
+    fail_if (in_buf.size() != out_size);
+
+    std::string const expected(small + big + small);
+
+    galera::DataSetIn dset_in(dset_out.version(), in_buf.data(),
+                              in_buf.size());
+    dset_in.checksum();
+    fail_if (dset_in.count() != 1);
+
+    for (int i(0); i < 2; ++i) // second pass returns cached data
+    {
+        dset_in.rewind();
+        gu::Buf const data(dset_in.next());
+        fail_if (size_t(data.size) != expected.size(),
+                 "Expected %zu bytes, got %zd", expected.size(), data.size);
+        fail_if (memcmp(data.ptr, expected.data(), data.size));
+    }
+
+}
+END_TEST
+
 Suite* data_set_suite ()
 {
     TCase* t = tcase_create ("DataSet");
     tcase_add_test (t, ver0);
+    tcase_add_test (t, ver2);
     tcase_set_timeout(t, 60);
 
     Suite* s = suite_create ("DataSet");
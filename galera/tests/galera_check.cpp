@@ -20,6 +20,11 @@ extern Suite* trx_handle_suite();
 extern Suite* service_thd_suite();
 extern Suite* ist_suite();
 extern Suite* saved_state_suite();
+extern Suite* cert_index_flat_suite();
+extern Suite* monitor_suite();
+extern Suite* group_commit_suite();
+extern Suite* apply_scheduler_suite();
+extern Suite* applier_tuner_suite();
 
 static suite_creator_t suites[] =
 {
@@ -31,6 +36,11 @@ static suite_creator_t suites[] =
     service_thd_suite,
     ist_suite,
     saved_state_suite,
+    cert_index_flat_suite,
+    monitor_suite,
+    group_commit_suite,
+    apply_scheduler_suite,
+    applier_tuner_suite,
     0
 };
 
@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2014 Codership Oy <info@codership.com>
+ */
+
+#include "../src/group_commit.hpp"
+
+#include "gu_atomic.hpp"
+
+#include <check.h>
+#include <pthread.h>
+#include <unistd.h>
+
+using namespace galera;
+
+namespace
+{
+    struct Joiner
+    {
+        Joiner(GroupCommit& gc, wsrep_seqno_t seqno)
+            : gc_(gc), seqno_(seqno), from_(-1), upto_(-1), done_(0),
+              leader_(false), failed_(false) { }
+
+        GroupCommit&    gc_;
+        wsrep_seqno_t   seqno_;
+        wsrep_seqno_t   from_;
+        wsrep_seqno_t   upto_;
+        gu::Atomic<int> done_;
+        bool            leader_;
+        bool            failed_;
+
+        bool done() const { return done_() != 0; }
+
+    private:
+
+        Joiner(const Joiner&);
+        void operator=(const Joiner&);
+    };
+
+    void* join_thread(void* arg)
+    {
+        Joiner& j(*static_cast<Joiner*>(arg));
+
+        try
+        {
+            j.leader_ = j.gc_.join(j.seqno_, j.from_, j.upto_);
+            if (j.leader_) j.gc_.synced(j.upto_);
+        }
+        catch (gu::Exception& e)
+        {
+            j.failed_ = true;
+        }
+
+        j.done_ = 1;
+
+        return 0;
+    }
+
+    /* joiners are waiting if they have not returned after a while */
+    bool waiting(const Joiner& j)
+    {
+        usleep(100000);
+        return !j.done();
+    }
+}
+
+/* writesets committed during a sync are synced by the next leader at once */
+START_TEST(test_group_commit_grouping)
+{
+    GroupCommit   gc;
+    wsrep_seqno_t from, upto;
+
+    gc.set_initial_position(0);
+
+    fail_unless(gc.join(1, from, upto));
+    fail_if(from != 0 || upto != 1, "from: %lld, upto: %lld",
+            (long long)from, (long long)upto);
+
+    Joiner    j2(gc, 2), j3(gc, 3);
+    pthread_t t2, t3;
+
+    fail_if(pthread_create(&t2, 0, join_thread, &j2));
+    fail_if(pthread_create(&t3, 0, join_thread, &j3));
+
+    /* sync of 1 is in progress, 2 and 3 must wait for it */
+    fail_unless(waiting(j2));
+    fail_unless(waiting(j3));
+
+    gc.synced(1);
+
+    pthread_join(t2, 0);
+    pthread_join(t3, 0);
+
+    fail_if(j2.failed_ || j3.failed_);
+    fail_unless(j2.leader_ != j3.leader_, "exactly one leader expected");
+
+    Joiner& leader(j2.leader_ ? j2 : j3);
+    fail_if(leader.from_ != 1 || leader.upto_ != 3, "from: %lld, upto: %lld",
+            (long long)leader.from_, (long long)leader.upto_);
+
+    /* already synced, must not wait or lead */
+    fail_if(gc.join(3, from, upto));
+}
+END_TEST
+
+/* committed writeset is not released until it is synced */
+START_TEST(test_group_commit_deferred)
+{
+    GroupCommit   gc;
+    wsrep_seqno_t from, upto;
+
+    gc.set_initial_position(10);
+
+    /* 11 is committed and being synced */
+    fail_unless(gc.join(11, from, upto));
+    fail_if(from != 10 || upto != 11);
+
+    Joiner    j12(gc, 12);
+    pthread_t t12;
+
+    fail_if(pthread_create(&t12, 0, join_thread, &j12));
+    fail_unless(waiting(j12));
+
+    /* 12 was committed after the sync had started, it leads the next one */
+    gc.synced(11);
+    pthread_join(t12, 0);
+
+    fail_if(j12.failed_);
+    fail_unless(j12.leader_);
+    fail_if(j12.from_ != 11 || j12.upto_ != 12);
+
+    /* next commit after an idle period starts a new group */
+    fail_unless(gc.join(13, from, upto));
+    fail_if(from != 12 || upto != 13);
+    gc.synced(13);
+}
+END_TEST
+
+/* failed sync fails all waiting and later committers */
+START_TEST(test_group_commit_failure)
+{
+    GroupCommit   gc;
+    wsrep_seqno_t from, upto;
+
+    gc.set_initial_position(0);
+
+    fail_unless(gc.join(1, from, upto));
+
+    Joiner    j2(gc, 2);
+    pthread_t t2;
+
+    fail_if(pthread_create(&t2, 0, join_thread, &j2));
+    fail_unless(waiting(j2));
+
+    gc.failed();
+    pthread_join(t2, 0);
+
+    fail_unless(j2.failed_);
+    fail_if(j2.leader_);
+
+    try
+    {
+        gc.join(3, from, upto);
+        fail("join() after failed sync did not throw");
+    }
+    catch (gu::Exception& e) {}
+
+    /* new position, e.g. after state transfer, clears failure */
+    gc.set_initial_position(5);
+    fail_unless(gc.join(6, from, upto));
+    fail_if(from != 5 || upto != 6);
+    gc.synced(6);
+}
+END_TEST
+
+Suite* group_commit_suite()
+{
+    Suite* s = suite_create("group_commit");
+    TCase* tc;
+
+    tc = tcase_create("test_group_commit");
+    tcase_add_test(tc, test_group_commit_grouping);
+    tcase_add_test(tc, test_group_commit_deferred);
+    tcase_add_test(tc, test_group_commit_failure);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
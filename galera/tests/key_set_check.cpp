@@ -13,6 +13,8 @@
 
 #include <check.h>
 
+#include <sstream>
+
 using namespace galera;
 
 class TestBaseName : public gu::Allocator::BaseName
@@ -237,10 +239,83 @@ START_TEST (ver0)
 }
 END_TEST
 
+START_TEST (escalation)
+{
+    KeySet::Version const tk_ver(KeySet::FLAT16A);
+
+    gu::byte_t reserved[1024];
+    TestBaseName const str("key_set_escalation_test");
+    KeySetOut kso (reserved, sizeof(reserved), str, tk_ver, 3);
+
+    /* first 3 keys are added as is: a0, a0:t1, a0:t1:r1, a0:t1:r2, a0:t1:r3 */
+    TestKey tk0(tk_ver, EXCLUSIVE, false, "a0", "t1", "r1");
+    TestKey tk1(tk_ver, EXCLUSIVE, false, "a0", "t1", "r2");
+    TestKey tk2(tk_ver, EXCLUSIVE, false, "a0", "t1", "r3");
+    kso.append(tk0());
+    kso.append(tk1());
+    kso.append(tk2());
+    fail_if (kso.count() != 5, "key count: expected 5, got %d", kso.count());
+    fail_if (kso.escalated());
+
+    /* next row key is replaced with exclusive a0:t1 */
+    TestKey tk3(tk_ver, SHARED, false, "a0", "t1", "r4");
+    kso.append(tk3());
+    fail_if (kso.count() != 6, "key count: expected 6, got %d", kso.count());
+    fail_if (!kso.escalated());
+
+    /* further rows of the same table add nothing */
+    for (int i(0); i < 100; ++i)
+    {
+        std::ostringstream os;
+        os << "row" << i;
+        std::string const row(os.str());
+        TestKey tk(tk_ver, EXCLUSIVE, true, "a0", "t1", row.c_str());
+        kso.append(tk());
+    }
+    fail_if (kso.count() != 6, "key count: expected 6, got %d", kso.count());
+
+    /* a0:t2 */
+    TestKey tk4(tk_ver, EXCLUSIVE, false, "a0", "t2", "r1");
+    kso.append(tk4());
+    fail_if (kso.count() != 7, "key count: expected 7, got %d", kso.count());
+
+    /* keys of less than 3 parts are not escalated: a0:t3 */
+    TestKey tk5(tk_ver, SHARED, false, "a0", "t3");
+    kso.append(tk5());
+    fail_if (kso.count() != 8, "key count: expected 8, got %d", kso.count());
+
+    KeySetOut::GatherVector out;
+    out->reserve(kso.page_count());
+    size_t const out_size(kso.gather(out));
+
+    std::vector<gu::byte_t> in;
+    in.reserve(out_size);
+    for (size_t i(0); i < out->size(); ++i)
+    {
+        const gu::byte_t* ptr(reinterpret_cast<const gu::byte_t*>(out[i].ptr));
+        in.insert (in.end(), ptr, ptr + out[i].size);
+    }
+
+    KeySetIn ksi (kso.version(), in.data(), in.size());
+    fail_if (ksi.count() != kso.count());
+
+    int exclusive(0);
+    for (int i(0); i < ksi.count(); ++i)
+    {
+        KeySet::KeyPart kp(ksi.next());
+        exclusive += !kp.shared();
+    }
+
+    /* r1, r2, r3, a0:t1 and a0:t2 */
+    fail_if (exclusive != 5, "exclusive keys: expected 5, got %d", exclusive);
+}
+END_TEST
+
 Suite* key_set_suite ()
 {
     TCase* t = tcase_create ("KeySet");
     tcase_add_test (t, ver0);
+    tcase_add_test (t, escalation);
     tcase_set_timeout(t, 60);
 
     Suite* s = suite_create ("KeySet");
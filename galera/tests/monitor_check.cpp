@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2014 Codership Oy <info@codership.com>
+ */
+
+#include "../src/monitor.hpp"
+
+#if defined(__linux__)
+#include "../src/monitor_lf.hpp"
+#endif
+
+#include <check.h>
+#include <pthread.h>
+#include <cerrno>
+
+using namespace galera;
+
+namespace
+{
+    /* enters strictly in order, like LocalOrder */
+    class SeqnoOrder
+    {
+    public:
+        SeqnoOrder(wsrep_seqno_t seqno) : seqno_(seqno) { }
+        void lock()   { }
+        void unlock() { }
+        wsrep_seqno_t seqno() const { return seqno_; }
+        bool condition(wsrep_seqno_t last_entered,
+                       wsrep_seqno_t last_left) const
+        {
+            return (last_left + 1 == seqno_);
+        }
+    private:
+        wsrep_seqno_t const seqno_;
+    };
+
+    long const n_seqnos(20000);
+    int  const n_threads(8);
+
+    template <class M>
+    struct OrderArgs
+    {
+        OrderArgs(ssize_t window) : mon_(window), next_(0), last_(0),
+                                    errors_(0) { }
+
+        M             mon_;
+        wsrep_seqno_t next_;   // next seqno to grab
+        wsrep_seqno_t last_;   // last seqno seen in critical section
+        long          errors_;
+    };
+
+    template <class M>
+    void* order_thread(void* arg)
+    {
+        OrderArgs<M>& a(*static_cast<OrderArgs<M>*>(arg));
+
+        for (;;)
+        {
+            wsrep_seqno_t const seqno(gu_atomic_add_and_fetch(&a.next_, 1));
+            if (seqno > n_seqnos) break;
+
+            SeqnoOrder so(seqno);
+
+            if (seqno % 13 == 0)
+            {
+                a.mon_.self_cancel(so);
+                continue;
+            }
+
+            a.mon_.enter(so);
+
+            /* every 13th seqno is canceled */
+            wsrep_seqno_t prev(seqno - 1);
+            if (prev > 0 && prev % 13 == 0) --prev;
+
+            if (a.last_ != prev) ++a.errors_;
+            a.last_ = seqno;
+
+            a.mon_.leave(so);
+        }
+
+        return 0;
+    }
+
+    template <class M>
+    void test_order(ssize_t window = M::DEFAULT_SIZE)
+    {
+        OrderArgs<M> args(window);
+        pthread_t    threads[n_threads];
+
+        args.mon_.set_initial_position(0);
+
+        for (int i(0); i < n_threads; ++i)
+        {
+            fail_if(pthread_create(&threads[i], 0, order_thread<M>, &args));
+        }
+
+        for (int i(0); i < n_threads; ++i) pthread_join(threads[i], 0);
+
+        fail_if(args.errors_ != 0, "%ld entered out of order", args.errors_);
+        fail_if(args.mon_.last_left() != n_seqnos,
+                "last left %lld", (long long)args.mon_.last_left());
+
+        args.mon_.drain(n_seqnos);
+        fail_if(args.mon_.would_block(n_seqnos + 1));
+    }
+
+    template <class M>
+    struct CancelArgs
+    {
+        CancelArgs() : mon_(), ret_(0) { }
+
+        M   mon_;
+        int ret_;
+    };
+
+    template <class M>
+    void* cancel_thread(void* arg)
+    {
+        CancelArgs<M>& a(*static_cast<CancelArgs<M>*>(arg));
+        SeqnoOrder     so(2);
+
+        try
+        {
+            a.mon_.enter(so);
+            a.mon_.leave(so);
+        }
+        catch (gu::Exception& e)
+        {
+            a.ret_ = e.get_errno();
+            a.mon_.self_cancel(so);
+        }
+
+        return 0;
+    }
+
+    template <class M>
+    void test_cancel()
+    {
+        CancelArgs<M> args;
+        SeqnoOrder    so(1);
+        pthread_t     thread;
+
+        args.mon_.set_initial_position(0);
+        fail_if(!args.mon_.ready(so));
+        fail_if(args.mon_.ready(SeqnoOrder(2)));
+        args.mon_.enter(so);
+
+        fail_if(pthread_create(&thread, 0, cancel_thread<M>, &args));
+
+        /* 2 is either waiting for 1 or has not entered yet */
+        args.mon_.interrupt(SeqnoOrder(2));
+        pthread_join(thread, 0);
+        fail_if(args.ret_ != EINTR, "expected EINTR, got %d", args.ret_);
+        fail_if(args.mon_.last_left() != 0);
+
+        args.mon_.leave(so);
+        args.mon_.wait(2);
+        fail_if(args.mon_.last_left() != 2);
+
+        try
+        {
+            gu::datetime::Date const until(gu::datetime::Date::calendar() +
+                                           gu::datetime::Period("PT0.01S"));
+            args.mon_.wait(3, until);
+            fail("wait() for seqno 3 did not time out");
+        }
+        catch (gu::Exception& e)
+        {
+            fail_if(e.get_errno() != ETIMEDOUT);
+        }
+    }
+}
+
+START_TEST(test_monitor_order)
+{
+    test_order<Monitor<SeqnoOrder> >();
+}
+END_TEST
+
+/* threads have to wait for window space */
+START_TEST(test_monitor_window)
+{
+    test_order<Monitor<SeqnoOrder> >(5);
+}
+END_TEST
+
+START_TEST(test_monitor_cancel)
+{
+    test_cancel<Monitor<SeqnoOrder> >();
+}
+END_TEST
+
+#if defined(__linux__)
+START_TEST(test_monitor_lf_order)
+{
+    test_order<MonitorLF<SeqnoOrder> >();
+}
+END_TEST
+
+START_TEST(test_monitor_lf_window)
+{
+    test_order<MonitorLF<SeqnoOrder> >(5);
+}
+END_TEST
+
+START_TEST(test_monitor_lf_cancel)
+{
+    test_cancel<MonitorLF<SeqnoOrder> >();
+}
+END_TEST
+#endif /* __linux__ */
+
+Suite* monitor_suite()
+{
+    Suite* s = suite_create("monitor");
+    TCase* tc;
+
+    tc = tcase_create("test_monitor");
+    tcase_add_test(tc, test_monitor_order);
+    tcase_add_test(tc, test_monitor_window);
+    tcase_add_test(tc, test_monitor_cancel);
+#if defined(__linux__)
+    tcase_add_test(tc, test_monitor_lf_order);
+    tcase_add_test(tc, test_monitor_lf_window);
+    tcase_add_test(tc, test_monitor_lf_cancel);
+#endif /* __linux__ */
+    tcase_set_timeout(tc, 60);
+    suite_add_tcase(s, tc);
+
+    return s;
+}
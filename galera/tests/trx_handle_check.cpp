@@ -190,6 +190,56 @@ START_TEST(test_serialization)
 }
 END_TEST
 
+START_TEST(test_key_deps)
+{
+    TrxHandle::LocalPool tp(TrxHandle::LOCAL_STORAGE_SIZE, 4, "test_key_deps");
+    wsrep_uuid_t uuid = {{1, }};
+    TrxHandle* trx(TrxHandle::New(tp, TrxHandle::Defaults, uuid, -1, 1));
+
+    fail_if(trx->key_deps_valid());
+
+    trx->init_key_deps(10, 3);
+    fail_unless(trx->key_deps_valid());
+    fail_unless(trx->key_deps_floor() == 10);
+    fail_unless(trx->key_deps_size() == 0);
+
+    // seqnos at or below floor and duplicates are not recorded
+    trx->add_key_dep(5);
+    trx->add_key_dep(10);
+    trx->add_key_dep(12);
+    trx->add_key_dep(12);
+    trx->add_key_dep(15);
+    fail_unless(trx->key_deps_size() == 2);
+    fail_unless(trx->key_dep(0) == 12);
+    fail_unless(trx->key_dep(1) == 15);
+
+    trx->add_key_dep(17);
+    fail_unless(trx->key_deps_size() == 3);
+
+    // raising the floor drops deps it covers
+    trx->raise_key_deps_floor(12);
+    fail_unless(trx->key_deps_floor() == 12);
+    fail_unless(trx->key_deps_size() == 2);
+    fail_unless(trx->key_dep(0) == 15);
+    fail_unless(trx->key_dep(1) == 17);
+
+    trx->raise_key_deps_floor(11);
+    fail_unless(trx->key_deps_floor() == 12);
+
+    trx->add_key_dep(19);
+    fail_unless(trx->key_deps_size() == 3);
+
+    // overflow invalidates key deps
+    trx->add_key_dep(20);
+    fail_if(trx->key_deps_valid());
+
+    trx->add_key_dep(21);
+    fail_if(trx->key_deps_valid());
+
+    trx->unref();
+}
+END_TEST
+
 Suite* trx_handle_suite()
 {
     Suite* s = suite_create("trx_handle");
@@ -204,5 +254,9 @@ Suite* trx_handle_suite()
     tcase_add_test(tc, test_serialization);
     suite_add_tcase(s, tc);
 
+    tc = tcase_create("test_key_deps");
+    tcase_add_test(tc, test_key_deps);
+    suite_add_tcase(s, tc);
+
     return s;
 }
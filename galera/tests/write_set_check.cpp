@@ -431,9 +431,10 @@ START_TEST(test_cert_hierarchical_v1)
 END_TEST
 
 
-START_TEST(test_cert_hierarchical_v2)
+/* batch > 1 makes write sets certified in batches by append_trxs() */
+static void
+cert_hierarchical_v2(size_t const batch)
 {
-    log_info << "test_cert_hierarchical_v2";
     const int version(2);
     struct wsinfo_ {
         wsrep_uuid_t     uuid;
@@ -518,6 +519,9 @@ START_TEST(test_cert_hierarchical_v2)
 
     mark_point();
 
+    std::vector<TrxHandle*> trxs;
+    std::vector<gu::Buffer> bufs(nws); // must outlive batched trxs
+
     for (size_t i(0); i < nws; ++i)
     {
         TrxHandle* trx(TrxHandle::New(lp, trx_params, wsi[i].uuid,
@@ -532,7 +536,8 @@ START_TEST(test_cert_hierarchical_v2)
 
         // serialize/unserialize to verify that ver1 trx is serializable
         const galera::MappedBuffer& wc(trx->write_set_collection());
-        gu::Buffer buf(wc.size());
+        gu::Buffer& buf(bufs[i]);
+        buf.resize(wc.size());
         std::copy(&wc[0], &wc[0] + wc.size(), &buf[0]);
         trx->unref();
         trx = TrxHandle::New(sp);
@@ -541,19 +546,338 @@ START_TEST(test_cert_hierarchical_v2)
         trx->append_write_set(&buf[0] + offset, buf.size() - offset);
 
         trx->set_received(0, wsi[i].local_seqno, wsi[i].global_seqno);
-        Certification::TestResult result(cert.append_trx(trx));
-        fail_unless(result == wsi[i].result, "g: %lld res: %d exp: %d",
-                    trx->global_seqno(), result, wsi[i].result);
-        fail_unless(trx->depends_seqno() == wsi[i].expected_depends_seqno,
-                    "wsi: %zu g: %lld ld: %lld eld: %lld",
-                    i, trx->global_seqno(), trx->depends_seqno(),
-                    wsi[i].expected_depends_seqno);
+        trxs.push_back(trx);
+
+        if (trxs.size() < batch && i + 1 < nws) continue;
+
+        std::vector<Certification::TestResult> results(trxs.size());
+
+        if (batch > 1)
+        {
+            cert.append_trxs(&trxs[0], trxs.size(), &results[0]);
+        }
+        else
+        {
+            results[0] = cert.append_trx(trx);
+        }
+
+        for (size_t j(0); j < trxs.size(); ++j)
+        {
+            size_t const w(i + 1 - trxs.size() + j);
+
+            trx = trxs[j];
+            fail_unless(results[j] == wsi[w].result, "g: %lld res: %d exp: %d",
+                        trx->global_seqno(), results[j], wsi[w].result);
+            fail_unless(trx->depends_seqno() == wsi[w].expected_depends_seqno,
+                        "wsi: %zu g: %lld ld: %lld eld: %lld",
+                        w, trx->global_seqno(), trx->depends_seqno(),
+                        wsi[w].expected_depends_seqno);
+            cert.set_trx_committed(trx);
+            trx->unref();
+        }
+
+        trxs.clear();
+    }
+}
+
+START_TEST(test_cert_hierarchical_v2)
+{
+    log_info << "test_cert_hierarchical_v2";
+    cert_hierarchical_v2(1);
+}
+END_TEST
+
+START_TEST(test_cert_hierarchical_v2_batch)
+{
+    log_info << "test_cert_hierarchical_v2_batch";
+    cert_hierarchical_v2(4);
+}
+END_TEST
+
+
+/* builds v3 local trx with one key and gathers it into out */
+static TrxHandle*
+local_trx_v3(const wsrep_uuid_t& uuid, wsrep_trx_id_t const trx_id,
+             const char* const key, WriteSetNG::GatherVector& out,
+             wsrep_key_type_t const type = WSREP_KEY_EXCLUSIVE)
+{
+    galera::TrxHandle::Params const trx_params("", 3, KeySet::MAX_VERSION);
+    TrxHandle* const trx(TrxHandle::New(lp, trx_params, uuid, 1, trx_id));
+    wsrep_buf_t const parts[2] = { { void_cast("t"), 1 },
+                                   { key, strlen(key) } };
+
+    trx->append_key(KeyData(3, parts, 2, type, true));
+    trx->set_flags(TrxHandle::F_COMMIT);
+    trx->write_set_out().gather(trx->source_id(), trx->conn_id(),
+                                trx->trx_id(), out);
+    return trx;
+}
+
+/* turns gathered local trx into remote trx with the given seqnos and
+ * releases the local one, buf receives the write set and must outlive
+ * the remote trx */
+static TrxHandle*
+to_remote(TrxHandle* const trx, const WriteSetNG::GatherVector& out,
+          wsrep_seqno_t const last_seen, wsrep_seqno_t const seqno,
+          gu::Buffer& buf)
+{
+    trx->set_last_seen_seqno(last_seen);
+
+    buf.clear();
+    for (size_t i(0); i < out->size(); ++i)
+    {
+        const gu::byte_t* ptr(static_cast<const gu::byte_t*>(out[i].ptr));
+        buf.insert(buf.end(), ptr, ptr + out[i].size);
+    }
+    trx->unref();
+
+    TrxHandle* const remote(TrxHandle::New(sp));
+    remote->unserialize(&buf[0], buf.size(), 0);
+    remote->set_received(&buf[0], seqno, seqno);
+    return remote;
+}
+
+/* builds v3 trx with local_trx_v3() and turns it into remote trx */
+static TrxHandle*
+remote_trx_v3(const wsrep_uuid_t& uuid, wsrep_trx_id_t const trx_id,
+              const char* const key, wsrep_seqno_t const last_seen,
+              wsrep_seqno_t const seqno, gu::Buffer& buf,
+              wsrep_key_type_t const type = WSREP_KEY_EXCLUSIVE)
+{
+    WriteSetNG::GatherVector out;
+    TrxHandle* const trx(local_trx_v3(uuid, trx_id, key, out, type));
+    return to_remote(trx, out, last_seen, seqno, buf);
+}
+
+START_TEST(test_cert_purge_budget)
+{
+    log_info << "test_cert_purge_budget";
+
+    TestEnv env;
+    env.conf().set("cert.purge_budget", "2");
+
+    std::vector<gu::Buffer> bufs(7); // must outlive cert
+    galera::Certification cert(env.conf(), env.thd());
+    cert.assign_initial_position(0, 3);
+
+    wsrep_uuid_t const node = { {1, } };
+    const char* const keys[] = { "1", "2", "3", "4", "5", "6", "7" };
+
+    for (wsrep_seqno_t s(1); s <= 7; ++s)
+    {
+        TrxHandle* const trx(remote_trx_v3(node, s, keys[s - 1], s - 1, s,
+                                           bufs[s - 1]));
+        fail_unless(cert.append_trx(trx) == Certification::TEST_OK);
         cert.set_trx_committed(trx);
         trx->unref();
+
+        if (6 == s)
+        {
+            /* only the budgeted number of trxs is purged at once */
+            wsrep_seqno_t purged(cert.purge_trxs_upto(5, false));
+            fail_unless(2 == purged, "purged up to %lld", purged);
+            purged = cert.purge_trxs_upto(5, false);
+            fail_unless(4 == purged, "purged up to %lld", purged);
+        }
     }
+
+    /* the rest up to 5 was purged by the append of 7 */
+    wsrep_seqno_t purged(cert.purge_trxs_upto(5, false));
+    fail_unless(5 == purged, "purged up to %lld", purged);
+
+    /* purge never goes above safe to discard seqno: last seen of 7 */
+    purged = cert.purge_trxs_upto(7, true);
+    fail_unless(6 == purged, "purged up to %lld", purged);
 }
 END_TEST
 
+START_TEST(test_cert_key_deps)
+{
+    log_info << "test_cert_key_deps";
+
+    TestEnv env;
+    env.conf().set("cert.key_deps_max", "4");
+
+    std::vector<gu::Buffer> bufs(4); // must outlive cert
+    galera::Certification cert(env.conf(), env.thd());
+    cert.assign_initial_position(0, 3);
+
+    wsrep_uuid_t const node1 = { {1, } };
+    wsrep_uuid_t const node2 = { {2, } };
+    wsrep_uuid_t const node3 = { {3, } };
+
+    /* 1 and 2 hold key "k" shared, only 2 is remembered in the index */
+    TrxHandle* const t1(remote_trx_v3(node1, 1, "k", 0, 1, bufs[0],
+                                      WSREP_KEY_SHARED));
+    fail_unless(cert.append_trx(t1) == Certification::TEST_OK);
+
+    TrxHandle* const t2(remote_trx_v3(node2, 2, "k", 0, 2, bufs[1],
+                                      WSREP_KEY_SHARED));
+    fail_unless(cert.append_trx(t2) == Certification::TEST_OK);
+    fail_unless(t2->key_deps_valid());
+    fail_unless(t2->key_deps_size() == 0);
+
+    /* 3 takes "k" exclusively: it must not be applied before 1 finishes,
+     * though 1 is not ordered before 2 */
+    TrxHandle* const t3(remote_trx_v3(node3, 3, "k", 0, 3, bufs[2]));
+    fail_unless(cert.append_trx(t3) == Certification::TEST_OK);
+    fail_unless(t3->depends_seqno() == 2);
+    fail_unless(t3->key_deps_valid());
+    fail_unless(t3->key_deps_floor() == 2, "floor: %lld",
+                t3->key_deps_floor());
+    fail_unless(t3->key_deps_size() == 0);
+
+    /* exclusive refs are ordered, so only the latest one is a dependency */
+    TrxHandle* const t4(remote_trx_v3(node3, 4, "k", 2, 4, bufs[3]));
+    fail_unless(cert.append_trx(t4) == Certification::TEST_OK);
+    fail_unless(t4->depends_seqno() == 3);
+    fail_unless(t4->key_deps_floor() == 2);
+    fail_unless(t4->key_deps_size() == 1);
+    fail_unless(t4->key_dep(0) == 3);
+
+    TrxHandle* const trxs[] = { t1, t2, t3, t4 };
+    for (size_t i(0); i < sizeof(trxs)/sizeof(trxs[0]); ++i)
+    {
+        cert.set_trx_committed(trxs[i]);
+        trxs[i]->unref();
+    }
+}
+END_TEST
+
+/* builds v3 local trx which modifies rows of table t:k with the given key
+ * escalation threshold and gathers it into out */
+static TrxHandle*
+rows_trx_v3(const wsrep_uuid_t& uuid, wsrep_trx_id_t const trx_id,
+            const char* const rows[], size_t const n, int const esc,
+            WriteSetNG::GatherVector& out)
+{
+    galera::TrxHandle::Params const trx_params("", 3, KeySet::MAX_VERSION,
+                                               WriteSetNG::MAX_SIZE, esc);
+    TrxHandle* const trx(TrxHandle::New(lp, trx_params, uuid, 1, trx_id));
+
+    for (size_t i(0); i < n; ++i)
+    {
+        wsrep_buf_t const parts[3] = { { void_cast("t"), 1 },
+                                       { void_cast("k"), 1 },
+                                       { rows[i], strlen(rows[i]) } };
+        trx->append_key(KeyData(3, parts, 3, WSREP_KEY_EXCLUSIVE, true));
+    }
+
+    trx->set_flags(TrxHandle::F_COMMIT);
+    trx->write_set_out().gather(trx->source_id(), trx->conn_id(),
+                                trx->trx_id(), out);
+    return trx;
+}
+
+static void
+cert_escalation(bool const honour)
+{
+    TestEnv env;
+    std::vector<gu::Buffer> bufs(2); // must outlive cert
+    galera::Certification cert(env.conf(), env.thd());
+    cert.assign_initial_position(0, 3, honour);
+
+    wsrep_uuid_t const node1 = { {1, } };
+    wsrep_uuid_t const node2 = { {2, } };
+
+    /* node1 modifies row r9, table key t:k is its shared parent */
+    const char* const rows1[] = { "r9" };
+    WriteSetNG::GatherVector out1;
+    TrxHandle* const t1(to_remote(rows_trx_v3(node1, 1, rows1, 1, 0, out1),
+                                  out1, 0, 1, bufs[0]));
+    fail_unless(cert.append_trx(t1) == Certification::TEST_OK);
+    fail_if(t1->keys_escalated());
+
+    /* node2 has not seen 1, its second row is escalated to exclusive t:k */
+    const char* const rows2[] = { "r1", "r2" };
+    WriteSetNG::GatherVector out2;
+    TrxHandle* const t2(to_remote(rows_trx_v3(node2, 2, rows2, 2, 1, out2),
+                                  out2, 0, 2, bufs[1]));
+    fail_unless(t2->keys_escalated());
+
+    Certification::TestResult const res(cert.append_trx(t2));
+    fail_unless(res == (honour ? Certification::TEST_FAILED :
+                        Certification::TEST_OK),
+                "honour: %d, result: %d", honour, res);
+
+    cert.set_trx_committed(t1);
+    cert.set_trx_committed(t2);
+    t1->unref();
+    t2->unref();
+}
+
+START_TEST(test_cert_escalation)
+{
+    log_info << "test_cert_escalation";
+
+    /* escalated key conflicts with shared refs only if it is honoured */
+    cert_escalation(true);
+    cert_escalation(false);
+}
+END_TEST
+
+START_TEST(test_cert_precertify)
+{
+    log_info << "test_cert_precertify";
+
+    TestEnv env;
+    gu::Buffer buf; // must outlive cert which references it
+    galera::Certification cert(env.conf(), env.thd());
+    cert.assign_initial_position(0, 3);
+
+    wsrep_uuid_t const node1 = { {1, } };
+    wsrep_uuid_t const node2 = { {2, } };
+
+    /* trx from node1 modifying key "1" is certified with seqno 1 */
+    WriteSetNG::GatherVector out;
+    TrxHandle* trx(local_trx_v3(node1, 1, "1", out));
+    trx->set_last_seen_seqno(0);
+
+    for (size_t i(0); i < out->size(); ++i)
+    {
+        const gu::byte_t* ptr(static_cast<const gu::byte_t*>(out[i].ptr));
+        buf.insert(buf.end(), ptr, ptr + out[i].size);
+    }
+    trx->unref();
+
+    TrxHandle* const remote(TrxHandle::New(sp));
+    remote->unserialize(&buf[0], buf.size(), 0);
+    remote->set_received(&buf[0], 1, 1);
+    fail_unless(cert.append_trx(remote) == Certification::TEST_OK);
+
+    /* node2 trx which has not seen seqno 1 is doomed */
+    WriteSetNG::GatherVector out2;
+    trx = local_trx_v3(node2, 2, "1", out2);
+
+    std::vector<gu::byte_t> tmp;
+    KeySetIn ksi;
+    trx->write_set_out().gathered_keys(out2, ksi, tmp);
+    fail_unless(ksi.count() == 2, "key count: %d", ksi.count());
+
+    fail_unless(cert.precertify(trx, ksi, 0));
+    fail_if(cert.precertify(trx, ksi, 1));
+    trx->unref();
+
+    /* no conflict with the trx from the same node */
+    WriteSetNG::GatherVector out3;
+    trx = local_trx_v3(node1, 3, "1", out3);
+    KeySetIn ksi3;
+    trx->write_set_out().gathered_keys(out3, ksi3, tmp);
+    fail_if(cert.precertify(trx, ksi3, 0));
+    trx->unref();
+
+    /* nor on a different key */
+    WriteSetNG::GatherVector out4;
+    trx = local_trx_v3(node2, 4, "2", out4);
+    KeySetIn ksi4;
+    trx->write_set_out().gathered_keys(out4, ksi4, tmp);
+    fail_if(cert.precertify(trx, ksi4, 0));
+    trx->unref();
+
+    cert.set_trx_committed(remote);
+    remote->unref();
+}
+END_TEST
 
 START_TEST(test_trac_726)
 {
@@ -659,6 +983,27 @@ Suite* write_set_suite()
     tcase_set_timeout(tc, 20);
     suite_add_tcase(s, tc);
 
+    tc = tcase_create("test_cert_hierarchical_v2_batch");
+    tcase_add_test(tc, test_cert_hierarchical_v2_batch);
+    tcase_set_timeout(tc, 20);
+    suite_add_tcase(s, tc);
+
+    tc = tcase_create("test_cert_key_deps");
+    tcase_add_test(tc, test_cert_key_deps);
+    suite_add_tcase(s, tc);
+
+    tc = tcase_create("test_cert_escalation");
+    tcase_add_test(tc, test_cert_escalation);
+    suite_add_tcase(s, tc);
+
+    tc = tcase_create("test_cert_precertify");
+    tcase_add_test(tc, test_cert_precertify);
+    suite_add_tcase(s, tc);
+
+    tc = tcase_create("test_cert_purge_budget");
+    tcase_add_test(tc, test_cert_purge_budget);
+    suite_add_tcase(s, tc);
+
     tc = tcase_create("test_trac_726");
     tcase_add_test(tc, test_trac_726);
     tcase_set_timeout(tc, 20);
@@ -251,6 +251,44 @@ START_TEST (ver3_basic)
         fail("%s", e.what());
     }
 
+    try /* same with checksumming in pool threads */
+    {
+        CheckPool pool(2);
+        CheckPool::set_default_pool(&pool);
+
+        {
+            WriteSetIn wsi1(in_buf, 2);
+            WriteSetIn wsi2(in_buf, 2);
+            WriteSetIn wsi3(in_buf, 2); // destroyed without verification
+
+            mark_point();
+
+            try {
+                wsi2.verify_checksum();
+                fail("payload corruption slipped through 3");
+            }
+            catch (gu::Exception& e)
+            {
+                fail_if (e.get_errno() != EINVAL);
+            }
+
+            try {
+                wsi1.verify_checksum();
+                fail("payload corruption slipped through 4");
+            }
+            catch (gu::Exception& e)
+            {
+                fail_if (e.get_errno() != EINVAL);
+            }
+        }
+
+        CheckPool::set_default_pool(NULL);
+    }
+    catch (std::exception& e)
+    {
+        fail("%s", e.what());
+    }
+
     in[2] ^= 1; // corrupted 3rd byte of header
 
     try /* this is to test header corruption */
@@ -289,8 +327,10 @@ START_TEST (ver3_annotation)
     std::string const annotation("0xaabbccdd");
     uint16_t const flag2(0x1234);
 
+    fail_if (wso.data_version() != DataSet::EMPTY);
     wso.append_data (&data, sizeof(data), true);
     wso.append_annotation (annotation.c_str(), annotation.size(), true);
+    fail_if (wso.data_version() != DataSet::MAX_VERSION);
     wso.add_flags (flag2);
 
     uint16_t const flags(flag1 | flag2);
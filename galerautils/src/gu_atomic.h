@@ -87,6 +87,10 @@ extern "C" {
 #error "This GCC version does not support 8-byte atomics on this platform. Use GCC >= 4.7.x."
 #endif /* __ATOMIC_RELAXED */
 
+// if contents of ptr equal old, stores val into ptr and returns true
+#define gu_atomic_bool_cas(ptr, old, val)                       \
+    __sync_bool_compare_and_swap(ptr, old, val)
+
 #else /* __GNUC__ */
 #error "Compiler not supported"
 #endif
@@ -0,0 +1,256 @@
+// Copyright (C) 2014 Codership Oy <info@codership.com>
+
+/*!
+ * @file map-like container for dense, mostly monotonic integer keys
+ *       (e.g. seqnos) implemented on top of std::deque:
+ *
+ *       gu::DeqMap<int64_t, const void*> m;
+ *       m.insert(5, ptr);  // m.index_begin() == 5, m.index_end() == 6
+ *       m.push_back(ptr1); // key 6
+ *       m.insert(8, ptr2); // key 7 is a hole: m[7] == m.null_value()
+ *       m.pop_front();     // key 5 removed, m.index_begin() == 6
+ *
+ * Lookup by key is O(1), insertion at either end and removal from either end
+ * are O(1) amortized, there is no per-element allocation. Elements are stored
+ * in the order of their keys. Missing keys are represented by null values,
+ * which are never found at the ends of the container: removing an element
+ * at either end also removes all null values which are found next to it.
+ *
+ * $Id$
+ */
+
+#ifndef _GU_DEQMAP_HPP_
+#define _GU_DEQMAP_HPP_
+
+#include <deque>
+#include <algorithm>
+#include <cassert>
+
+namespace gu
+{
+
+template <typename Key, typename Val, class Alloc = std::allocator<Val> >
+class DeqMap
+{
+    typedef std::deque<Val, Alloc> base_type;
+
+public:
+
+    typedef Key index_type;
+    typedef Val value_type;
+
+    typedef typename base_type::size_type       size_type;
+    typedef typename base_type::difference_type difference_type;
+    typedef typename base_type::reference       reference;
+    typedef typename base_type::const_reference const_reference;
+    typedef typename base_type::iterator        iterator;
+    typedef typename base_type::const_iterator  const_iterator;
+
+    explicit
+    DeqMap(const value_type& null_value = value_type())
+        : base_ (),
+          begin_(),
+          null_ (null_value)
+    {}
+
+    DeqMap(const DeqMap& other)
+        : base_ (other.base_),
+          begin_(other.begin_),
+          null_ (other.null_)
+    {}
+
+    DeqMap& operator=(DeqMap other) { swap(other); return *this; }
+
+    const value_type& null_value() const { return null_; }
+
+    /* index of the first element, meaningful only if not empty */
+    index_type index_begin() const { return begin_; }
+
+    /* index past the last element */
+    index_type index_end() const { return begin_ + index_type(size()); }
+
+    index_type index_front() const { assert(!empty()); return index_begin(); }
+    index_type index_back()  const { assert(!empty()); return index_end() - 1;}
+
+    /* the number of elements including null values (index range width) */
+    size_type size()  const { return base_.size();  }
+    bool      empty() const { return base_.empty(); }
+
+    iterator       begin()       { return base_.begin(); }
+    const_iterator begin() const { return base_.begin(); }
+    iterator       end()         { return base_.end();   }
+    const_iterator end()   const { return base_.end();   }
+
+    reference       front()       { assert(!empty()); return base_.front(); }
+    const_reference front() const { assert(!empty()); return base_.front(); }
+    reference       back()        { assert(!empty()); return base_.back();  }
+    const_reference back()  const { assert(!empty()); return base_.back();  }
+
+    /* index of the element pointed to by iterator */
+    index_type index(const_iterator it) const
+    {
+        return begin_ + index_type(it - const_iterator(base_.begin()));
+    }
+
+    bool in_range(index_type const i) const
+    {
+        return (i >= index_begin() && i < index_end());
+    }
+
+    /* unchecked access, i must be in range */
+    reference operator[] (index_type const i)
+    {
+        assert(in_range(i));
+        return base_[i - begin_];
+    }
+
+    const_reference operator[] (index_type const i) const
+    {
+        assert(in_range(i));
+        return base_[i - begin_];
+    }
+
+    /* @return element at index i or null value if i is out of range */
+    const_reference at(index_type const i) const
+    {
+        return (in_range(i) ? base_[i - begin_] : null_);
+    }
+
+    /* @return iterator pointing at element with index i or end() if there's
+     *         no such element, or it is null */
+    iterator find(index_type const i)
+    {
+        if (!in_range(i) || base_[i - begin_] == null_) return end();
+
+        return base_.begin() + (i - begin_);
+    }
+
+    const_iterator find(index_type const i) const
+    {
+        if (!in_range(i) || base_[i - begin_] == null_) return end();
+
+        return base_.begin() + (i - begin_);
+    }
+
+    /* @return iterator pointing at the first element with index > i */
+    iterator upper_bound(index_type const i)
+    {
+        if (i <  index_begin()) return begin();
+        if (i >= index_end())   return end();
+
+        return base_.begin() + (i - begin_ + 1);
+    }
+
+    void push_back(const value_type& val)
+    {
+        assert(val != null_);
+        base_.push_back(val);
+    }
+
+    void push_front(const value_type& val)
+    {
+        assert(val != null_);
+        base_.push_front(val);
+        --begin_;
+    }
+
+    /* Sets element at index i to val. If i is outside the current range,
+     * the range is extended filling the gap with null values. */
+    void insert(index_type const i, const value_type& val)
+    {
+        assert(val != null_);
+
+        if (empty())
+        {
+            begin_ = i;
+            base_.push_back(val);
+        }
+        else if (i >= index_end())
+        {
+            base_.insert(base_.end(), size_type(i - index_end()), null_);
+            base_.push_back(val);
+        }
+        else if (i < index_begin())
+        {
+            base_.insert(base_.begin(), size_type(index_begin() - i - 1),
+                         null_);
+            base_.push_front(val);
+            begin_ = i;
+        }
+        else
+        {
+            base_[i - begin_] = val;
+        }
+    }
+
+    /* removes the first element and null values following it */
+    void pop_front()
+    {
+        assert(!empty());
+
+        do
+        {
+            base_.pop_front();
+            ++begin_;
+        }
+        while (!empty() && base_.front() == null_);
+    }
+
+    /* removes the last element and null values preceding it */
+    void pop_back()
+    {
+        assert(!empty());
+
+        do
+        {
+            base_.pop_back();
+        }
+        while (!empty() && base_.back() == null_);
+    }
+
+    /* removes all elements with indices up to and including i */
+    void erase_upto(index_type const i)
+    {
+        while (!empty() && index_begin() <= i) pop_front();
+    }
+
+    /* sets the element to null value, trimming the ends if needed */
+    void erase(iterator const it)
+    {
+        assert(it != end());
+
+        if (it == base_.begin())
+        {
+            pop_front();
+        }
+        else if (it + 1 == base_.end())
+        {
+            pop_back();
+        }
+        else
+        {
+            *it = null_;
+        }
+    }
+
+    void clear() { base_.clear(); }
+
+    void swap(DeqMap& other)
+    {
+        using std::swap;
+        base_.swap(other.base_);
+        swap(begin_, other.begin_);
+        swap(null_,  other.null_);
+    }
+
+private:
+
+    base_type  base_;
+    index_type begin_;
+    value_type null_;
+
+}; /* class DeqMap */
+
+} /* namespace gu */
+
+#endif /* _GU_DEQMAP_HPP_ */
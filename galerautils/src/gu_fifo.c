@@ -303,10 +303,11 @@ void* gu_fifo_get_head (gu_fifo_t* q, int* err)
     }
 }
 
-/*! Advances FIFO head and unlocks FIFO. */
-void gu_fifo_pop_head (gu_fifo_t* q)
+static inline void fifo_advance_head (gu_fifo_t* q)
 {
-    if (FIFO_COL(q, q->head) == q->col_mask) {
+    if (FIFO_COL(q, q->head) == q->col_mask &&
+        /* in a nearly full queue tail may have wrapped into this row */
+        FIFO_ROW(q, q->head) != FIFO_ROW(q, q->tail)) {
         /* removing last unit from the row */
         ulong row = FIFO_ROW (q, q->head);
         assert (q->rows[row] != NULL);
@@ -320,6 +321,12 @@ void gu_fifo_pop_head (gu_fifo_t* q)
     if (gu_unlikely(q->used < q->used_min)) {
         q->used_min = q->used;
     }
+}
+
+/*! Advances FIFO head and unlocks FIFO. */
+void gu_fifo_pop_head (gu_fifo_t* q)
+{
+    fifo_advance_head (q);
 
     if (fifo_unlock_get(q)) {
         gu_fatal ("Faled to unlock queue to get item.");
@@ -327,6 +334,22 @@ void gu_fifo_pop_head (gu_fifo_t* q)
     }
 }
 
+/*! Advances FIFO head and returns pointer to the next head item keeping
+ *  FIFO locked. FIFO must hold more than one item. */
+void* gu_fifo_next_head (gu_fifo_t* q)
+{
+    assert (q->used > 1);
+
+    fifo_advance_head (q);
+
+    if (q->put_wait > 0) {
+        q->put_wait--;
+        gu_cond_signal (&q->put_cond);
+    }
+
+    return (FIFO_PTR(q, q->head));
+}
+
 /*! If FIFO is not full, returns pointer to the tail item and locks FIFO,
  *  otherwise blocks. Or returns NULL if FIFO is closed. */
 void* gu_fifo_get_tail (gu_fifo_t* q)
@@ -45,6 +45,9 @@ extern void  gu_fifo_release   (gu_fifo_t *q);
 extern void* gu_fifo_get_head  (gu_fifo_t* q, int* err);
 /*! Advance FIFO head pointer and release FIFO. */
 extern void  gu_fifo_pop_head  (gu_fifo_t* q);
+/*! Advance FIFO head pointer and get pointer to the next head item without
+ *  releasing FIFO. FIFO must contain more than one item. */
+extern void* gu_fifo_next_head (gu_fifo_t* q);
 /*! Lock FIFO and get pointer to tail item */
 extern void* gu_fifo_get_tail  (gu_fifo_t* q);
 /*! Advance FIFO tail pointer and release FIFO. */
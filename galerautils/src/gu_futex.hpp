@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2014 Codership Oy <info@codership.com>
+ */
+
+/**
+ * @file Thin wrappers around Linux futex(2) for lock-free structures which
+ *       need to put threads to sleep on a 32-bit word.
+ */
+
+#ifndef __GU_FUTEX__
+#define __GU_FUTEX__
+
+#if !defined(__linux__)
+#error "futexes are supported only on Linux"
+#endif
+
+#include "gu_datetime.hpp"
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <climits>
+#include <cerrno>
+#include <ctime>
+
+namespace gu
+{
+    /*! Sleeps while *addr == val.
+     *  @return 0 when woken up or -errno (EAGAIN if *addr != val) */
+    inline int futex_wait(volatile int* addr, int val)
+    {
+        long const ret(syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val,
+                               NULL, NULL, 0));
+        return (ret < 0 ? -errno : 0);
+    }
+
+    /*! Same as above, but gives up at calendar time until with -ETIMEDOUT */
+    inline int futex_wait(volatile int* addr, int val,
+                          const datetime::Date& until)
+    {
+        timespec ts;
+        until._timespec(ts);
+
+        long const ret(syscall(SYS_futex, addr,
+                               FUTEX_WAIT_BITSET_PRIVATE|FUTEX_CLOCK_REALTIME,
+                               val, &ts, NULL, FUTEX_BITSET_MATCH_ANY));
+        return (ret < 0 ? -errno : 0);
+    }
+
+    /*! Wakes up to n threads sleeping on addr.
+     *  @return the number of threads woken */
+    inline int futex_wake(volatile int* addr, int n = INT_MAX)
+    {
+        return syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, n, NULL, NULL, 0);
+    }
+}
+
+#endif /* __GU_FUTEX__ */
@@ -5,6 +5,8 @@
 #ifndef _gu_histogram_hpp_
 #define _gu_histogram_hpp_
 
+#include "gu_atomic.h"
+
 #include <map>
 #include <ostream>
 
@@ -23,6 +25,82 @@ namespace gu
     };
 
     std::ostream& operator<<(std::ostream&, const Histogram&);
+
+    /*!
+     * Fixed size histogram of non-negative integer values (e.g. latencies
+     * in nanoseconds) with 4 bins per power of 2, so percentiles are
+     * accurate within 25%. Can be updated concurrently without locking.
+     */
+    class LatencyHistogram
+    {
+    public:
+
+        LatencyHistogram() : cnt_() { clear(); }
+
+        void insert(long long const val)
+        {
+            gu_atomic_fetch_and_add(&cnt_[bin(val)], 1);
+        }
+
+        void clear()
+        {
+            for (int i(0); i < BINS; ++i) gu_atomic_fetch_and_and(&cnt_[i], 0);
+        }
+
+        /*! @return upper bound of the bin containing p-th fraction of
+         *          values, p in [0, 1], or 0 if histogram is empty */
+        long long percentile(double const p) const
+        {
+            long long cnt[BINS];
+            long long total(0);
+
+            for (int i(0); i < BINS; ++i)
+            {
+                gu_atomic_get(const_cast<long long*>(&cnt_[i]), &cnt[i]);
+                total += cnt[i];
+            }
+
+            if (0 == total) return 0;
+
+            long long const rank(p * total + 0.5);
+            long long       sum(0);
+
+            for (int i(0); i < BINS; ++i)
+            {
+                sum += cnt[i];
+                if (sum >= rank && cnt[i] > 0) return upper(i);
+            }
+
+            return upper(BINS - 1);
+        }
+
+    private:
+
+        static int const BINS = 248;
+
+        static int bin(long long const val)
+        {
+            if (val < 4) return (val > 0 ? val : 0);
+
+            int const e(63 - __builtin_clzll(val)); // val is in [2^e, 2^(e+1))
+
+            return ((e - 1) << 2) + ((val >> (e - 2)) & 3);
+        }
+
+        static long long upper(int const b)
+        {
+            if (b < 4) return b;
+
+            int const e((b >> 2) + 1);
+
+            return ((4LL + (b & 3) + 1) << (e - 2)) - 1;
+        }
+
+        long long cnt_[BINS];
+
+        LatencyHistogram(const LatencyHistogram&);
+        LatencyHistogram& operator=(const LatencyHistogram&);
+    };
 }
 
 #endif // _gu_histogram_hpp_
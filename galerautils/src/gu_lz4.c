@@ -0,0 +1,330 @@
+// Copyright (C) 2014 Codership Oy <info@codership.com>
+
+/**
+ * @file Fast LZ77 block compression producing LZ4 block format
+ *
+ * Block is a sequence of
+ *   token:  upper 4 bits - literal length, lower 4 bits - match length - 4,
+ *           value 15 means that length continues in the following bytes
+ *   [literal length continuation: 255 ... 255 <255]
+ *   literals
+ *   match offset: 2 bytes, little endian
+ *   [match length continuation: 255 ... 255 <255]
+ * The last sequence has literals only and is at least 5 bytes long.
+ *
+ * $Id$
+ */
+
+#include "gu_lz4.h"
+
+#include "gu_byteswap.h"
+
+#include <string.h>
+
+#define LZ4_MIN_MATCH     4
+#define LZ4_LAST_LITERALS 5
+#define LZ4_MF_LIMIT      12 /* last match must start this far from the end */
+#define LZ4_MAX_DIST      65535
+#define LZ4_HASH_LOG      12
+#define LZ4_RUN_MASK      15
+#define LZ4_SKIP_TRIGGER  6  /* search step grows every 2^6 failed attempts */
+
+static GU_FORCE_INLINE uint32_t
+lz4_read32 (const uint8_t* const p)
+{
+    uint32_t ret;
+    memcpy (&ret, p, sizeof(ret));
+    return ret;
+}
+
+static GU_FORCE_INLINE uint64_t
+lz4_read64 (const uint8_t* const p)
+{
+    uint64_t ret;
+    memcpy (&ret, p, sizeof(ret));
+    return ret;
+}
+
+/* returns length of common prefix of p and r, p is limited by end */
+static GU_FORCE_INLINE size_t
+lz4_common (const uint8_t* p, const uint8_t* r, const uint8_t* const end)
+{
+    const uint8_t* const begin = p;
+
+    while (p + sizeof(uint64_t) <= end)
+    {
+        uint64_t const diff = lz4_read64 (p) ^ lz4_read64 (r);
+
+        if (diff)
+        {
+#if defined(GU_LITTLE_ENDIAN)
+            return (p - begin) + (__builtin_ctzll (diff) >> 3);
+#else
+            return (p - begin) + (__builtin_clzll (diff) >> 3);
+#endif
+        }
+
+        p += sizeof(uint64_t);
+        r += sizeof(uint64_t);
+    }
+
+    while (p < end && *p == *r) { p++; r++; }
+
+    return (p - begin);
+}
+
+/* copies len bytes in 8-byte steps, may read and write up to 7 bytes past
+ * the end */
+static GU_FORCE_INLINE void
+lz4_wild_copy (uint8_t* dst, const uint8_t* src, size_t const len)
+{
+    uint8_t* const end = dst + len;
+
+    do
+    {
+        memcpy (dst, src, sizeof(uint64_t));
+        dst += sizeof(uint64_t);
+        src += sizeof(uint64_t);
+    }
+    while (dst < end);
+}
+
+static GU_FORCE_INLINE uint32_t
+lz4_hash (uint32_t const seq)
+{
+    return (seq * 2654435761U) >> (32 - LZ4_HASH_LOG);
+}
+
+static GU_FORCE_INLINE uint8_t*
+lz4_put_length (uint8_t* op, size_t len)
+{
+    len -= LZ4_RUN_MASK;
+
+    while (len >= 255) { *op++ = 255; len -= 255; }
+
+    *op++ = len;
+
+    return op;
+}
+
+/* emits literals and match, returns NULL if dst space is insufficient */
+static GU_FORCE_INLINE uint8_t*
+lz4_put_sequence (uint8_t*             op,
+                  uint8_t*       const oend,
+                  const uint8_t* const lit,
+                  size_t         const lit_len,
+                  size_t         const offset,
+                  size_t         const match_len)
+{
+    /* worst case sequence size, including the last literals token */
+    size_t const need = 1 + lit_len / 255 + 1 + lit_len + 2 +
+                        match_len / 255 + 1 + 1 + LZ4_LAST_LITERALS;
+
+    if ((size_t)(oend - op) < need) return NULL;
+
+    uint8_t* const token = op++;
+
+    if (lit_len >= LZ4_RUN_MASK)
+    {
+        *token = LZ4_RUN_MASK << 4;
+        op = lz4_put_length (op, lit_len);
+    }
+    else
+    {
+        *token = lit_len << 4;
+    }
+
+    if (match_len > 0 || offset > 0)
+    {
+        /* match is followed by at least LZ4_LAST_LITERALS bytes of input
+         * and need has LZ4_LAST_LITERALS + 2 bytes to spare */
+        lz4_wild_copy (op, lit, lit_len);
+        op += lit_len;
+
+        size_t const ml = match_len - LZ4_MIN_MATCH;
+
+        op[0] = offset & 0xff;
+        op[1] = offset >> 8;
+        op += 2;
+
+        if (ml >= LZ4_RUN_MASK)
+        {
+            *token |= LZ4_RUN_MASK;
+            op = lz4_put_length (op, ml);
+        }
+        else
+        {
+            *token |= ml;
+        }
+    }
+    else
+    {
+        memcpy (op, lit, lit_len);
+        op += lit_len;
+    }
+
+    return op;
+}
+
+size_t
+gu_lz4_compress (const void* const src, size_t const src_len,
+                 void* const dst, size_t const dst_len)
+{
+    const uint8_t* const base   = (const uint8_t*)src;
+    const uint8_t* const iend   = base + src_len;
+    const uint8_t*       ip     = base;
+    const uint8_t*       anchor = base;
+    uint8_t*       const obase  = (uint8_t*)dst;
+    uint8_t*       const oend   = obase + dst_len;
+    uint8_t*             op     = obase;
+
+    if (src_len > LZ4_MF_LIMIT)
+    {
+        const uint8_t* const mflimit    = iend - LZ4_MF_LIMIT;
+        const uint8_t* const matchlimit = iend - LZ4_LAST_LITERALS;
+        uint32_t             table[1 << LZ4_HASH_LOG];
+        unsigned int         attempts = 1 << LZ4_SKIP_TRIGGER;
+
+        memset (table, 0, sizeof(table));
+
+        for (ip = base + 1; ip <= mflimit;)
+        {
+            uint32_t       const seq = lz4_read32 (ip);
+            uint32_t       const h   = lz4_hash (seq);
+            const uint8_t*       ref = base + table[h];
+
+            table[h] = ip - base;
+
+            if (ref >= ip || ip - ref > LZ4_MAX_DIST || lz4_read32(ref) != seq)
+            {
+                /* skip faster through incompressible data */
+                ip += attempts++ >> LZ4_SKIP_TRIGGER;
+                continue;
+            }
+
+            attempts = 1 << LZ4_SKIP_TRIGGER;
+
+            /* extend match backwards */
+            while (ip > anchor && ref > base && ip[-1] == ref[-1])
+            {
+                ip--; ref--;
+            }
+
+            /* and forward */
+            const uint8_t* const mp = ip + LZ4_MIN_MATCH +
+                lz4_common (ip + LZ4_MIN_MATCH, ref + LZ4_MIN_MATCH,
+                            matchlimit);
+
+            op = lz4_put_sequence (op, oend, anchor, ip - anchor, ip - ref,
+                                   mp - ip);
+
+            if (NULL == op) return 0;
+
+            ip = anchor = mp;
+
+            if (ip <= mflimit)
+            {
+                table[lz4_hash(lz4_read32(ip - 2))] = ip - 2 - base;
+            }
+        }
+    }
+
+    op = lz4_put_sequence (op, oend, anchor, iend - anchor, 0, 0);
+
+    return (NULL != op ? (size_t)(op - obase) : 0);
+}
+
+/* reads length continuation, returns 0 on truncated input */
+static GU_FORCE_INLINE int
+lz4_get_length (const uint8_t** const ipp, const uint8_t* const iend,
+                size_t* const len)
+{
+    const uint8_t* ip = *ipp;
+    uint8_t b;
+
+    do
+    {
+        if (ip >= iend) return 0;
+        b = *ip++;
+        *len += b;
+    }
+    while (255 == b);
+
+    *ipp = ip;
+
+    return 1;
+}
+
+long
+gu_lz4_decompress (const void* const src, size_t const src_len,
+                   void* const dst, size_t const dst_len)
+{
+    const uint8_t*       ip    = (const uint8_t*)src;
+    const uint8_t* const iend  = ip + src_len;
+    uint8_t*       const obase = (uint8_t*)dst;
+    uint8_t*       const oend  = obase + dst_len;
+    uint8_t*             op    = obase;
+
+    while (ip < iend)
+    {
+        unsigned int const token = *ip++;
+        size_t             len   = token >> 4;
+
+        if (LZ4_RUN_MASK == len && !lz4_get_length (&ip, iend, &len))
+            return -1;
+
+        if (len > (size_t)(iend - ip) || len > (size_t)(oend - op))
+            return -1;
+
+        if (len + sizeof(uint64_t) <= (size_t)(iend - ip) &&
+            len + sizeof(uint64_t) <= (size_t)(oend - op))
+        {
+            lz4_wild_copy (op, ip, len);
+        }
+        else
+        {
+            memcpy (op, ip, len);
+        }
+
+        op += len;
+        ip += len;
+
+        if (ip == iend) break; /* last sequence has no match */
+
+        if (iend - ip < 2) return -1;
+
+        size_t const offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+
+        if (0 == offset || offset > (size_t)(op - obase)) return -1;
+
+        len = token & LZ4_RUN_MASK;
+
+        if (LZ4_RUN_MASK == len && !lz4_get_length (&ip, iend, &len))
+            return -1;
+
+        len += LZ4_MIN_MATCH;
+
+        if (len > (size_t)(oend - op)) return -1;
+
+        const uint8_t* match = op - offset;
+
+        if (offset >= sizeof(uint64_t) &&
+            len + sizeof(uint64_t) <= (size_t)(oend - op))
+        {
+            lz4_wild_copy (op, match, len);
+            op += len;
+        }
+        else if (offset >= len)
+        {
+            memcpy (op, match, len);
+            op += len;
+        }
+        else /* overlapping copy replicates the pattern */
+        {
+            while (len--) *op++ = *match++;
+        }
+    }
+
+    return (op - obase);
+}
@@ -0,0 +1,53 @@
+// Copyright (C) 2014 Codership Oy <info@codership.com>
+
+/**
+ * @file Fast LZ77 block compression producing LZ4 block format
+ *
+ * Greedy single-pass compressor with a small hash table of recent 4-byte
+ * sequences, tuned for speed rather than ratio. Decompressor validates all
+ * offsets and lengths against the input and output buffers, so malformed
+ * input results in error, never in out-of-bounds access.
+ *
+ * $Id$
+ */
+
+#ifndef _gu_lz4_h_
+#define _gu_lz4_h_
+
+#include "gu_macros.h"
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! maximum size of compressed block for a given input size */
+static GU_INLINE size_t
+gu_lz4_compress_bound (size_t const len)
+{
+    return len + len / 255 + 16;
+}
+
+/*!
+ * Compresses src into dst.
+ *
+ * @return compressed size or 0 if it does not fit into dst_len bytes
+ */
+extern size_t
+gu_lz4_compress (const void* src, size_t src_len, void* dst, size_t dst_len);
+
+/*!
+ * Decompresses src into dst.
+ *
+ * @return decompressed size or -1 if input is malformed or does not fit
+ *         into dst_len bytes
+ */
+extern long
+gu_lz4_decompress (const void* src, size_t src_len, void* dst, size_t dst_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _gu_lz4_h_ */
@@ -9,12 +9,31 @@
 #include "gu_logger.hpp"
 #include "gu_throw.hpp"
 
+extern "C" {
+#include "gu_limits.h"
+}
+
 #include <cerrno>
+#include <stdint.h>
 #include <sys/mman.h>
 
 // to avoid -Wold-style-cast
 extern "C" { static const void* const GU_MAP_FAILED = MAP_FAILED; }
 
+/* extends [addr, addr + length) to page boundary on the left */
+static inline uint8_t*
+page_align (void* const addr, size_t& length)
+{
+    size_t const page_mask(gu_page_size() - 1);
+
+    uint8_t* const ret(reinterpret_cast<uint8_t*>
+        (reinterpret_cast<uintptr_t>(addr) & ~page_mask));
+
+    length += static_cast<uint8_t*>(addr) - ret;
+
+    return ret;
+}
+
 namespace gu
 {
     MMap::MMap (const FileDescriptor& fd, bool const sequential)
@@ -73,6 +92,48 @@ namespace gu
         }
     }
 
+    void
+    MMap::sync (void* const addr, size_t const length) const
+    {
+        size_t         sync_length(length);
+        uint8_t* const sync_addr  (page_align(addr, sync_length));
+
+        if (msync (sync_addr, sync_length, MS_SYNC) < 0)
+        {
+            gu_throw_error(errno) << "msync(" << addr << ", " << length
+                                  << ") failed";
+        }
+    }
+
+    void
+    MMap::prefault (void* const addr, size_t const length) const
+    {
+        size_t         pf_length(length);
+        uint8_t* const pf_addr  (page_align(addr, pf_length));
+
+#if defined(MADV_POPULATE_WRITE) /* Linux 5.14 */
+        int ret;
+
+        while ((ret = madvise (pf_addr, pf_length, MADV_POPULATE_WRITE)) &&
+               EINTR == errno) {}
+
+        if (0 == ret) return;
+
+        if (EINVAL != errno) // EINVAL: not supported by the running kernel
+        {
+            gu_throw_error(errno) << "Failed to prefault " << pf_length
+                                  << " bytes at " << addr;
+        }
+#endif
+        int const err(posix_madvise (pf_addr, pf_length, MADV_WILLNEED));
+
+        if (err)
+        {
+            gu_throw_error(err) << "Failed to set MADV_WILLNEED on "
+                                << pf_length << " bytes at " << addr;
+        }
+    }
+
     void
     MMap::unmap ()
     {
@@ -26,6 +26,12 @@ public:
 
     void dont_need() const;
     void sync() const;
+    /*! syncs only the pages covering [addr, addr + length) */
+    void sync(void* addr, size_t length) const;
+    /*! prefaults the pages covering [addr, addr + length) for writing
+     *  without modifying them, which also allocates backing file blocks.
+     *  Where this is not supported, only schedules the pages for reading. */
+    void prefault(void* addr, size_t length) const;
     void unmap();
 
 private:
@@ -9,6 +9,7 @@
 #include "gu_crc32c_test.h"
 
 #include <string.h>
+#include <stdlib.h>
 
 #define long_input                     \
     "0123456789abcdef0123456789ABCDEF" \
@@ -129,6 +130,32 @@ START_TEST(test_hardware)
 }
 END_TEST
 
+// big buffers take a different path in hardware implementation
+START_TEST(test_hardware_long)
+{
+    size_t const size = 3 * 8192 * 3 + 3 * 256 * 2 + 13;
+    unsigned char* const buf = malloc(size);
+    size_t i;
+
+    fail_if(NULL == buf);
+    for (i = 0; i < size; i++) buf[i] = i * 31 + (i >> 8);
+
+    gu_crc32c_configure();
+
+    for (i = 0; i < 16; i++)
+    {
+        size_t const len = size - i * 997;
+        uint32_t const hw = gu_crc32c(buf + i, len);
+        uint32_t const sw =
+            ~crc32cSlicingBy8(GU_CRC32C_INIT, buf + i, len);
+
+        fail_if(hw != sw, "Length %zu: %#08x, expected %#08x", len, hw, sw);
+    }
+
+    free(buf);
+}
+END_TEST
+
 Suite *gu_crc32c_suite(void)
 {
     Suite *suite = suite_create("CRC32C implementation");
@@ -143,6 +170,7 @@ Suite *gu_crc32c_suite(void)
     TCase *hw = tcase_create("test_hw");
     suite_add_tcase (suite, hw);
     tcase_add_test  (hw, test_hardware);
+    tcase_add_test  (hw, test_hardware_long);
 
     return suite;
 }
@@ -0,0 +1,124 @@
+// Copyright (C) 2014 Codership Oy <info@codership.com>
+
+// $Id$
+
+#include "gu_deqmap.hpp"
+
+#include "gu_deqmap_test.hpp"
+
+#include <stdint.h>
+
+typedef gu::DeqMap<int64_t, const int*> Map;
+
+static int const vals[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+
+START_TEST (insert_find)
+{
+    Map m;
+
+    fail_if(!m.empty());
+    fail_if(m.null_value() != NULL);
+    fail_if(m.find(0) != m.end());
+    fail_if(m.at(0) != NULL);
+
+    m.insert(5, &vals[5]);
+    fail_if(m.empty());
+    fail_if(m.index_begin() != 5);
+    fail_if(m.index_end()   != 6);
+    fail_if(m.front() != &vals[5]);
+
+    m.push_back(&vals[6]);
+    fail_if(m.index_back() != 6);
+    fail_if(m[6] != &vals[6]);
+
+    /* hole at 7 */
+    m.insert(8, &vals[8]);
+    fail_if(m.size() != 4);
+    fail_if(m.at(7) != NULL);
+    fail_if(m.find(7) != m.end());
+    fail_if(m.find(8) == m.end());
+    fail_if(*m.find(8) != &vals[8]);
+    fail_if(m.index(m.find(8)) != 8);
+
+    /* fill the hole */
+    m.insert(7, &vals[7]);
+    fail_if(m.find(7) == m.end());
+    fail_if(m.size() != 4);
+
+    /* extend to the front, hole at 3 and 4 */
+    m.insert(2, &vals[2]);
+    fail_if(m.index_begin() != 2);
+    fail_if(m.size() != 7);
+    fail_if(m.at(3) != NULL);
+    fail_if(m.at(4) != NULL);
+    fail_if(m.at(2) != &vals[2]);
+    fail_if(m.at(1) != NULL);
+    fail_if(m.at(9) != NULL);
+
+    int64_t i(m.index_begin());
+    for (Map::const_iterator it(m.begin()); it != m.end(); ++it, ++i)
+    {
+        fail_if(m.index(it) != i);
+        fail_if(*it != NULL && *it != &vals[i]);
+    }
+}
+END_TEST
+
+START_TEST (erase)
+{
+    Map m;
+
+    for (int64_t i(1); i < 10; ++i) m.insert(i, &vals[i]);
+
+    fail_if(m.index_begin() != 1);
+    fail_if(m.index_back()  != 9);
+
+    /* erase in the middle leaves a hole */
+    m.erase(m.find(3));
+    fail_if(m.size() != 9);
+    fail_if(m.find(3) != m.end());
+
+    /* popping 2 must remove the hole at 3 too */
+    m.erase(m.find(1));
+    fail_if(m.index_begin() != 2);
+    m.pop_front();
+    fail_if(m.index_begin() != 4);
+    fail_if(m.front() != &vals[4]);
+
+    /* same at the back */
+    m.erase(m.find(8));
+    m.pop_back();
+    fail_if(m.index_back() != 7);
+    fail_if(m.back() != &vals[7]);
+
+    fail_if(m.upper_bound(5) != m.find(6));
+    fail_if(m.upper_bound(0) != m.begin());
+    fail_if(m.upper_bound(7) != m.end());
+
+    m.erase_upto(5);
+    fail_if(m.index_begin() != 6);
+    fail_if(m.size() != 2);
+
+    m.erase_upto(100);
+    fail_if(!m.empty());
+
+    m.insert(100, &vals[0]);
+    fail_if(m.index_begin() != 100);
+    fail_if(m.size() != 1);
+
+    m.clear();
+    fail_if(!m.empty());
+}
+END_TEST
+
+Suite *gu_deqmap_suite(void)
+{
+    Suite *s = suite_create("gu::DeqMap");
+    TCase *tc = tcase_create("gu_deqmap");
+
+    suite_add_tcase (s, tc);
+    tcase_add_test(tc, insert_find);
+    tcase_add_test(tc, erase);
+
+    return s;
+}
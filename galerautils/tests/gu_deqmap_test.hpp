@@ -0,0 +1,12 @@
+// Copyright (C) 2014 Codership Oy <info@codership.com>
+
+// $Id$
+
+#ifndef __gu_deqmap_test__
+#define __gu_deqmap_test__
+
+#include <check.h>
+
+extern Suite *gu_deqmap_suite(void);
+
+#endif /* __gu_deqmap_test__ */
@@ -58,6 +58,35 @@ START_TEST (gu_fifo_test)
              "gu_fifo_length() for empty queue is %ld",
              gu_fifo_length(fifo));
 
+    // refill FIFO and test batched pop
+    for (i = 0; i < FIFO_LENGTH; i++) {
+        item = gu_fifo_get_tail (fifo);
+        fail_if (item == NULL, "could not get item %ld", i);
+        *item = i;
+        gu_fifo_push_tail (fifo);
+    }
+
+    for (i = 0; i < used;) {
+        int  err;
+        long batch = 0;
+
+        item = gu_fifo_get_head (fifo, &err);
+        fail_if (item == NULL, "could not get item %ld", i);
+
+        for (;;) {
+            fail_if (*item != (ulong)i, "got %ld, expected %ld", *item, i);
+            i++;
+            batch++;
+            if (batch == 7 || gu_fifo_length(fifo) < 2) break;
+            item = gu_fifo_next_head (fifo);
+        }
+
+        gu_fifo_pop_head (fifo);
+        fail_if (gu_fifo_length(fifo) != used - i,
+                 "gu_fifo_length() is %ld, expected %ld",
+                 gu_fifo_length(fifo), used - i);
+    }
+
     gu_fifo_close (fifo);
 
     int err;
@@ -205,6 +234,82 @@ START_TEST(gu_fifo_cancel_test)
 }
 END_TEST
 
+/* minimal FIFO: 2 rows of 1024 items */
+#define FIFO_MIN_LENGTH 2048L
+
+static void*
+put_thread (void* arg)
+{
+    gu_fifo_t* q = arg;
+
+    /* blocks until there is room in the queue */
+    size_t* item = gu_fifo_get_tail (q);
+    fail_if (item == NULL);
+    *item = ITEM;
+    gu_fifo_push_tail (q);
+
+    return NULL;
+}
+
+/* every item taken by gu_fifo_next_head() must wake a blocked putter */
+START_TEST(gu_fifo_next_head_test)
+{
+    gu_fifo_t* q = gu_fifo_create (1, sizeof(size_t));
+    long i;
+
+    fail_if (q == NULL);
+
+    for (i = 0; i < FIFO_MIN_LENGTH; i++) {
+        size_t* item = gu_fifo_get_tail (q);
+        fail_if (item == NULL, "could not get item %ld", i);
+        *item = i;
+        gu_fifo_push_tail (q);
+    }
+
+    pthread_t t1, t2;
+    pthread_create (&t1, NULL, put_thread, q);
+    pthread_create (&t2, NULL, put_thread, q);
+
+    /* wait a bit to make sure both putters are blocked
+     * (even if they are not - still should work) */
+    usleep (100000 /* 0.1s */);
+    fail_if (gu_fifo_length(q) != FIFO_MIN_LENGTH);
+
+    int     err;
+    size_t* item = gu_fifo_get_head (q, &err);
+    fail_if (item == NULL);
+    fail_if (*item != 0);
+    item = gu_fifo_next_head (q);
+    fail_if (*item != 1);
+    gu_fifo_pop_head (q);
+
+    /* both putters must complete */
+    pthread_join (t1, NULL);
+    pthread_join (t2, NULL);
+    fail_if (gu_fifo_length(q) != FIFO_MIN_LENGTH);
+
+    /* order is preserved across rows */
+    for (i = 2; i < FIFO_MIN_LENGTH + 2; i++) {
+        item = gu_fifo_get_head (q, &err);
+        fail_if (item == NULL, "could not get item %ld", i);
+        fail_if (*item != (size_t)(i < FIFO_MIN_LENGTH ? i : ITEM),
+                 "got %zu at %ld", *item, i);
+        if (gu_fifo_length(q) > 1) {
+            item = gu_fifo_next_head (q);
+            i++;
+            fail_if (*item != (size_t)(i < FIFO_MIN_LENGTH ? i : ITEM),
+                     "got %zu at %ld", *item, i);
+        }
+        gu_fifo_pop_head (q);
+    }
+
+    fail_if (gu_fifo_length(q) != 0);
+
+    gu_fifo_close (q);
+    gu_fifo_destroy (q);
+}
+END_TEST
+
 Suite *gu_fifo_suite(void)
 {
     Suite *s  = suite_create("Galera FIFO functions");
@@ -213,6 +318,7 @@ Suite *gu_fifo_suite(void)
     suite_add_tcase (s, tc);
     tcase_add_test  (tc, gu_fifo_test);
     tcase_add_test  (tc, gu_fifo_cancel_test);
+    tcase_add_test  (tc, gu_fifo_next_head_test);
     return s;
 }
 
@@ -31,10 +31,37 @@ START_TEST(test_histogram)
 }
 END_TEST
 
+START_TEST(test_latency_histogram)
+{
+    LatencyHistogram hs;
+
+    fail_if(hs.percentile(0.5) != 0);
+
+    for (long long i = 1; i <= 1000; ++i) hs.insert(i);
+
+    /* percentiles are upper bin bounds, accurate within 25% */
+    long long const p50(hs.percentile(0.5));
+    fail_if(p50 < 500 || p50 > 625, "p50: %lld", p50);
+
+    long long const p99(hs.percentile(0.99));
+    fail_if(p99 < 990 || p99 > 1238, "p99: %lld", p99);
+
+    fail_if(hs.percentile(0.0) != 1);
+
+    hs.insert(-1);
+    hs.insert(1LL << 62);
+    fail_if(hs.percentile(1.0) < (1LL << 62));
+
+    hs.clear();
+    fail_if(hs.percentile(0.99) != 0);
+}
+END_TEST
+
 Suite* gu_histogram_suite()
 {
     TCase* t = tcase_create ("test_histogram");
     tcase_add_test (t, test_histogram);
+    tcase_add_test (t, test_latency_histogram);
 
     Suite* s = suite_create ("gu::Histogram");
     suite_add_tcase (s, t);
@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2014 Codership Oy <info@codership.com>
+ *
+ * $Id$
+ */
+
+#include "../src/gu_lz4.h"
+
+#include "gu_lz4_test.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+/* fills buf with text-like data of limited alphabet and some repeats */
+static void
+fill_buf (unsigned char* const buf, size_t const len, unsigned int seed)
+{
+    size_t i;
+
+    for (i = 0; i < len; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+
+        if (i > 64 && (seed >> 16) % 4 == 0)
+        {
+            buf[i] = buf[i - 1 - (seed >> 20) % 64];
+        }
+        else
+        {
+            buf[i] = 'a' + (seed >> 16) % 16;
+        }
+    }
+}
+
+static void
+roundtrip (const unsigned char* const src, size_t const len)
+{
+    size_t const   bound = gu_lz4_compress_bound(len);
+    unsigned char* zbuf  = malloc(bound);
+    unsigned char* out   = malloc(len + 1);
+
+    fail_if (NULL == zbuf || NULL == out);
+
+    size_t const zlen = gu_lz4_compress(src, len, zbuf, bound);
+    fail_if (0 == zlen, "Failed to compress %zu bytes", len);
+    fail_if (zlen > bound, "Compressed size %zu exceeds bound %zu",zlen,bound);
+
+    long const ret = gu_lz4_decompress(zbuf, zlen, out, len + 1);
+    fail_if (ret != (long)len, "Decompressed %ld bytes, expected %zu",ret,len);
+    fail_if (memcmp(src, out, len), "Data mismatch for length %zu", len);
+
+    /* output buffer too short */
+    if (len > 0)
+    {
+        fail_if (gu_lz4_decompress(zbuf, zlen, out, len - 1) >= 0);
+    }
+
+    free(out);
+    free(zbuf);
+}
+
+START_TEST (test_roundtrip)
+{
+    size_t const   max_len = 1 << 16;
+    unsigned char* buf     = malloc(max_len);
+    size_t         len;
+
+    fail_if (NULL == buf);
+
+    fill_buf (buf, max_len, 42);
+
+    for (len = 0; len < 300; len++) roundtrip (buf, len);
+    for (; len <= max_len; len = len * 2 + 1) roundtrip (buf, len);
+
+    /* highly compressible */
+    memset (buf, 'x', max_len);
+    roundtrip (buf, max_len);
+
+    /* incompressible */
+    unsigned int seed = 1;
+    for (len = 0; len < max_len; len++)
+    {
+        seed = seed * 1103515245 + 12345;
+        buf[len] = seed >> 16;
+    }
+    roundtrip (buf, max_len);
+
+    free(buf);
+}
+END_TEST
+
+START_TEST (test_compressible)
+{
+    size_t const   len  = 1 << 16;
+    unsigned char* buf  = malloc(len);
+    unsigned char* zbuf = malloc(len);
+
+    fail_if (NULL == buf || NULL == zbuf);
+
+    memset (buf, 'x', len);
+
+    /* output that does not fit must be reported, not truncated */
+    fail_if (0 != gu_lz4_compress(buf, len, zbuf, 16));
+
+    size_t const zlen = gu_lz4_compress(buf, len, zbuf, len);
+    fail_if (zlen == 0 || zlen > len / 200, "Compressed size: %zu", zlen);
+
+    free(zbuf);
+    free(buf);
+}
+END_TEST
+
+START_TEST (test_malformed)
+{
+    size_t const   len  = 4096;
+    unsigned char* buf  = malloc(len);
+    unsigned char* zbuf = malloc(gu_lz4_compress_bound(len));
+    unsigned char* out  = malloc(len);
+    size_t         i;
+
+    fail_if (NULL == buf || NULL == zbuf || NULL == out);
+
+    fill_buf (buf, len, 7);
+
+    size_t const zlen =
+        gu_lz4_compress(buf, len, zbuf, gu_lz4_compress_bound(len));
+    fail_if (0 == zlen);
+
+    /* truncated input must not decompress to the original length */
+    for (i = 0; i < zlen; i++)
+    {
+        fail_if (gu_lz4_decompress(zbuf, i, out, len) == (long)len,
+                 "Truncated input of %zu bytes accepted", i);
+    }
+
+    /* corrupted input must never write or read out of bounds */
+    for (i = 0; i < zlen; i++)
+    {
+        unsigned char const saved = zbuf[i];
+        zbuf[i] ^= 0xff;
+        (void)gu_lz4_decompress(zbuf, zlen, out, len);
+        zbuf[i] = saved;
+    }
+
+    /* match offset pointing before the start of output */
+    {
+        unsigned char const bad[] = { 0x10, 'a', 0x05, 0x00, 0x50,
+                                      'a', 'b', 'c', 'd', 'e' };
+        fail_if (gu_lz4_decompress(bad, sizeof(bad), out, len) >= 0);
+    }
+
+    free(out);
+    free(zbuf);
+    free(buf);
+}
+END_TEST
+
+Suite *gu_lz4_suite(void)
+{
+    Suite *suite = suite_create("LZ4 block compression");
+
+    TCase *tc = tcase_create("gu_lz4");
+
+    suite_add_tcase (suite, tc);
+    tcase_add_test  (tc, test_roundtrip);
+    tcase_add_test  (tc, test_compressible);
+    tcase_add_test  (tc, test_malformed);
+
+    return suite;
+}
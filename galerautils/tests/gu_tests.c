@@ -15,6 +15,7 @@
 #include "gu_mmh3_test.h"
 #include "gu_spooky_test.h"
 #include "gu_crc32c_test.h"
+#include "gu_lz4_test.h"
 #include "gu_hash_test.h"
 #include "gu_dbug_test.h"
 #include "gu_time_test.h"
@@ -35,6 +36,7 @@ static suite_creator_t suites[] =
         gu_mmh3_suite,
         gu_spooky_suite,
         gu_crc32c_suite,
+        gu_lz4_suite,
         gu_hash_suite,
         gu_dbug_suite,
         gu_time_suite,
@@ -33,7 +33,14 @@ namespace gcache
     }
 
     void
-    GCache::constructor_common() {}
+    GCache::constructor_common()
+    {
+        if (!seqno2ptr.empty()) // recovered history, all buffers released
+        {
+            seqno_max      = seqno2ptr.index_back();
+            seqno_released = seqno_max;
+        }
+    }
 
     GCache::GCache (gu::Config& cfg, const std::string& data_dir)
         :
@@ -43,10 +50,12 @@ namespace gcache
         cond      (),
         seqno2ptr (),
         mem       (params.mem_size(), seqno2ptr),
-        rb        (params.rb_name(), params.rb_size(), seqno2ptr),
+        rb        (params.rb_name(), params.rb_size(), seqno2ptr,
+                   params.recover(), params.lazy_prealloc()),
         ps        (params.dir_name(),
                    params.keep_pages_size(),
                    params.page_size(),
+                   params.page_prealloc(),
                    /* keep last page if PS is the only storage */
                    !((params.mem_size() + params.rb_size()) > 0)),
         mallocs   (0),
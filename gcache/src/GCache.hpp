@@ -13,7 +13,6 @@
 
 #include <string>
 #include <iostream>
-#include <map>
 #ifndef NDEBUG
 #include <set>
 #endif
@@ -32,7 +31,10 @@ namespace gcache
 
         /*!
          * Creates a new gcache file in "gcache.name" conf parameter or
-         * in data_dir. If file already exists, it gets overwritten.
+         * in data_dir. If file already exists, it gets overwritten, unless
+         * "gcache.recover" is set, in which case the history it contains is
+         * recovered (see seqno_reset(gid, seqno)). Only history written
+         * with "gcache.recover" set can be recovered.
          */
         GCache (gu::Config& cfg, const std::string& data_dir);
 
@@ -57,6 +59,16 @@ namespace gcache
          */
         void  seqno_reset (/*int64_t seqno*/);
 
+        /*!
+         * Reinitialize seqno sequence to continue from state gid:seqno.
+         * If current history belongs to gid and covers seqno, it is kept
+         * and only seqnos above seqno are discarded. Otherwise history is
+         * cleared like in seqno_reset() above.
+         *
+         * @return true if history was kept
+         */
+        bool  seqno_reset (const gu_uuid_t& gid, int64_t seqno);
+
         /*!
          * Assign sequence number to buffer pointed to by ptr
          */
@@ -76,7 +88,7 @@ namespace gcache
         {
             gu::Lock lock(mtx);
             if (gu_likely(!seqno2ptr.empty()))
-                return seqno2ptr.begin()->first;
+                return seqno2ptr.index_front();
             else
                 return -1;
         }
@@ -185,10 +197,14 @@ namespace gcache
             ssize_t rb_size()             const { return rb_size_;         }
             ssize_t page_size()           const { return page_size_;       }
             ssize_t keep_pages_size()     const { return keep_pages_size_; }
+            ssize_t page_prealloc()       const { return page_prealloc_;   }
+            bool    recover()             const { return recover_;         }
+            bool    lazy_prealloc()       const { return lazy_prealloc_;   }
 
             void mem_size        (ssize_t s) { mem_size_        = s; }
             void page_size       (ssize_t s) { page_size_       = s; }
             void keep_pages_size (ssize_t s) { keep_pages_size_ = s; }
+            void page_prealloc   (ssize_t n) { page_prealloc_   = n; }
 
         private:
 
@@ -198,15 +214,15 @@ namespace gcache
             ssize_t     const rb_size_;
             ssize_t           page_size_;
             ssize_t           keep_pages_size_;
+            ssize_t           page_prealloc_;
+            bool        const recover_;
+            bool        const lazy_prealloc_;
         }
             params;
 
         gu::Mutex       mtx;
         gu::Cond        cond;
 
-        typedef std::map<int64_t, const void*>  seqno2ptr_t;
-        typedef seqno2ptr_t::iterator           seqno2ptr_iter_t;
-        typedef std::pair<int64_t, const void*> seqno2ptr_pair_t;
         seqno2ptr_t     seqno2ptr;
 
         MemStore        mem;
@@ -231,6 +247,11 @@ namespace gcache
         /* returns true when successfully discards all seqnos up to s */
         bool discard_seqno (int64_t s);
 
+        /* discards released buffer which has been removed from seqno2ptr */
+        void discard_buffer (BufferHeader* bh);
+
+        void seqno_reset_common();
+
         // disable copying
         GCache (const GCache&);
         GCache& operator = (const GCache&);
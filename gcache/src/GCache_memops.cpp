@@ -11,30 +11,19 @@ namespace gcache
     bool
     GCache::discard_seqno (int64_t seqno)
     {
-        for (seqno2ptr_t::iterator i = seqno2ptr.begin();
-             i != seqno2ptr.end() && i->first <= seqno;)
+        while (!seqno2ptr.empty() && seqno2ptr.index_front() <= seqno)
         {
-            BufferHeader* bh(ptr2BH (i->second));
+            BufferHeader* bh(ptr2BH (seqno2ptr.front()));
 
             if (gu_likely(BH_is_released(bh)))
             {
-                assert (bh->seqno_g == i->first);
+                assert (bh->seqno_g == seqno2ptr.index_front());
                 assert (bh->seqno_g <= seqno);
                 assert (bh->seqno_g <= seqno_released);
 
-                seqno2ptr.erase (i++); // post ++ is significant!
+                seqno2ptr.pop_front();
 
-                bh->seqno_g = SEQNO_ILL; // will never be reused
-
-                switch (bh->store)
-                {
-                case BUFFER_IN_MEM:  mem.discard (bh); break;
-                case BUFFER_IN_RB:   rb.discard  (bh); break;
-                case BUFFER_IN_PAGE: ps.discard  (bh); break;
-                default:
-                    log_fatal << "Corrupt buffer header: " << bh;
-                    abort();
-                }
+                discard_buffer (bh);
             }
             else
             {
@@ -45,6 +34,24 @@ namespace gcache
         return true;
     }
 
+    void
+    GCache::discard_buffer (BufferHeader* const bh)
+    {
+        assert (BH_is_released(bh));
+
+        bh->seqno_g = SEQNO_ILL; // will never be reused
+
+        switch (bh->store)
+        {
+        case BUFFER_IN_MEM:  mem.discard (bh); break;
+        case BUFFER_IN_RB:   rb.discard  (bh); break;
+        case BUFFER_IN_PAGE: ps.discard  (bh); break;
+        default:
+            log_fatal << "Corrupt buffer header: " << bh;
+            abort();
+        }
+    }
+
     void*
     GCache::malloc (ssize_t size)
     {
@@ -7,7 +7,9 @@
 #include "GCache.hpp"
 
 #include <galerautils.hpp>
+#include <gu_uuid.hpp>
 
+#include <algorithm>
 #include <cerrno>
 #include <cassert>
 
@@ -24,6 +26,12 @@ namespace gcache
     {
         gu::Lock lock(mtx);
 
+        seqno_reset_common();
+    }
+
+    void
+    GCache::seqno_reset_common ()
+    {
         seqno_released = SEQNO_NONE;
 
         if (gu_unlikely(seqno2ptr.empty())) return;
@@ -35,6 +43,54 @@ namespace gcache
         seqno2ptr.clear();
     }
 
+    bool
+    GCache::seqno_reset (const gu_uuid_t& gid, int64_t const seqno)
+    {
+        gu::Lock lock(mtx);
+
+        bool keep(gid == rb.gid() && !seqno2ptr.empty() &&
+                  seqno >= seqno2ptr.index_front() && seqno <= seqno_max);
+
+        /* seqnos following the state can be discarded only if released */
+        for (int64_t s(seqno + 1); keep && s < seqno2ptr.index_end(); ++s)
+        {
+            const void* const ptr(seqno2ptr[s]);
+            keep = (!ptr || BH_is_released(ptr2BH(ptr)));
+        }
+
+        if (!keep)
+        {
+            if (!seqno2ptr.empty())
+            {
+                log_info << "Discarding GCache history "
+                         << seqno2ptr.index_front() << '-' << seqno_max
+                         << " of " << rb.gid() << ": it does not lead to "
+                         << gid << ':' << seqno;
+            }
+
+            seqno_reset_common();
+            rb.set_gid(gid);
+
+            return false;
+        }
+
+        while (seqno2ptr.index_back() > seqno)
+        {
+            BufferHeader* const bh(ptr2BH(seqno2ptr.back()));
+
+            seqno2ptr.pop_back();
+            discard_buffer(bh);
+        }
+
+        seqno_max = seqno;
+        if (seqno_released > seqno) seqno_released = seqno;
+
+        log_info << "Keeping GCache history " << seqno2ptr.index_front()
+                 << '-' << seqno_max << " of " << gid;
+
+        return true;
+    }
+
     /*!
      * Assign sequence number to buffer pointed to by ptr
      */
@@ -43,31 +99,39 @@ namespace gcache
                           int64_t     const seqno_g,
                           int64_t     const seqno_d)
     {
-        gu::Lock lock(mtx);
-
         BufferHeader* bh = ptr2BH(ptr);
 
+        /* buffer contents are final and still owned by the caller,
+         * checksum is needed only to recover ring buffer history */
+        if (BUFFER_IN_RB == bh->store && params.recover())
+        {
+            RingBuffer::checksum(bh);
+        }
+
+        gu::Lock lock(mtx);
+
         assert (SEQNO_NONE == bh->seqno_g);
         assert (SEQNO_ILL  == bh->seqno_d);
         assert (!BH_is_released(bh));
 
         if (gu_likely(seqno_g > seqno_max))
         {
-            seqno2ptr.insert (seqno2ptr.end(), seqno2ptr_pair_t(seqno_g, ptr));
+            seqno2ptr.insert (seqno_g, ptr);
             seqno_max = seqno_g;
         }
         else
         {
             // this should never happen. seqnos should be assinged in TO.
-            const std::pair<seqno2ptr_iter_t, bool>& res(
-                seqno2ptr.insert (seqno2ptr_pair_t(seqno_g, ptr)));
+            seqno2ptr_iter_t const p(seqno2ptr.find(seqno_g));
 
-            if (false == res.second)
+            if (p != seqno2ptr.end())
             {
                 gu_throw_fatal <<"Attempt to reuse the same seqno: " << seqno_g
                                <<". New ptr = " << ptr << ", previous ptr = "
-                               << res.first->second;
+                               << *p;
             }
+
+            seqno2ptr.insert (seqno_g, ptr);
         }
 
         bh->seqno_g = seqno_g;
@@ -101,9 +165,10 @@ namespace gcache
 
             assert(seqno >= seqno_released);
 
-            seqno2ptr_iter_t it(seqno2ptr.upper_bound(seqno_released));
-
-            if (gu_unlikely(it == seqno2ptr.end()))
+            /* buffers are accessed by seqno rather than by iterator since
+             * free_common() may trim seqno2ptr at either end */
+            if (gu_unlikely(seqno2ptr.empty() ||
+                            seqno_released >= seqno2ptr.index_back()))
             {
                 /* This means that there are no element with
                  * seqno following seqno_released - and this should not
@@ -124,7 +189,9 @@ namespace gcache
             batch_size += (new_gap >= old_gap) * min_batch_size;
             old_gap = new_gap;
 
-            int64_t const start(it->first - 1);
+            int64_t       s    (std::max(seqno_released + 1,
+                                         seqno2ptr.index_front()));
+            int64_t const start(s - 1);
             int64_t const end  (seqno - start >= 2*batch_size ?
                                 start + batch_size : seqno);
 #if 0
@@ -132,27 +199,28 @@ namespace gcache
                      << " buffers, batch_size: " << batch_size
                      << ", end: " << end;
 #endif
-            for (;(loop = (it != seqno2ptr.end())) && it->first <= end;)
+            for (;(loop = (s < seqno2ptr.index_end())) && s <= end; ++s)
             {
-                assert(it->first != SEQNO_NONE);
-                BufferHeader* const bh(ptr2BH(it->second));
-                assert (bh->seqno_g == it->first);
+                assert(s != SEQNO_NONE);
+                const void* const ptr(seqno2ptr.at(s));
+                if (!ptr) continue; // hole in seqno sequence
+                BufferHeader* const bh(ptr2BH(ptr));
+                assert (bh->seqno_g == s);
 #ifndef NDEBUG
-                if (!(seqno_released + 1 == it->first ||
+                if (!(seqno_released + 1 == s ||
                       seqno_released == SEQNO_NONE))
                 {
                     log_info << "seqno_released: " << seqno_released
-                             << "; it->first: " << it->first
-                             << "; seqno2ptr.begin: " <<seqno2ptr.begin()->first
+                             << "; s: " << s
+                             << "; seqno2ptr.begin: "
+                             << seqno2ptr.index_front()
                              << "\nstart: " << start << "; end: " << end
                              << " batch_size: " << batch_size << "; gap: "
                              << new_gap << "; seqno_max: " << seqno_max;
-                    assert(seqno_released + 1 == it->first ||
+                    assert(seqno_released + 1 == s ||
                            seqno_released == SEQNO_NONE);
                 }
 #endif
-                ++it; /* free_common() below may erase current element,
-                       * so advance iterator before calling free_common()*/
                 if (gu_likely(!BH_is_released(bh))) free_common(bh);
             }
 
@@ -204,7 +272,7 @@ namespace gcache
                 }
                 seqno_locked = seqno_g;
 
-                ptr = p->second;
+                ptr = *p;
             }
             else
             {
@@ -246,12 +314,12 @@ namespace gcache
                 seqno_locked = start;
 
                 do {
-                    assert (p->first == (start + found));
-                    assert (p->second);
-                    v[found].set_ptr(p->second);
+                    assert (seqno2ptr.index(p) == (start + found));
+                    assert (*p);
+                    v[found].set_ptr(*p);
                 }
                 while (++found < max && ++p != seqno2ptr.end() &&
-                       p->first == (start + found));
+                       *p != seqno2ptr.null_value());
                 /* the latter condition ensures seqno continuty, #643 */
             }
         }
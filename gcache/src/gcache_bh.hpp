@@ -15,7 +15,8 @@
 
 namespace gcache
 {
-    static uint32_t const BUFFER_RELEASED  = 1 << 0;
+    static uint16_t const BUFFER_RELEASED  = 1 << 0;
+    static uint16_t const BUFFER_CHECKED   = 1 << 1; /*! payload checksummed */
 
     enum StorageType
     {
@@ -30,8 +31,9 @@ namespace gcache
         int64_t  seqno_d;
         int64_t  size;    /*! total buffer size, including header */
         MemOps*  ctx;
-        uint32_t flags;
-        int32_t  store;
+        uint16_t flags;
+        int16_t  store;
+        uint32_t checksum; /*! CRC32C of payload if BUFFER_CHECKED is set */
     }__attribute__((__packed__));
 
 #define BH_cast(ptr) reinterpret_cast<BufferHeader*>(ptr)
@@ -57,6 +59,7 @@ namespace gcache
         assert(0 == bh->ctx);
         assert(0 == bh->flags);
         assert(0 == bh->store);
+        assert(0 == bh->checksum);
     }
 
     static inline bool
@@ -85,7 +88,8 @@ namespace gcache
            << ", size: "    << bh->size
            << ", ctx: "     << bh->ctx
            << ", flags: "   << bh->flags
-           << ". store: "   << bh->store;
+           << ". store: "   << bh->store
+           << ", checksum: " << bh->checksum;
         return os;
     }
 
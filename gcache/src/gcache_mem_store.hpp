@@ -9,6 +9,7 @@
 
 #include "gcache_memops.hpp"
 #include "gcache_bh.hpp"
+#include "gcache_seqno.hpp"
 
 #include <string>
 #include <set>
@@ -17,9 +18,6 @@ namespace gcache
 {
     class MemStore : public MemOps
     {
-        typedef std::map<int64_t, const void*> seqno2ptr_t;
-        typedef seqno2ptr_t::iterator          seqno2ptr_iter_t;
-
     public:
 
         MemStore (ssize_t max_size, seqno2ptr_t& seqno2ptr)
@@ -60,6 +58,7 @@ namespace gcache
                 bh->seqno_d = SEQNO_ILL;
                 bh->flags   = 0;
                 bh->store   = BUFFER_IN_MEM;
+                bh->checksum = 0;
                 bh->ctx     = this;
 
                 size_ += size;
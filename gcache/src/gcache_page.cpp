@@ -51,6 +51,15 @@ gcache::Page::drop_fs_cache() const
 #endif
 }
 
+void
+gcache::Page::prefault()
+{
+    size_t   const step(gu_page_size());
+    uint8_t* const ptr (static_cast<uint8_t*>(mmap_.ptr));
+
+    for (size_t off(0); off < mmap_.size; off += step) ptr[off] = 0;
+}
+
 gcache::Page::Page (void* ps, const std::string& name, ssize_t size)
     :
     fd_   (name, check_size(size), false, false),
@@ -78,6 +87,7 @@ gcache::Page::malloc (ssize_t size)
         bh->ctx     = this;
         bh->flags   = 0;
         bh->store   = BUFFER_IN_PAGE;
+        bh->checksum = 0;
 
         space_ -= size;
         next_  += size;
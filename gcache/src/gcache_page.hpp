@@ -52,6 +52,10 @@ namespace gcache
         /* Drop filesystem cache on the file */
         void drop_fs_cache() const;
 
+        /* Write to every memory page of the file, so that it is backed by
+         * disk blocks and mapped before use */
+        void prefault();
+
         void* parent() const { return ps_; }
 
     private:
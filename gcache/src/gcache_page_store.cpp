@@ -41,33 +41,95 @@ make_page_name (const std::string& base_name, ssize_t count)
     return os.str();
 }
 
-static void*
-remove_file (void* __restrict__ arg)
+static void
+remove_file (const std::string& file_name)
 {
-    char* const file_name (static_cast<char*>(arg));
+    if (remove (file_name.c_str()))
+    {
+        int err = errno;
 
-    if (NULL != file_name)
+        log_error << "Failed to remove page file '" << file_name << "': "
+                  << gu::to_string(err) << " (" << strerror(err) << ")";
+    }
+    else
     {
-        if (remove (file_name))
-        {
-            int err = errno;
+        log_info << "Deleted page " << file_name;
+    }
+}
 
-            log_error << "Failed to remove page file '" << file_name << "': "
-                      << gu::to_string(err) << " (" << strerror(err) << ")";
-        }
-        else
+void*
+gcache::PageStore::bg_thd_func (void* arg)
+{
+    PageStore* const ps(static_cast<PageStore*>(arg));
+    std::deque<Task> tasks;
+
+    gu::Lock lock(ps->bg_mtx_);
+
+    for (;;)
+    {
+        while (ps->bg_tasks_.empty() && !ps->bg_exit_) lock.wait(ps->bg_cond_);
+
+        if (ps->bg_tasks_.empty()) break; // exit and nothing left to do
+
+        tasks.swap(ps->bg_tasks_); // take the whole batch at once
+
+        ps->bg_mtx_.unlock();
+
+        for (; !tasks.empty(); tasks.pop_front())
         {
-            log_info << "Deleted page " << file_name;
+            Page* const page(tasks.front().page);
+
+            switch (tasks.front().op)
+            {
+            case Task::DROP_CACHE:
+                page->drop_fs_cache();
+                break;
+            case Task::DELETE:
+            {
+                std::string const file_name(page->name());
+                delete page;
+                remove_file (file_name);
+                break;
+            }
+            case Task::PREALLOC:
+            {
+                Page* spare(0);
+
+                try
+                {
+                    spare = new Page(ps, tasks.front().name,
+                                     tasks.front().size);
+                    spare->prefault();
+                }
+                catch (gu::Exception& e)
+                {
+                    log_warn << "Failed to preallocate cache page "
+                             << tasks.front().name << ": " << e.what();
+                }
+
+                ps->bg_mtx_.lock();
+                if (spare) ps->spare_.push_back(spare);
+                ps->spare_pending_--;
+                ps->trim_spares(); // settings could change in the meantime
+                ps->bg_mtx_.unlock();
+                break;
+            }
+            }
         }
 
-        free (file_name);
-    }
-    else
-    {
-        log_error << "Null file name in " << __FUNCTION__;
+        ps->bg_mtx_.lock();
     }
 
-    pthread_exit(NULL);
+    return NULL;
+}
+
+void
+gcache::PageStore::bg_submit (Page* const page, Task::Op const op)
+{
+    gu::Lock lock(bg_mtx_);
+
+    bg_tasks_.push_back(Task(page, op));
+    bg_cond_.signal();
 }
 
 bool
@@ -79,27 +141,11 @@ gcache::PageStore::delete_page ()
 
     pages_.pop_front();
 
-    char* const file_name(strdup(page->name().c_str()));
-
     total_size_ -= page->size();
 
     if (current_ == page) current_ = 0;
 
-    delete page;
-
-#ifdef GCACHE_DETACH_THREAD
-    pthread_t delete_thr_;
-#else
-    if (delete_thr_ != pthread_t(-1)) pthread_join (delete_thr_, NULL);
-#endif /* GCACHE_DETACH_THERAD */
-
-    int err = pthread_create (&delete_thr_, &delete_page_attr_, remove_file,
-                              file_name);
-    if (0 != err)
-    {
-        delete_thr_ = pthread_t(-1);
-        gu_throw_error(err) << "Failed to create page file deletion thread";
-    }
+    bg_submit (page, Task::DELETE);
 
     return true;
 }
@@ -122,53 +168,153 @@ gcache::PageStore::reset ()
     while (pages_.size() > 0 && delete_page()) {};
 }
 
+static inline bool
+page_fits (const gcache::Page* const page, ssize_t const size)
+{
+    /* Page::size() does not include the last buffer header */
+    return (page->size() + ssize_t(sizeof(gcache::BufferHeader)) >= size);
+}
+
+void
+gcache::PageStore::trim_spares ()
+{
+    /* cancel preallocations which have not started yet */
+    for (std::deque<Task>::iterator t(bg_tasks_.begin());
+         t != bg_tasks_.end();)
+    {
+        if (Task::PREALLOC == t->op &&
+            (t->size < page_size_ ||
+             ssize_t(spare_.size()) + spare_pending_ > prealloc_))
+        {
+            t = bg_tasks_.erase(t);
+            spare_pending_--;
+        }
+        else ++t;
+    }
+
+    for (std::deque<Page*>::iterator s(spare_.begin()); s != spare_.end();)
+    {
+        if (!page_fits(*s, page_size_) ||
+            ssize_t(spare_.size()) + spare_pending_ > prealloc_)
+        {
+            bg_tasks_.push_back(Task(*s, Task::DELETE));
+            bg_cond_.signal();
+            s = spare_.erase(s);
+        }
+        else ++s;
+    }
+}
+
+gcache::Page*
+gcache::PageStore::take_spare (ssize_t const size)
+{
+    gu::Lock lock(bg_mtx_);
+
+    trim_spares(); // pages of the old size would block the queue forever
+
+    if (spare_.empty() || !page_fits(spare_.front(), size)) return 0;
+
+    Page* const page(spare_.front());
+    spare_.pop_front();
+
+    return page;
+}
+
+void
+gcache::PageStore::prealloc ()
+{
+    gu::Lock lock(bg_mtx_);
+
+    trim_spares();
+
+    while (ssize_t(spare_.size()) + spare_pending_ < prealloc_)
+    {
+        bg_tasks_.push_back(Task(make_page_name (base_name_, count_),
+                                 page_size_));
+        spare_pending_++;
+        count_++;
+        bg_cond_.signal();
+    }
+}
+
+void
+gcache::PageStore::set_page_size (ssize_t const size)
+{
+    {
+        gu::Lock lock(bg_mtx_);
+        page_size_ = size;
+        trim_spares();
+    }
+
+    if (0 != current_) prealloc(); // replace dropped spares
+}
+
+void
+gcache::PageStore::set_prealloc (ssize_t const num)
+{
+    {
+        gu::Lock lock(bg_mtx_);
+        prealloc_ = num;
+        trim_spares();
+    }
+
+    if (0 != current_) prealloc();
+}
+
+ssize_t
+gcache::PageStore::spare_count () const
+{
+    gu::Lock lock(bg_mtx_);
+    return spare_.size();
+}
+
 inline void
 gcache::PageStore::new_page (ssize_t size)
 {
-    Page* const page(new Page(this, make_page_name (base_name_, count_), size));
+    Page* page(take_spare (size));
+
+    if (0 == page)
+    {
+        page = new Page(this, make_page_name (base_name_, count_), size);
+        count_++;
+    }
 
     pages_.push_back (page);
-    total_size_ += size;
+    total_size_ += page->size();
     current_ = page;
-    count_++;
+
+    prealloc();
 }
 
 gcache::PageStore::PageStore (const std::string& dir_name,
                               ssize_t            keep_size,
                               ssize_t            page_size,
+                              ssize_t            prealloc,
                               bool               keep_page)
     :
     base_name_ (make_base_name(dir_name)),
     keep_size_ (keep_size),
     page_size_ (page_size),
+    prealloc_  (prealloc),
     keep_page_ (keep_page),
     count_     (0),
     pages_     (),
     current_   (0),
     total_size_(0),
-    delete_page_attr_()
-#ifndef GCACHE_DETACH_THREAD
-    , delete_thr_(pthread_t(-1))
-#endif /* GCACHE_DETACH_THREAD */
+    bg_mtx_    (),
+    bg_cond_   (),
+    bg_tasks_  (),
+    bg_thr_    (),
+    bg_exit_   (false),
+    spare_     (),
+    spare_pending_(0)
 {
-    int err = pthread_attr_init (&delete_page_attr_);
-
-    if (0 != err)
-    {
-        gu_throw_error(err) << "Failed to initialize page file deletion "
-                            << "thread attributes";
-    }
+    int const err(gu_thread_create (&bg_thr_, NULL, bg_thd_func, this));
 
-#ifdef GCACHE_DETACH_THREAD
-    err = pthread_attr_setdetachstate (&delete_page_attr_,
-                                       PTHREAD_CREATE_DETACHED);
     if (0 != err)
     {
-        pthread_attr_destroy (&delete_page_attr_);
-        gu_throw_error(err) << "Failed to set DETACHED attribute to "
-                            << "page file deletion thread";
+        gu_throw_error(err) << "Failed to create page store thread";
     }
-#endif /* GCACHE_DETACH_THREAD */
 }
 
 gcache::PageStore::~PageStore ()
@@ -176,9 +322,6 @@ gcache::PageStore::~PageStore ()
     try
     {
         while (pages_.size() && delete_page()) {};
-#ifndef GCACHE_DETACH_THREAD
-        if (delete_thr_ != pthread_t(-1)) pthread_join (delete_thr_, NULL);
-#endif /* GCACHE_DETACH_THREAD */
     }
     catch (gu::Exception& e)
     {
@@ -191,7 +334,33 @@ gcache::PageStore::~PageStore ()
                   << " page files: some buffers are still \"mmapped\".";
     }
 
-    pthread_attr_destroy (&delete_page_attr_);
+    {
+        gu::Lock lock(bg_mtx_);
+
+        /* no point in creating more spare pages */
+        for (std::deque<Task>::iterator t(bg_tasks_.begin());
+             t != bg_tasks_.end();)
+        {
+            if (Task::PREALLOC == t->op)
+            {
+                t = bg_tasks_.erase(t);
+                spare_pending_--;
+            }
+            else ++t;
+        }
+
+        bg_exit_ = true;
+        bg_cond_.signal();
+    }
+
+    gu_thread_join (bg_thr_, NULL); // completes pending tasks
+
+    for (; !spare_.empty(); spare_.pop_front())
+    {
+        std::string const file_name(spare_.front()->name());
+        delete spare_.front();
+        remove_file (file_name);
+    }
 }
 
 inline void*
@@ -224,7 +393,7 @@ gcache::PageStore::malloc (ssize_t size)
 
         if (gu_likely(0 != ret)) return ret;
 
-        current_->drop_fs_cache();
+        bg_submit (current_, Task::DROP_CACHE);
     }
 
     return malloc_new (size);
@@ -15,6 +15,14 @@
 
 namespace gcache
 {
+    /*!
+     * Page files are unmapped, removed and have their filesystem cache
+     * dropped by a background thread, so that these slow operations never
+     * happen under GCache lock. Once the store is in use, the same thread
+     * keeps a number of spare pages created and prefaulted ahead of demand.
+     * Spare pages left smaller than the page size or in excess of the
+     * preallocation count by a parameter change are deleted the same way.
+     */
     class PageStore : public MemOps
     {
     public:
@@ -22,6 +30,7 @@ namespace gcache
         PageStore (const std::string& dir_name,
                    ssize_t            keep_size,
                    ssize_t            page_size,
+                   ssize_t            prealloc,
                    bool               keep_page);
 
         ~PageStore ();
@@ -48,27 +57,71 @@ namespace gcache
 
         ssize_t count() const { return count_; } // for unit tests
 
-        void  set_page_size (ssize_t size) { page_size_ = size; }
+        void  set_page_size (ssize_t size);
 
         void  set_keep_size (ssize_t size) { keep_size_ = size; }
 
+        void  set_prealloc  (ssize_t num);
+
+        ssize_t spare_count () const; // for unit tests
+
     private:
 
+        /* page maintenance deferred to background thread */
+        struct Task
+        {
+            enum Op
+            {
+                DROP_CACHE,
+                DELETE,
+                PREALLOC
+            };
+
+            Task(Page* p, Op o) : page(p), op(o), name(), size(0) {}
+
+            Task(const std::string& n, ssize_t s)
+                : page(0), op(PREALLOC), name(n), size(s) {}
+
+            Page*       page;
+            Op          op;
+            std::string name; // PREALLOC only
+            ssize_t     size; // PREALLOC only
+        };
+
         std::string const base_name_; /* /.../.../gcache.page. */
         ssize_t           keep_size_; /* how much pages to keep after freeing*/
         ssize_t           page_size_; /* min size of the individual page */
+        ssize_t           prealloc_;  /* how many spare pages to keep ready */
         bool        const keep_page_; /* whether to keep the last page */
         ssize_t           count_;
         std::deque<Page*> pages_;
         Page*             current_;
         ssize_t           total_size_;
-        pthread_attr_t    delete_page_attr_;
-#ifndef GCACHE_DETACH_THREAD
-        pthread_t         delete_thr_;
-#endif /* GCACHE_DETACH_THREAD */
+
+        gu::Mutex         bg_mtx_;
+        gu::Cond          bg_cond_;
+        std::deque<Task>  bg_tasks_;
+        pthread_t         bg_thr_;
+        bool              bg_exit_;
+        std::deque<Page*> spare_;     /* prefaulted pages ready for use */
+        ssize_t           spare_pending_; /* PREALLOC tasks submitted */
+
+        static void* bg_thd_func (void* arg);
+
+        void bg_submit   (Page* page, Task::Op op);
 
         void new_page    (ssize_t size);
 
+        // takes a spare page of at least size bytes if there is one
+        Page* take_spare (ssize_t size);
+
+        // submits PREALLOC tasks to have prealloc_ spare pages
+        void prealloc    ();
+
+        // drops spare pages smaller than page_size_ or in excess of
+        // prealloc_, must be called under bg_mtx_
+        void trim_spares ();
+
         // returns true if a page could be deleted
         bool delete_page ();
 
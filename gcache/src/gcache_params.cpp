@@ -16,6 +16,12 @@ static const std::string GCACHE_PARAMS_PAGE_SIZE  ("gcache.page_size");
 static const std::string GCACHE_DEFAULT_PAGE_SIZE (GCACHE_DEFAULT_RB_SIZE);
 static const std::string GCACHE_PARAMS_KEEP_PAGES_SIZE("gcache.keep_pages_size");
 static const std::string GCACHE_DEFAULT_KEEP_PAGES_SIZE("0");
+static const std::string GCACHE_PARAMS_PAGE_PREALLOC("gcache.page_prealloc");
+static const std::string GCACHE_DEFAULT_PAGE_PREALLOC("1");
+static const std::string GCACHE_PARAMS_RECOVER    ("gcache.recover");
+static const std::string GCACHE_DEFAULT_RECOVER   ("no");
+static const std::string GCACHE_PARAMS_LAZY_PREALLOC ("gcache.lazy_prealloc");
+static const std::string GCACHE_DEFAULT_LAZY_PREALLOC("no");
 
 void
 gcache::GCache::Params::register_params(gu::Config& cfg)
@@ -26,6 +32,9 @@ gcache::GCache::Params::register_params(gu::Config& cfg)
     cfg.add(GCACHE_PARAMS_RB_SIZE,         GCACHE_DEFAULT_RB_SIZE);
     cfg.add(GCACHE_PARAMS_PAGE_SIZE,       GCACHE_DEFAULT_PAGE_SIZE);
     cfg.add(GCACHE_PARAMS_KEEP_PAGES_SIZE, GCACHE_DEFAULT_KEEP_PAGES_SIZE);
+    cfg.add(GCACHE_PARAMS_PAGE_PREALLOC,   GCACHE_DEFAULT_PAGE_PREALLOC);
+    cfg.add(GCACHE_PARAMS_RECOVER,         GCACHE_DEFAULT_RECOVER);
+    cfg.add(GCACHE_PARAMS_LAZY_PREALLOC,   GCACHE_DEFAULT_LAZY_PREALLOC);
 }
 
 static const std::string&
@@ -60,7 +69,10 @@ gcache::GCache::Params::Params (gu::Config& cfg, const std::string& data_dir)
     mem_size_ (cfg.get<ssize_t>(GCACHE_PARAMS_MEM_SIZE)),
     rb_size_  (cfg.get<ssize_t>(GCACHE_PARAMS_RB_SIZE)),
     page_size_(cfg.get<ssize_t>(GCACHE_PARAMS_PAGE_SIZE)),
-    keep_pages_size_(cfg.get<ssize_t>(GCACHE_PARAMS_KEEP_PAGES_SIZE))
+    keep_pages_size_(cfg.get<ssize_t>(GCACHE_PARAMS_KEEP_PAGES_SIZE)),
+    page_prealloc_(cfg.get<ssize_t>(GCACHE_PARAMS_PAGE_PREALLOC)),
+    recover_  (cfg.get<bool>(GCACHE_PARAMS_RECOVER)),
+    lazy_prealloc_(cfg.get<bool>(GCACHE_PARAMS_LAZY_PREALLOC))
 {}
 
 void
@@ -93,6 +105,14 @@ gcache::GCache::param_set (const std::string& key, const std::string& val)
     {
         gu_throw_error(EPERM) << "Can't change ring buffer size in runtime.";
     }
+    else if (key == GCACHE_PARAMS_RECOVER)
+    {
+        gu_throw_error(EPERM) << "Recovery happens only on startup.";
+    }
+    else if (key == GCACHE_PARAMS_LAZY_PREALLOC)
+    {
+        gu_throw_error(EPERM) << "Ring buffer is allocated only on startup.";
+    }
     else if (key == GCACHE_PARAMS_PAGE_SIZE)
     {
         ssize_t tmp_size = gu::Config::from_config<ssize_t>(val);
@@ -123,6 +143,19 @@ gcache::GCache::param_set (const std::string& key, const std::string& val)
         params.keep_pages_size(tmp_size);
         ps.set_keep_size(params.keep_pages_size());
     }
+    else if (key == GCACHE_PARAMS_PAGE_PREALLOC)
+    {
+        ssize_t tmp_num = gu::Config::from_config<ssize_t>(val);
+
+        if (tmp_num < 0)
+            gu_throw_error(EINVAL) << "Negative number of preallocated pages";
+
+        gu::Lock lock(mtx);
+
+        config.set<ssize_t>(key, tmp_num);
+        params.page_prealloc(tmp_num);
+        ps.set_prealloc(params.page_prealloc());
+    }
     else
     {
         throw gu::NotFound();
@@ -7,7 +7,13 @@
 #include "gcache_mem_store.hpp"
 
 #include <galerautils.hpp>
+#include <gu_uuid.hpp>
+
+#include <algorithm>
 #include <cassert>
+#include <map>
+#include <sstream>
+#include <vector>
 
 namespace gcache
 {
@@ -30,17 +36,26 @@ namespace gcache
         size_used_ = 0;
         size_trail_= 0;
 
+        write_offsets();
+
 //        mallocs_  = 0;
 //        reallocs_ = 0;
     }
 
+    int64_t const RingBuffer::VERSION = 2;
+
     void
-    RingBuffer::constructor_common() {}
+    RingBuffer::constructor_common()
+    {
+        GU_COMPILE_ASSERT(HDR_MAX <= HEADER_LEN, header_too_long);
+    }
 
     RingBuffer::RingBuffer (const std::string& name, ssize_t size,
-                            std::map<int64_t, const void*> & seqno2ptr)
+                            seqno2ptr_t& seqno2ptr,
+                            bool const recover_buffers,
+                            bool const lazy)
     :
-        fd_        (name, check_size(size)),
+        fd_        (name, check_size(size), !lazy),
         mmap_      (fd_),
         open_      (true),
         preamble_  (static_cast<char*>(mmap_.ptr)),
@@ -55,32 +70,331 @@ namespace gcache
         size_trail_(0),
 //        mallocs_   (0),
 //        reallocs_  (0),
-        seqno2ptr_ (seqno2ptr)
+        seqno2ptr_ (seqno2ptr),
+        prefault_mtx_ (),
+        prefault_thr_ (),
+        prefault_     (false),
+        prefault_exit_(false)
     {
         constructor_common ();
-        BH_clear (BH_cast(next_));
+
+        if (!recover_buffers || !recover())
+        {
+            reset();
+            set_gid(GU_UUID_NIL);
+        }
+
+        header_[HDR_VERSION] = VERSION;
+        header_[HDR_SIZE]    = size_cache_;
+        header_[HDR_SYNCED]  = false;
+        write_preamble(false);
+
+        /* if we crash, the file must not look like it was closed cleanly */
+        mmap_.sync(preamble_, pad_size());
+
+        if (lazy)
+        {
+            int const err(gu_thread_create (&prefault_thr_, NULL,
+                                            prefault_thd_func, this));
+            if (0 != err)
+            {
+                log_warn << "Failed to start ring buffer prefault thread: "
+                         << err << " (" << strerror(err) << ')';
+            }
+
+            prefault_ = (0 == err);
+        }
     }
 
     RingBuffer::~RingBuffer ()
     {
+        if (prefault_)
+        {
+            {
+                gu::Lock lock(prefault_mtx_);
+                prefault_exit_ = true;
+            }
+
+            gu_thread_join (prefault_thr_, NULL);
+        }
+
         open_ = false;
+        write_offsets();
+        header_[HDR_SYNCED] = true;
+        write_preamble(true);
         mmap_.sync();
         mmap_.unmap();
     }
 
+    /* Allocates and maps the pages of a sparse file in the background, in
+     * the order the ring buffer is going to use them. This does not change
+     * the file contents, so it runs concurrently with normal operation. */
+    void*
+    RingBuffer::prefault_thd_func (void* arg)
+    {
+        RingBuffer* const rb(static_cast<RingBuffer*>(arg));
+
+        static size_t const chunk(1 << 26); // check for exit every 64M
+
+        uint8_t* const ptr (static_cast<uint8_t*>(rb->mmap_.ptr));
+        size_t   const size(rb->mmap_.size);
+
+        log_info << "Prefaulting " << size << " bytes of " << rb->fd_.name()
+                 << " in background";
+
+        for (size_t off(0); off < size; off += chunk)
+        {
+            {
+                gu::Lock lock(rb->prefault_mtx_);
+                if (rb->prefault_exit_) return NULL;
+            }
+
+            try
+            {
+                rb->mmap_.prefault(ptr + off, std::min(chunk, size - off));
+            }
+            catch (gu::Exception& e)
+            {
+                log_warn << "Ring buffer prefault stopped at offset " << off
+                         << ": " << e.what();
+                return NULL;
+            }
+        }
+
+        log_info << "Finished prefaulting " << rb->fd_.name();
+
+        return NULL;
+    }
+
+    void
+    RingBuffer::set_gid (const gu_uuid_t& gid)
+    {
+        ::memcpy(header_ + HDR_GID, &gid, sizeof(gid));
+    }
+
+    void
+    RingBuffer::write_preamble (bool const synced)
+    {
+        std::ostringstream os;
+
+        os << "* GCache ring buffer *"
+           << "\nversion: " << header_[HDR_VERSION]
+           << "\ngid: "     << gid()
+           << "\nsize: "    << header_[HDR_SIZE]
+           << "\nfirst: "   << header_[HDR_FIRST]
+           << "\nnext: "    << header_[HDR_NEXT]
+           << "\nsynced: "  << synced
+           << '\n';
+
+        std::string const str(os.str());
+        size_t const len(std::min<size_t>(str.length(), PREAMBLE_LEN - 1));
+
+        ::memcpy(preamble_, str.data(), len);
+        ::memset(preamble_ + len, 0, PREAMBLE_LEN - len);
+    }
+
+    static inline bool
+    BH_recoverable (const BufferHeader* const bh)
+    {
+        return (bh->size  >= ssize_t(sizeof(BufferHeader)) &&
+                bh->store == BUFFER_IN_RB                  &&
+                (bh->flags & ~(BUFFER_RELEASED | BUFFER_CHECKED)) == 0 &&
+                bh->seqno_g >= SEQNO_ILL);
+    }
+
+    /* seqno'd buffer contents are checksummed in GCache::seqno_assign()
+     * if gcache.recover is set */
+    static inline bool
+    BH_payload_valid (const BufferHeader* const bh)
+    {
+        return ((bh->flags & BUFFER_CHECKED) &&
+                bh->checksum == gu::CRC32C::digest(
+                    bh + 1, bh->size - sizeof(BufferHeader)));
+    }
+
+    bool
+    RingBuffer::recover ()
+    {
+        if (header_[HDR_VERSION] != VERSION)
+        {
+            log_info << "GCache ring buffer '" << fd_.name()
+                     << "' has no recoverable history.";
+            return false;
+        }
+
+        ssize_t const first(header_[HDR_FIRST]);
+        ssize_t const next (header_[HDR_NEXT]);
+
+        if (header_[HDR_SIZE] != size_cache_ ||
+            first < 0 || first > size_cache_ ||
+            next  < 0 || next  > size_cache_)
+        {
+            log_warn << "GCache ring buffer header is inconsistent or cache "
+                     << "size has changed, can't recover history.";
+            return false;
+        }
+
+        if (!header_[HDR_SYNCED])
+        {
+            log_warn << "GCache ring buffer was not closed cleanly, "
+                     << "validating buffer chain.";
+        }
+
+        uint8_t* const first_ptr(start_ + first);
+        uint8_t* const next_ptr (start_ + next);
+
+        /* First pass: walk buffer chain from first_ to next_ and validate
+         * every header without modifying anything. Seqno'd buffers with
+         * corrupt or unchecked payload are mapped to NULL. */
+        std::vector<BufferHeader*>      chain;
+        std::map<int64_t, BufferHeader*> seqnos;
+        long                            corrupt(0);
+        long                            unchecked(0);
+
+        uint8_t* trail(0);            // rollover mark if chain is wrapped
+        uint8_t* limit(first_ptr > next_ptr ? end_ : next_ptr);
+        uint8_t* ptr  (first_ptr);
+
+        while (ptr != next_ptr)
+        {
+            BufferHeader* const bh(BH_cast(ptr));
+
+            if (0 == bh->size && 0 == trail && end_ == limit)
+            {
+                /* rollover */
+                trail = ptr;
+                limit = next_ptr;
+                ptr   = start_;
+                continue;
+            }
+
+            if (!BH_recoverable(bh) ||
+                limit - ptr < bh->size ||
+                end_ - (ptr + bh->size) < ssize_t(sizeof(BufferHeader)))
+            {
+                log_warn << "Corrupt buffer header at offset "
+                         << (ptr - start_) << ": " << bh
+                         << ". Can't recover GCache history.";
+                return false;
+            }
+
+            if (bh->seqno_g > 0)
+            {
+                BufferHeader* const valid(BH_payload_valid(bh) ? bh : 0);
+
+                if (!seqnos.insert(std::make_pair(bh->seqno_g, valid)).second)
+                {
+                    log_warn << "Duplicate seqno " << bh->seqno_g
+                             << " in GCache ring buffer. "
+                             << "Can't recover history.";
+                    return false;
+                }
+
+                if (!(bh->flags & BUFFER_CHECKED)) ++unchecked;
+                else if (!valid)                    ++corrupt;
+            }
+
+            chain.push_back(bh);
+            ptr += bh->size;
+        }
+
+        if (first_ptr > next_ptr && 0 == trail)
+        {
+            log_warn << "Missing rollover mark in GCache ring buffer. "
+                     << "Can't recover history.";
+            return false;
+        }
+
+        if (corrupt > 0)
+        {
+            log_warn << corrupt << " buffers in GCache ring buffer failed "
+                     << "payload checksum verification.";
+        }
+
+        if (unchecked > 0)
+        {
+            log_info << unchecked << " buffers in GCache ring buffer were "
+                     << "written without gcache.recover and can't be "
+                     << "recovered.";
+        }
+
+        if (seqnos.empty()) return false;
+
+        /* Second pass: keep only the longest continuous range of valid
+         * seqnos ending with the highest seqno, the rest is discarded. */
+        int64_t const seqno_max(seqnos.rbegin()->first);
+        int64_t       seqno_min(seqno_max);
+
+        for (std::map<int64_t, BufferHeader*>::reverse_iterator
+                 r(seqnos.rbegin()); r != seqnos.rend() &&
+                 r->first == seqno_min && r->second; ++r)
+        {
+            --seqno_min;
+        }
+        ++seqno_min;
+
+        if (seqno_min > seqno_max)
+        {
+            log_warn << "Last seqno " << seqno_max << " in GCache ring buffer "
+                     << "is corrupt. Can't recover history.";
+            return false;
+        }
+
+        first_      = first_ptr;
+        next_       = next_ptr;
+        size_trail_ = trail ? end_ - trail : 0;
+        size_used_  = 0; // nothing is allocated yet
+
+        if (first_ < next_)
+        {
+            size_free_ = size_cache_ - (next_ - first_);
+        }
+        else
+        {
+            size_free_ = first_ - next_ + size_trail_ - sizeof(BufferHeader);
+        }
+
+        assert(seqno2ptr_.empty());
+
+        for (size_t i(0); i < chain.size(); ++i)
+        {
+            BufferHeader* const bh(chain[i]);
+
+            bh->ctx    = this;
+            bh->flags |= BUFFER_RELEASED; // nobody holds it anymore
+
+            if (bh->seqno_g >= seqno_min)
+            {
+                seqno2ptr_.insert(bh->seqno_g, bh + 1);
+            }
+            else
+            {
+                bh->seqno_g = SEQNO_ILL;
+                discard(bh);
+            }
+        }
+
+        BH_clear(BH_cast(next_));
+        assert_sizes();
+
+        log_info << "Recovered " << seqno2ptr_.size() << '/' << chain.size()
+                 << " buffers from GCache ring buffer: seqnos " << seqno_min
+                 << '-' << seqno_max << ", gid " << gid();
+
+        return true;
+    }
+
     /* discard all seqnos preceeding and including seqno */
     bool
     RingBuffer::discard_seqno (int64_t seqno)
     {
-        for (seqno2ptr_t::iterator i = seqno2ptr_.begin();
-             i != seqno2ptr_.end() && i->first <= seqno;)
+        while (!seqno2ptr_.empty() && seqno2ptr_.index_front() <= seqno)
         {
-            seqno2ptr_t::iterator j(i); ++i;
-            BufferHeader* const bh (ptr2BH (j->second));
+            BufferHeader* const bh (ptr2BH (seqno2ptr_.front()));
 
             if (gu_likely (BH_is_released(bh)))
             {
-                seqno2ptr_.erase (j);
+                seqno2ptr_.pop_front();
                 bh->seqno_g = SEQNO_ILL;  // will never be accessed by seqno
 
                 switch (bh->store)
@@ -155,6 +469,7 @@ namespace gcache
                 // can't free any more space, so no buffer, next_ is unchanged
                 // and revert size_trail_ if it was set above
                 if (next_ >= first_) size_trail_ = 0;
+                write_offsets();
                 assert_sizes();
                 return 0;
             }
@@ -215,11 +530,13 @@ namespace gcache
         bh->seqno_d = SEQNO_ILL;
         bh->flags   = 0;
         bh->store   = BUFFER_IN_RB;
+        bh->checksum = 0;
         bh->ctx     = this;
 
         next_ = ret + size;
         assert (next_ + sizeof(BufferHeader) <= end_);
         BH_clear (BH_cast(next_));
+        write_offsets();
         assert_sizes();
 
         return bh;
@@ -300,6 +617,7 @@ namespace gcache
                 {
                     next_ = adj_ptr;
                     BH_clear (BH_cast(next_));
+                    write_offsets();
                     size_used_ -= adj_size;
                     size_free_ += adj_size;
                     if (next_ < first_) size_trail_ = size_trail_saved;
@@ -332,17 +650,19 @@ namespace gcache
          * end of released buffers chain. */
         BufferHeader* bh(0);
 
-        for (seqno2ptr_t::reverse_iterator r(seqno2ptr_.rbegin());
-             r != seqno2ptr_.rend(); ++r)
+        for (seqno2ptr_iter_t i(seqno2ptr_.end()); i != seqno2ptr_.begin();)
         {
-            BufferHeader* const b(ptr2BH(r->second));
+            const void* const ptr(*--i);
+
+            if (!ptr) continue; // hole in seqno sequence
+
+            BufferHeader* const b(ptr2BH(ptr));
             if (BUFFER_IN_RB == b->store)
             {
 #ifndef NDEBUG
                 if (!BH_is_released(b))
                 {
-                    log_fatal << "Buffer "
-                              << reinterpret_cast<const void*>(r->second)
+                    log_fatal << "Buffer " << ptr
                               << ", seqno_g " << b->seqno_g << ", seqno_d "
                               << b->seqno_d << " is not released.";
                     assert(0);
@@ -420,6 +740,8 @@ namespace gcache
         assert_sizes();
         assert(size_free_ < size_cache_);
 
+        write_offsets();
+
         log_info << "GCache DEBUG: RingBuffer::seqno_reset(): discarded "
                  << (size_free_ - old) << " bytes";
 
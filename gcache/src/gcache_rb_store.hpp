@@ -9,12 +9,14 @@
 
 #include "gcache_memops.hpp"
 #include "gcache_bh.hpp"
+#include "gcache_seqno.hpp"
 
+#include "gu_crc.hpp"
 #include "gu_fdesc.hpp"
 #include "gu_mmap.hpp"
+#include "gu_uuid.h"
 
 #include <string>
-#include <map>
 #include <stdint.h>
 
 namespace gcache
@@ -23,8 +25,17 @@ namespace gcache
     {
     public:
 
+        /*!
+         * @param recover if true, buffers left in the existing file by the
+         *        previous run are validated and the longest continuous
+         *        seqno range of them is restored into seqno2ptr
+         * @param lazy    if true, new file is created sparse and its disk
+         *        blocks are allocated and mapped by a background thread
+         */
         RingBuffer (const std::string& name, ssize_t size,
-                    std::map<int64_t, const void*>& seqno2ptr);
+                    seqno2ptr_t& seqno2ptr,
+                    bool recover = false,
+                    bool lazy    = false);
 
         ~RingBuffer ();
 
@@ -48,6 +59,14 @@ namespace gcache
 
         const std::string& rb_name() const { return fd_.name(); }
 
+        /*! group UUID the seqnos in the buffer belong to */
+        const gu_uuid_t& gid() const
+        {
+            return *reinterpret_cast<const gu_uuid_t*>(header_ + HDR_GID);
+        }
+
+        void set_gid (const gu_uuid_t& gid);
+
         void  reset();
 
         void  seqno_reset();
@@ -57,6 +76,16 @@ namespace gcache
 
         void print (std::ostream& os) const;
 
+        /*! stores payload checksum in the header, to be verified on recovery.
+         *  Payload must not change after this call. */
+        static void checksum (BufferHeader* const bh)
+        {
+            assert(BUFFER_IN_RB == bh->store);
+            bh->checksum = gu::CRC32C::digest(bh + 1,
+                                              bh->size - sizeof(BufferHeader));
+            bh->flags   |= BUFFER_CHECKED;
+        }
+
         static ssize_t pad_size()
         {
             RingBuffer* rb(0);
@@ -106,6 +135,21 @@ namespace gcache
         static ssize_t const PREAMBLE_LEN = 1024;
         static ssize_t const HEADER_LEN = 32;
 
+        /* header_ layout, offsets are relative to start_ and are kept up to
+         * date while running, so that they survive process crash */
+        enum
+        {
+            HDR_VERSION = 0,
+            HDR_GID,                // 2 words
+            HDR_SIZE = HDR_GID + 2, // size_cache_, detects resized file
+            HDR_FIRST,
+            HDR_NEXT,
+            HDR_SYNCED,             // closed cleanly
+            HDR_MAX
+        };
+
+        static int64_t const VERSION;
+
         gu::FileDescriptor fd_;
         gu::MMap           mmap_;
         bool               open_;
@@ -121,14 +165,31 @@ namespace gcache
         ssize_t            size_used_;
         ssize_t            size_trail_;
 
-        typedef std::map<int64_t, const void*> seqno2ptr_t;
-
         seqno2ptr_t&    seqno2ptr_;
 
+        gu::Mutex       prefault_mtx_;
+        pthread_t       prefault_thr_;
+        bool            prefault_;      // prefault thread is running
+        bool            prefault_exit_;
+
+        static void*    prefault_thd_func (void* arg);
+
         BufferHeader*   get_new_buffer (ssize_t size);
 
         void            constructor_common();
 
+        void write_offsets()
+        {
+            header_[HDR_FIRST] = first_ - start_;
+            header_[HDR_NEXT]  = next_  - start_;
+        }
+
+        void            write_preamble (bool synced);
+
+        /* returns false if buffer chain is inconsistent, then nothing
+         * is modified */
+        bool            recover ();
+
         RingBuffer(const gcache::RingBuffer&);
         RingBuffer& operator=(const gcache::RingBuffer&);
     };
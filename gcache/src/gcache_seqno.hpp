@@ -0,0 +1,22 @@
+/*
+ * Copyright (C) 2014 Codership Oy <info@codership.com>
+ */
+
+/*! @file seqno to buffer map shared by GCache and its stores */
+
+#ifndef _gcache_seqno_hpp_
+#define _gcache_seqno_hpp_
+
+#include "gu_deqmap.hpp"
+
+#include <stdint.h>
+
+namespace gcache
+{
+    /* Seqnos are dense, so a deque indexed by seqno offset gives O(1) lookup
+     * without per-buffer node allocation. Missing seqnos are NULL. */
+    typedef gu::DeqMap<int64_t, const void*> seqno2ptr_t;
+    typedef seqno2ptr_t::iterator            seqno2ptr_iter_t;
+}
+
+#endif /* _gcache_seqno_hpp_ */
@@ -8,6 +8,8 @@
 #include "gcache_bh.hpp"
 #include "gcache_page_test.hpp"
 
+#include <unistd.h> // access(), usleep()
+
 using namespace gcache;
 
 void ps_free (void* ptr)
@@ -24,7 +26,7 @@ START_TEST(test1)
     ssize_t const keep_size = 1;
     ssize_t const page_size = 2 + bh_size;
 
-    gcache::PageStore ps (dir_name, keep_size, page_size, false);
+    gcache::PageStore ps (dir_name, keep_size, page_size, 0, false);
 
     mark_point();
 
@@ -53,7 +55,7 @@ START_TEST(test2)
     ssize_t const keep_size = 1;
     ssize_t page_size = (1 << 20) + bh_size;
 
-    gcache::PageStore ps (dir_name, keep_size, page_size, false);
+    gcache::PageStore ps (dir_name, keep_size, page_size, 0, false);
 
     mark_point();
 
@@ -79,7 +81,7 @@ START_TEST(test3) // check that all page size is efficiently used
     ssize_t const keep_size = 1;
     ssize_t const page_size = 1024;
 
-    gcache::PageStore ps (dir_name, keep_size, page_size, false);
+    gcache::PageStore ps (dir_name, keep_size, page_size, 0, false);
 
     mark_point();
 
@@ -100,6 +102,123 @@ START_TEST(test3) // check that all page size is efficiently used
 }
 END_TEST
 
+START_TEST(test4) // check that released pages are deleted in background
+{
+    const char* const dir_name = "";
+    ssize_t const bh_size = sizeof(gcache::BufferHeader);
+    ssize_t const keep_size = 0;
+    ssize_t const page_size = 1024 + bh_size;
+    int     const pages = 8;
+
+    {
+        gcache::PageStore ps (dir_name, keep_size, page_size, 0, false);
+
+        for (int i(0); i < pages; ++i)
+        {
+            void* const buf(ps.malloc (page_size));
+            fail_if (0 == buf);
+
+            ps_free(buf);
+            ps.discard (ptr2BH(buf));
+        }
+
+        fail_if (ps.count() != pages, "ps.count() = %zd, expected %d",
+                 ps.count(), pages);
+    }
+
+    /* destructor waits for pending deletions */
+    for (int i(0); i < pages; ++i)
+    {
+        std::ostringstream os;
+        os << "gcache.page." << std::setfill('0') << std::setw(6) << i;
+        fail_if (0 == access(os.str().c_str(), F_OK),
+                 "Page file %s was not deleted", os.str().c_str());
+    }
+}
+END_TEST
+
+static void
+wait_spare (const gcache::PageStore& ps, ssize_t const num)
+{
+    for (int i(0); i < 1000 && ps.spare_count() < num; ++i) usleep(10000);
+
+    fail_if (ps.spare_count() != num, "ps.spare_count() = %zd, expected %zd",
+             ps.spare_count(), num);
+}
+
+static void
+wait_deleted (ssize_t const page)
+{
+    std::ostringstream os;
+    os << "gcache.page." << std::setfill('0') << std::setw(6) << page;
+
+    for (int i(0); i < 1000 && 0 == access(os.str().c_str(), F_OK); ++i)
+        usleep(10000);
+
+    fail_if (0 == access(os.str().c_str(), F_OK),
+             "Page file %s was not deleted", os.str().c_str());
+}
+
+START_TEST(test5) // check that spare pages are prepared ahead of demand
+{
+    const char* const dir_name = "";
+    ssize_t const bh_size = sizeof(gcache::BufferHeader);
+    ssize_t const keep_size = 0;
+    ssize_t const page_size = 4096 + bh_size;
+    ssize_t const prealloc = 2;
+
+    gcache::PageStore ps (dir_name, keep_size, page_size, prealloc, false);
+
+    fail_if (ps.spare_count() != 0); // nothing before the store is used
+
+    void* const buf1(ps.malloc (page_size));
+    fail_if (0 == buf1);
+    wait_spare (ps, prealloc);
+    fail_if (ps.count() != 1 + prealloc, "ps.count() = %zd, expected %zd",
+             ps.count(), 1 + prealloc);
+
+    void* const buf2(ps.malloc (page_size)); // goes to a spare page
+    fail_if (0 == buf2);
+    wait_spare (ps, prealloc);
+    fail_if (ps.count() != 2 + prealloc, "ps.count() = %zd, expected %zd",
+             ps.count(), 2 + prealloc);
+
+    void* const buf3(ps.malloc (2 * page_size)); // does not fit in a spare
+    fail_if (0 == buf3);
+    fail_if (ps.count() != 3 + prealloc, "ps.count() = %zd, expected %zd",
+             ps.count(), 3 + prealloc);
+
+    /* spares 2 and 3 are too small for the new page size, replaced */
+    ps.set_page_size (2 * page_size);
+    wait_spare (ps, prealloc);
+    wait_deleted (2);
+    wait_deleted (3);
+    fail_if (ps.count() != 5 + prealloc, "ps.count() = %zd, expected %zd",
+             ps.count(), 5 + prealloc);
+
+    void* const buf4(ps.malloc (2 * page_size)); // goes to a spare page
+    fail_if (0 == buf4);
+    wait_spare (ps, prealloc);
+    fail_if (ps.count() != 6 + prealloc, "ps.count() = %zd, expected %zd",
+             ps.count(), 6 + prealloc);
+
+    /* excess spares 6 and 7 are deleted */
+    ps.set_prealloc (0);
+    fail_if (ps.spare_count() != 0);
+    wait_deleted (6);
+    wait_deleted (7);
+
+    ps_free(buf1);
+    ps.discard (ptr2BH(buf1));
+    ps_free(buf2);
+    ps.discard (ptr2BH(buf2));
+    ps_free(buf3);
+    ps.discard (ptr2BH(buf3));
+    ps_free(buf4);
+    ps.discard (ptr2BH(buf4));
+}
+END_TEST
+
 Suite* gcache_page_suite()
 {
     Suite* s = suite_create("gcache::PageStore");
@@ -109,6 +228,8 @@ Suite* gcache_page_suite()
     tcase_add_test(tc, test1);
     tcase_add_test(tc, test2);
     tcase_add_test(tc, test3);
+    tcase_add_test(tc, test4);
+    tcase_add_test(tc, test5);
     suite_add_tcase(s, tc);
 
     return s;
@@ -8,6 +8,9 @@
 #include "gcache_bh.hpp"
 #include "gcache_rb_test.hpp"
 
+#include <unistd.h> // unlink()
+#include <sys/stat.h>
+
 using namespace gcache;
 
 START_TEST(test1)
@@ -16,7 +19,7 @@ START_TEST(test1)
     ssize_t const bh_size = sizeof(gcache::BufferHeader);
     ssize_t const rb_size (4 + 2*bh_size);
 
-    std::map<int64_t, const void*> s2p;
+    seqno2ptr_t s2p;
     RingBuffer rb(rb_name, rb_size, s2p);
 
     fail_if (rb.size() != rb_size, "Expected %zd, got %zd", rb_size, rb.size());
@@ -83,6 +86,182 @@ START_TEST(test1)
 }
 END_TEST
 
+static void*
+seqno_malloc (RingBuffer& rb, seqno2ptr_t& s2p,
+              int64_t const seqno, ssize_t const size, bool const release)
+{
+    void* const buf(rb.malloc(size + sizeof(BufferHeader)));
+    fail_if (NULL == buf);
+
+    BufferHeader* const bh(ptr2BH(buf));
+    ::memset(buf, seqno, size);
+
+    if (seqno > 0)
+    {
+        RingBuffer::checksum(bh);
+        s2p.insert(seqno, buf);
+    }
+    bh->seqno_g = seqno;
+
+    if (release)
+    {
+        BH_release(bh);
+        rb.free(bh);
+    }
+
+    return buf;
+}
+
+START_TEST(recovery)
+{
+    std::string const rb_name = "rb_recovery_test";
+    ssize_t const rb_size (1 << 16);
+    gu_uuid_t gid;
+    gu_uuid_generate (&gid, NULL, 0);
+
+    ::unlink(rb_name.c_str());
+
+    {
+        seqno2ptr_t s2p;
+        RingBuffer rb(rb_name, rb_size, s2p, true);
+
+        fail_if (!s2p.empty());
+
+        rb.set_gid(gid);
+
+        seqno_malloc(rb, s2p, 1, 100, true);
+        seqno_malloc(rb, s2p, 3, 100, true); // gap
+        seqno_malloc(rb, s2p, 4, 200, true);
+        seqno_malloc(rb, s2p, SEQNO_NONE, 50, false); // unordered, in use
+        seqno_malloc(rb, s2p, 5, 300, false); // still in use
+    }
+
+    {
+        seqno2ptr_t s2p;
+        RingBuffer rb(rb_name, rb_size, s2p, true);
+
+        fail_if (gu_uuid_compare(&rb.gid(), &gid));
+        fail_if (s2p.size() != 3, "Recovered %zu buffers", s2p.size());
+        fail_if (s2p.index_front() != 3);
+        fail_if (s2p.index_back()  != 5);
+
+        for (seqno2ptr_iter_t i(s2p.begin()); i != s2p.end(); ++i)
+        {
+            fail_if (NULL == *i);
+            BufferHeader* const bh(ptr2BH(*i));
+            fail_if (bh->seqno_g != s2p.index(i));
+            fail_if (!BH_is_released(bh));
+            fail_if (bh->ctx != &rb);
+        }
+
+        /* allocation must continue after the recovered buffers */
+        void* const buf(rb.malloc(100 + sizeof(BufferHeader)));
+        fail_if (NULL == buf);
+        fail_if (buf <= s2p.back());
+    }
+
+    {
+        seqno2ptr_t s2p;
+        RingBuffer rb(rb_name, rb_size, s2p, false);
+        fail_if (!s2p.empty());
+    }
+
+    {
+        /* history is lost when not recovering */
+        seqno2ptr_t s2p;
+        RingBuffer rb(rb_name, rb_size, s2p, true);
+        fail_if (!s2p.empty());
+    }
+
+    ::unlink(rb_name.c_str());
+}
+END_TEST
+
+START_TEST(corrupt)
+{
+    std::string const rb_name = "rb_corrupt_test";
+    ssize_t const rb_size (1 << 16);
+
+    ::unlink(rb_name.c_str());
+
+    {
+        seqno2ptr_t s2p;
+        RingBuffer rb(rb_name, rb_size, s2p, true);
+
+        for (int64_t seqno(1); seqno <= 5; ++seqno)
+        {
+            seqno_malloc(rb, s2p, seqno, 100, true);
+        }
+
+        /* payload of seqno 2 is damaged after it was checksummed */
+        static_cast<uint8_t*>(const_cast<void*>(s2p[2]))[50] ^= 1;
+    }
+
+    {
+        seqno2ptr_t s2p;
+        RingBuffer rb(rb_name, rb_size, s2p, true);
+
+        fail_if (s2p.size() != 3, "Recovered %zu buffers", s2p.size());
+        fail_if (s2p.index_front() != 3);
+        fail_if (s2p.index_back()  != 5);
+
+        /* checksums survive recovery, damage the last seqno now */
+        static_cast<uint8_t*>(const_cast<void*>(s2p[5]))[0] ^= 1;
+    }
+
+    {
+        /* no history can be recovered if the last seqno is corrupt */
+        seqno2ptr_t s2p;
+        RingBuffer rb(rb_name, rb_size, s2p, true);
+        fail_if (!s2p.empty());
+    }
+
+    ::unlink(rb_name.c_str());
+}
+END_TEST
+
+START_TEST(lazy)
+{
+    std::string const rb_name = "rb_lazy_test";
+    ssize_t const rb_size (1 << 24);
+
+    ::unlink(rb_name.c_str());
+
+    {
+        seqno2ptr_t s2p;
+        RingBuffer rb(rb_name, rb_size, s2p, false, true);
+
+        struct stat st;
+        fail_if (stat(rb_name.c_str(), &st));
+        fail_if (st.st_size <= rb_size);
+
+        /* buffers can be used while the file is being prefaulted */
+        for (int64_t seqno(1); seqno <= 1000; ++seqno)
+        {
+            void* const buf(seqno_malloc(rb, s2p, seqno, 4096, false));
+            fail_if (*static_cast<uint8_t*>(buf) != uint8_t(seqno));
+        }
+    }
+
+    {
+        /* file contents survive prefaulting */
+        seqno2ptr_t s2p;
+        RingBuffer rb(rb_name, rb_size, s2p, true, true);
+
+        fail_if (s2p.size() != 1000, "Recovered %zu buffers", s2p.size());
+
+        for (seqno2ptr_iter_t i(s2p.begin()); i != s2p.end(); ++i)
+        {
+            const uint8_t* const buf(static_cast<const uint8_t*>(*i));
+            fail_if (buf[0] != uint8_t(s2p.index(i)));
+            fail_if (buf[4095] != uint8_t(s2p.index(i)));
+        }
+    }
+
+    ::unlink(rb_name.c_str());
+}
+END_TEST
+
 Suite* gcache_rb_suite()
 {
     Suite* ts = suite_create("gcache::RbStore");
@@ -90,6 +269,9 @@ Suite* gcache_rb_suite()
 
     tcase_set_timeout(tc, 60);
     tcase_add_test(tc, test1);
+    tcase_add_test(tc, recovery);
+    tcase_add_test(tc, corrupt);
+    tcase_add_test(tc, lazy);
     suite_add_tcase(ts, tc);
 
     return ts;
@@ -128,6 +128,7 @@ struct gcs_conn
     /* A queue for threads waiting for received actions */
     gu_fifo_t*   recv_q;
     ssize_t      recv_q_size;
+    long         recv_waiting; // threads waiting in gcs_recv_batch()
     gu_thread_t  recv_thread;
 
     /* Message receiving timeout - absolute date in nanoseconds */
@@ -1766,46 +1767,62 @@ long gcs_desync (gcs_conn_t* conn, gcs_seqno_t* local)
     }
 }
 
-static inline void
-GCS_FIFO_POP_HEAD (gcs_conn_t* conn, ssize_t size)
-{
-    assert (conn->recv_q_size >= size);
-    conn->recv_q_size -= size;
-    gu_fifo_pop_head (conn->recv_q);
-}
-
-/* Returns when an action from another process is received */
-long gcs_recv (gcs_conn_t*        conn,
-               struct gcs_action* action)
+/* Returns when actions from another process are received */
+long gcs_recv_batch (gcs_conn_t*        conn,
+                     struct gcs_action* actions,
+                     long               max)
 {
     int                  err;
     struct gcs_recv_act* recv_act = NULL;
 
-    assert (action);
+    assert (actions);
+    assert (max > 0);
 
-    if ((recv_act = (struct gcs_recv_act*)gu_fifo_get_head (conn->recv_q, &err)))
+    gu_atomic_fetch_and_add (&conn->recv_waiting, 1);
+    recv_act = (struct gcs_recv_act*)gu_fifo_get_head (conn->recv_q, &err);
+    gu_atomic_fetch_and_sub (&conn->recv_waiting, 1);
+
+    if (recv_act)
     {
+        long n = 0;
+
+        for (;;) {
+            struct gcs_action* const action = &actions[n];
+
+            action->buf     = (void*)recv_act->rcvd.act.buf;
+            action->size    = recv_act->rcvd.act.buf_len;
+            action->type    = recv_act->rcvd.act.type;
+            action->seqno_g = recv_act->rcvd.id;
+            action->seqno_l = recv_act->local_id;
+
+            assert (conn->recv_q_size >= action->size);
+            conn->recv_q_size -= action->size;
+            n++;
+
+            if (gu_unlikely (GCS_ACT_CONF == action->type)) {
+                err = gu_fifo_cancel_gets (conn->recv_q);
+                if (err) {
+                    gu_fatal ("Internal logic error: failed to cancel recv_q "
+                              "\"gets\": %d (%s). Aborting.",
+                              err, strerror(-err));
+                    gu_abort();
+                }
+                break; // nothing is to be received past configuration change
+            }
+
+            /* if other threads are waiting to receive, leave the following
+             * actions to them so that they are processed in parallel */
+            if (n == max || gu_fifo_length (conn->recv_q) < 2 ||
+                gu_atomic_fetch_and_add (&conn->recv_waiting, 0) > 0) break;
+
+            recv_act = (struct gcs_recv_act*)gu_fifo_next_head (conn->recv_q);
+        }
+
         conn->queue_len = gu_fifo_length (conn->recv_q) - 1;
         bool send_cont  = gcs_fc_cont_begin   (conn);
         bool send_sync  = gcs_send_sync_begin (conn);
 
-        action->buf     = (void*)recv_act->rcvd.act.buf;
-        action->size    = recv_act->rcvd.act.buf_len;
-        action->type    = recv_act->rcvd.act.type;
-        action->seqno_g = recv_act->rcvd.id;
-        action->seqno_l = recv_act->local_id;
-
-        if (gu_unlikely (GCS_ACT_CONF == action->type)) {
-            err = gu_fifo_cancel_gets (conn->recv_q);
-            if (err) {
-                gu_fatal ("Internal logic error: failed to cancel recv_q "
-                          "\"gets\": %d (%s). Aborting.",
-                          err, strerror(-err));
-                gu_abort();
-            }
-        }
-
-        GCS_FIFO_POP_HEAD (conn, action->size); // release the queue
+        gu_fifo_pop_head (conn->recv_q); // release the queue
 
         if (gu_unlikely(send_cont) && (err = gcs_fc_cont_end(conn))) {
             // We have successfully received an action, but failed to send
@@ -1831,14 +1848,14 @@ long gcs_recv (gcs_conn_t*        conn,
                      err, strerror(-err));
         }
 
-        return action->size;
+        return n;
     }
     else {
-        action->buf     = NULL;
-        action->size    = 0;
-        action->type    = GCS_ACT_ERROR;
-        action->seqno_g = GCS_SEQNO_ILL;
-        action->seqno_l = GCS_SEQNO_ILL;
+        actions[0].buf     = NULL;
+        actions[0].size    = 0;
+        actions[0].type    = GCS_ACT_ERROR;
+        actions[0].seqno_g = GCS_SEQNO_ILL;
+        actions[0].seqno_l = GCS_SEQNO_ILL;
 
         switch (err) {
         case -ENODATA:
@@ -1850,6 +1867,15 @@ long gcs_recv (gcs_conn_t*        conn,
     }
 }
 
+/* Returns when an action from another process is received */
+long gcs_recv (gcs_conn_t*        conn,
+               struct gcs_action* action)
+{
+    long const ret = gcs_recv_batch (conn, action, 1);
+
+    return (ret > 0 ? action->size : ret);
+}
+
 long
 gcs_resume_recv (gcs_conn_t* conn)
 {
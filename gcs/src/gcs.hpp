@@ -244,6 +244,24 @@ static inline long gcs_repl (gcs_conn_t*        const conn,
 extern long gcs_recv (gcs_conn_t*        conn,
                       struct gcs_action* action);
 
+/*! @brief Receives a run of consecutive actions from group.
+ * Same as gcs_recv(), but takes up to max actions already waiting in the
+ * receive queue at once, saving on queue synchronization. Blocks only if
+ * no actions are available. Configuration change action is always the
+ * last in the run. The run also ends early if other threads are waiting
+ * to receive, so that the rest of the actions can be processed in parallel.
+ *
+ * @param conn    group connection handle
+ * @param actions array of at least max action objects
+ * @param max     maximum number of actions to receive
+ * @return        negative error code, number of actions received in case
+ *                of success
+ * @retval 0      on connection close
+ */
+extern long gcs_recv_batch (gcs_conn_t*        conn,
+                            struct gcs_action* actions,
+                            long               max);
+
 /*!
  * @brief Schedules entry to CGS send monitor.
  * Locks send monitor and should be quickly followed by gcs_repl()/gcs_send()
@@ -0,0 +1,252 @@
+// Copyright (C) 2014 Codership Oy <info@codership.com>
+
+// $Id$
+
+/*
+ * Tests gcs_recv_batch() over a connection to the dummy backend which
+ * delivers every sent action back to the sender.
+ */
+
+#include "gcs_recv_test.hpp"
+#include "../gcs.hpp"
+
+#include <galerautils.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static gu_config_t* Config = NULL;
+static gcs_conn_t*  Conn   = NULL;
+
+/* opens connection and receives actions which precede the first sent one */
+static void
+recv_open (void)
+{
+    struct gcs_action act;
+    long              ret;
+
+    Config = gu_config_create ();
+    fail_if (NULL == Config);
+    fail_if (gcs_register_params (Config));
+
+    Conn = gcs_create (Config, NULL, "recv_test", NULL, 0, 0);
+    fail_if (NULL == Conn);
+
+    ret = gcs_open (Conn, "recv_test", "dummy://", true);
+    fail_if (ret, "gcs_open() failed: %ld (%s)", ret, strerror(-ret));
+
+    ret = gcs_recv (Conn, &act);
+    fail_if (ret <= 0);
+    fail_if (GCS_ACT_CONF != act.type, "expected CONF, got %s",
+             gcs_act_type_to_str(act.type));
+    free ((void*)act.buf);
+    fail_if (gcs_resume_recv (Conn));
+
+    ret = gcs_recv (Conn, &act);
+    fail_if (ret < 0);
+    fail_if (GCS_ACT_SYNC != act.type, "expected SYNC, got %s",
+             gcs_act_type_to_str(act.type));
+    free ((void*)act.buf);
+}
+
+static void
+recv_destroy (void)
+{
+    fail_if (gcs_destroy (Conn));
+    gu_config_destroy (Config);
+    Conn   = NULL;
+    Config = NULL;
+}
+
+/* sends n actions carrying consecutive numbers starting with first */
+static void
+recv_send (long first, long n)
+{
+    long i;
+
+    for (i = first; i < first + n; i++)
+    {
+        long const ret = gcs_send (Conn, &i, sizeof(i), GCS_ACT_TORDERED,
+                                   false);
+        fail_if (ret != sizeof(i), "gcs_send() returned %ld (%s)",
+                 ret, ret < 0 ? strerror(-ret) : "");
+    }
+}
+
+/* waits for n actions to be queued for receiving */
+static void
+recv_wait (long n)
+{
+    struct gcs_stats stats;
+    int              i;
+
+    for (i = 0; i < 1000; i++)
+    {
+        gcs_get_stats (Conn, &stats);
+        if (stats.recv_q_len >= n) return;
+        usleep (1000);
+    }
+
+    fail ("%ld actions were not received in time", n);
+}
+
+/* checks that received actions are consecutive and carry numbers
+ * starting with first */
+static void
+recv_check (const struct gcs_action* acts, long n, long first)
+{
+    long i;
+
+    for (i = 0; i < n; i++)
+    {
+        fail_if (GCS_ACT_TORDERED != acts[i].type);
+        fail_if (sizeof(long) != acts[i].size);
+        fail_if (*(const long*)acts[i].buf != first + i,
+                 "expected action %ld, got %ld",
+                 first + i, *(const long*)acts[i].buf);
+        fail_if (i > 0 && acts[i].seqno_l != acts[i - 1].seqno_l + 1);
+        fail_if (i > 0 && acts[i].seqno_g != acts[i - 1].seqno_g + 1);
+        free ((void*)acts[i].buf);
+    }
+}
+
+START_TEST (gcs_recv_batch_test)
+{
+    struct gcs_action acts[4];
+    long              ret;
+
+    recv_open();
+
+    /* no more than max actions in a batch */
+    recv_send (0, 5);
+    recv_wait (5);
+
+    ret = gcs_recv_batch (Conn, acts, 3);
+    fail_if (3 != ret, "expected 3 actions, got %ld", ret);
+    recv_check (acts, ret, 0);
+
+    ret = gcs_recv_batch (Conn, acts, 3);
+    fail_if (2 != ret, "expected 2 actions, got %ld", ret);
+    recv_check (acts, ret, 3);
+
+    /* no more than already queued actions in a batch */
+    recv_send (5, 1);
+
+    ret = gcs_recv_batch (Conn, acts, 4);
+    fail_if (1 != ret, "expected 1 action, got %ld", ret);
+    recv_check (acts, ret, 5);
+
+    /* configuration change ends the batch */
+    recv_send (6, 2);
+    recv_wait (2);
+    fail_if (gcs_close (Conn));
+
+    ret = gcs_recv_batch (Conn, acts, 4);
+    fail_if (3 != ret, "expected 3 actions, got %ld", ret);
+    fail_if (GCS_ACT_CONF != acts[2].type);
+    free ((void*)acts[2].buf);
+    recv_check (acts, 2, 6);
+
+    recv_destroy();
+}
+END_TEST
+
+#define RECV_THREADS 4
+#define RECV_ACTIONS 4096
+
+static long RecvActions = 0; // actions received by all threads
+
+static void*
+recv_thread (void* arg)
+{
+    gcs_seqno_t* const seqnos = (gcs_seqno_t*)arg; // local seqno of each action
+    struct gcs_action  acts[8];
+    long               ret;
+
+    while ((ret = gcs_recv_batch (Conn, acts, 8)) > 0)
+    {
+        long i;
+
+        for (i = 0; i < ret; i++)
+        {
+            if (GCS_ACT_TORDERED == acts[i].type)
+            {
+                long const n = *(const long*)acts[i].buf;
+
+                fail_if (n < 0 || n >= RECV_ACTIONS);
+                fail_if (i > 0 && acts[i].seqno_l != acts[i - 1].seqno_l + 1);
+                seqnos[n] = acts[i].seqno_l;
+                gu_atomic_fetch_and_add (&RecvActions, 1);
+            }
+            else
+            {
+                fail_if (GCS_ACT_CONF != acts[i].type);
+                fail_if (i != ret - 1, "CONF is not the last in the batch");
+            }
+
+            free ((void*)acts[i].buf);
+        }
+    }
+
+    return NULL;
+}
+
+/* concurrent receivers get every action exactly once */
+START_TEST (gcs_recv_batch_threads_test)
+{
+    gcs_seqno_t* seqnos;
+    pthread_t    threads[RECV_THREADS];
+    long         i;
+
+    seqnos = (gcs_seqno_t*)calloc (RECV_ACTIONS, sizeof(gcs_seqno_t));
+    fail_if (NULL == seqnos);
+
+    recv_open();
+
+    for (i = 0; i < RECV_THREADS; i++)
+    {
+        fail_if (pthread_create (&threads[i], NULL, recv_thread, seqnos));
+    }
+
+    recv_send (0, RECV_ACTIONS);
+
+    for (i = 0; i < 1000 &&
+             gu_atomic_fetch_and_add (&RecvActions, 0) < RECV_ACTIONS; i++)
+    {
+        usleep (1000);
+    }
+
+    fail_if (RECV_ACTIONS != RecvActions, "expected %d actions, received %ld",
+             RECV_ACTIONS, RecvActions);
+
+    /* leaving configuration change is the last action to be received,
+     * after that receiving is canceled and threads return */
+    fail_if (gcs_close (Conn));
+
+    for (i = 0; i < RECV_THREADS; i++) pthread_join (threads[i], NULL);
+
+    recv_destroy();
+
+    /* every action was received once and in total order */
+    for (i = 1; i < RECV_ACTIONS; i++)
+    {
+        fail_if (seqnos[i] != seqnos[i - 1] + 1,
+                 "action %ld: seqno_l %lld, previous %lld", i,
+                 (long long)seqnos[i], (long long)seqnos[i - 1]);
+    }
+
+    free (seqnos);
+}
+END_TEST
+
+Suite *gcs_recv_suite(void)
+{
+  Suite *suite = suite_create("GCS receiving");
+  TCase *tcase = tcase_create("gcs_recv");
+
+  suite_add_tcase (suite, tcase);
+  tcase_add_test  (tcase, gcs_recv_batch_test);
+  tcase_add_test  (tcase, gcs_recv_batch_threads_test);
+  return suite;
+}
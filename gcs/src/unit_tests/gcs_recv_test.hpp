@@ -0,0 +1,12 @@
+// Copyright (C) 2014 Codership Oy <info@codership.com>
+
+// $Id$
+
+#ifndef __gcs_recv_test__
+#define __gcs_recv_test__
+
+#include <check.h>
+
+Suite *gcs_recv_suite(void);
+
+#endif /* __gcs_recv_test__ */
@@ -694,6 +694,7 @@ CRC32CFunctionPtr detectBestCRC32C() {
 
 
 #include <assert.h>
+#include <pthread.h>
 
 // Hardware-accelerated CRC-32C (using CRC32 instruction)
 uint32_t crc32cHardware32(uint32_t crc, const void* data, size_t length) {
@@ -731,6 +732,114 @@ uint32_t crc32cHardware32(uint32_t crc, const void* data, size_t length) {
     return crc;
 }
 
+#ifdef __LP64__
+
+/*
+ * CRC32 instruction has a latency of 3 cycles but a throughput of 1 per
+ * cycle, so big buffers are processed as 3 interleaved streams which are
+ * then combined by shifting the CRC of the first stream over the length of
+ * the next one. The shift is a linear operator over GF(2), applied through
+ * the lookup tables below.
+ * Adapted from crc32c.c by Mark Adler (zlib license).
+ */
+
+#define CRC32C_LONG  8192
+#define CRC32C_SHORT 256
+
+static uint32_t crc32c_long [4][256];
+static uint32_t crc32c_short[4][256];
+
+static pthread_once_t crc32c_shift_once = PTHREAD_ONCE_INIT;
+
+/* multiplies matrix by vector over GF(2) */
+static inline uint32_t gf2_matrix_times(const uint32_t* mat, uint32_t vec) {
+    uint32_t sum = 0;
+    while (vec) {
+        if (vec & 1) sum ^= *mat;
+        vec >>= 1;
+        mat++;
+    }
+    return sum;
+}
+
+/* squares 32x32 matrix over GF(2) */
+static inline void gf2_matrix_square(uint32_t* square, const uint32_t* mat) {
+    for (int n = 0; n < 32; n++) square[n] = gf2_matrix_times(mat, mat[n]);
+}
+
+/* constructs an operator to apply len zero bytes to crc, len must be a power
+ * of 2 */
+static void crc32c_zeros_op(uint32_t* even, size_t len) {
+    uint32_t odd[32]; /* odd power of two zeros operator */
+    uint32_t row = 1;
+
+    odd[0] = 0x82f63b78; /* CRC-32C polynomial: one zero bit operator */
+    for (int n = 1; n < 32; n++) {
+        odd[n] = row;
+        row <<= 1;
+    }
+
+    gf2_matrix_square(even, odd); /* two zero bits  */
+    gf2_matrix_square(odd, even); /* four zero bits */
+
+    /* first square gives one zero byte in even, next - two in odd, etc. */
+    do {
+        gf2_matrix_square(even, odd);
+        len >>= 1;
+        if (len == 0) return;
+        gf2_matrix_square(odd, even);
+        len >>= 1;
+    } while (len);
+
+    for (int n = 0; n < 32; n++) even[n] = odd[n];
+}
+
+/* builds byte-wise lookup tables for the zeros operator */
+static void crc32c_zeros(uint32_t zeros[][256], size_t len) {
+    uint32_t op[32];
+
+    crc32c_zeros_op(op, len);
+
+    for (uint32_t n = 0; n < 256; n++) {
+        zeros[0][n] = gf2_matrix_times(op, n);
+        zeros[1][n] = gf2_matrix_times(op, n << 8);
+        zeros[2][n] = gf2_matrix_times(op, n << 16);
+        zeros[3][n] = gf2_matrix_times(op, n << 24);
+    }
+}
+
+static void crc32c_shift_init(void) {
+    crc32c_zeros(crc32c_long,  CRC32C_LONG);
+    crc32c_zeros(crc32c_short, CRC32C_SHORT);
+}
+
+static inline uint32_t crc32c_shift(uint32_t zeros[][256], uint32_t crc) {
+    return zeros[0][crc & 0xff] ^ zeros[1][(crc >> 8) & 0xff] ^
+           zeros[2][(crc >> 16) & 0xff] ^ zeros[3][crc >> 24];
+}
+
+#define CRC32C_3WAY(block, zeros)                                         \
+    while (length >= 3 * (block)) {                                       \
+        uint64_t crc1 = 0;                                                \
+        uint64_t crc2 = 0;                                                \
+        const char* const end = p_buf + (block);                          \
+        do {                                                              \
+            crc64bit = __builtin_ia32_crc32di(crc64bit,                   \
+                                              *(uint64_t*) p_buf);        \
+            crc1 = __builtin_ia32_crc32di(crc1,                           \
+                                          *(uint64_t*)(p_buf + (block))); \
+            crc2 = __builtin_ia32_crc32di(crc2,                           \
+                                          *(uint64_t*)(p_buf + 2*(block)));\
+            p_buf += sizeof(uint64_t);                                    \
+        } while (p_buf < end);                                            \
+        crc64bit = crc32c_shift(zeros, crc64bit) ^ crc1;                  \
+        crc64bit = crc32c_shift(zeros, crc64bit) ^ crc2;                  \
+        p_buf  += 2 * (block);                                            \
+        length -= 3 * (block);                                            \
+    }
+
+#endif /* __LP64__ */
+
 // Hardware-accelerated CRC-32C (using CRC64 instruction)
 uint32_t crc32cHardware64(uint32_t crc, const void* data, size_t length) {
 #ifndef __LP64__
@@ -739,6 +848,13 @@ uint32_t crc32cHardware64(uint32_t crc, const void* data, size_t length) {
     const char* p_buf = (const char*) data;
     // alignment doesn't seem to help?
     uint64_t crc64bit = crc;
+
+    if (length >= 3 * CRC32C_SHORT) {
+        pthread_once(&crc32c_shift_once, crc32c_shift_init);
+        CRC32C_3WAY(CRC32C_LONG,  crc32c_long);
+        CRC32C_3WAY(CRC32C_SHORT, crc32c_short);
+    }
+
     for (size_t i = 0; i < length / sizeof(uint64_t); i++) {
         crc64bit = __builtin_ia32_crc32di(crc64bit, *(uint64_t*) p_buf);
         p_buf += sizeof(uint64_t);